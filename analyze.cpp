@@ -0,0 +1,62 @@
+// analyze.cpp
+//Starfish --- chess engine developed by dsyoier
+//analyze 命令：对单个局面做 MultiPV 分析，打印按名次排列的候选着法与主变例
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+// 把主变例转成 SAN (逐步走子后还原)
+string FormatLineSAN(const RootLine& line) {
+    vector<UndoInfo> undos;
+    string out;
+    for (const auto& m : line.pv) {
+        vector<Move> legal; GenerateLegalMoves(legal);
+        if (find(legal.begin(), legal.end(), m) == legal.end()) break;
+        if (!out.empty()) out += ' ';
+        if (currentPlayer == WHITE) out += to_string(Round) + ". ";
+        else if (undos.empty()) out += to_string(Round) + "... ";
+        out += MoveToSAN(m, legal);
+        undos.push_back(MakeMove(m));
+    }
+    for (size_t i = undos.size(); i-- > 0;) UnmakeMove(line.pv[i], undos[i]);
+    return out;
+}
+
+void PrintAnalyzeUsage() {
+    cout << "Usage: analyze [-fen FEN] [-depth N] [-time MS] [-multipv K]\n"
+            "Searches one position and prints the best K moves, each with an exact score and its own principal variation." << endl;
+}
+
+int RunAnalyze(int argc, char* argv[]) {
+    string fen = START_FEN;
+    int depth = 6, timeMs = 0, multipv = 3;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-fen" && i + 1 < argc) fen = argv[++i];
+            else if (a == "-depth" && i + 1 < argc) depth = max(1, stoi(argv[++i]));
+            else if (a == "-time" && i + 1 < argc) timeMs = max(1, stoi(argv[++i]));
+            else if (a == "-multipv" && i + 1 < argc) multipv = max(1, stoi(argv[++i]));
+            else { PrintAnalyzeUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintAnalyzeUsage(); return 2; }
+    LoadFEN(fen);
+    searchMultiPV = multipv;
+    searchMaxDepth = (timeMs > 0) ? 64 : depth;
+    searchTimeLimitMs = (timeMs > 0) ? timeMs : numeric_limits<int>::max();
+    SearchBestMove(timeMs > 0 ? 2 : depth);
+    if (searchLines.empty()) { cout << "No legal moves in this position." << endl; return 0; }
+    cout << "----------------------------------" << endl;
+    for (size_t k = 0; k < searchLines.size(); ++k) {
+        double whiteScore = (currentPlayer == WHITE ? searchLines[k].score : -searchLines[k].score) / 100.0;
+        cout << (k + 1) << ". (" << showpos << fixed << setprecision(2) << whiteScore << noshowpos << defaultfloat << setprecision(6) << ") "
+             << FormatLineSAN(searchLines[k]) << endl;
+    }
+    return 0;
+}
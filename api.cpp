@@ -0,0 +1,300 @@
+// api.cpp
+//Starfish --- chess engine developed by dsyoier
+//可嵌入接口：Position 值对象与在独立工作线程上搜索的 Engine 对象
+#include "starfish.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+using namespace std;
+
+// --- Position ---
+// 在调用线程上临时载入某个局面，离开作用域时还原调用线程原来的局面
+struct ThreadPositionScope {
+    Position saved;
+    ThreadPositionScope(const Position& p) { saved.Capture(); p.Load(); }
+    ~ThreadPositionScope() { saved.Load(); }
+};
+
+Position::Position() { Parse(START_FEN); }
+
+// 严格解析：8 行各 8 格、双方各一王、底线无兵、易位与吃过路兵字段格式正确；半回合与回合数可省略
+bool Position::Parse(const string& fen) {
+    stringstream ss(fen);
+    string placement, color, castle = "-", enPassant = "-", half = "0", full = "1";
+    if (!(ss >> placement >> color)) return false;
+    ss >> castle >> enPassant >> half >> full;
+    int b[10][10];
+    memset(b, 0, sizeof(b));
+    int x = 1, y = 8, kings[2] = {0, 0};
+    for (char c : placement) {
+        if (c == '/') {
+            if (x != 9 || y == 1) return false;
+            y--; x = 1;
+        } else if (c >= '1' && c <= '8') {
+            x += c - '0';
+            if (x > 9) return false;
+        } else {
+            auto it = charToPiece.find(c);
+            if (it == charToPiece.end() || x > 8) return false;
+            int piece = it->second;
+            if ((piece & PIECE_TYPE_MASK) == PAWN && (y == 1 || y == 8)) return false;
+            if ((piece & PIECE_TYPE_MASK) == KING) kings[PieceColorOf(piece)]++;
+            b[x++][y] = piece;
+        }
+    }
+    if (x != 9 || y != 1 || kings[WHITE] != 1 || kings[BLACK] != 1) return false;
+    if (color != "w" && color != "b") return false;
+    int rights = 0;
+    if (castle != "-") {
+        for (char c : castle) {
+            const char* p = strchr("KQkq", c);
+            if (!p) return false;
+            rights |= 1 << (p - "KQkq");
+        }
+    }
+    Pos target(0, 0);
+    if (enPassant != "-") {
+        if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' || (enPassant[1] != '3' && enPassant[1] != '6')) return false;
+        target = Pos(enPassant[0] - 'a' + 1, enPassant[1] - '0');
+    }
+    int halfmoves, fullmoves;
+    try { halfmoves = stoi(half); fullmoves = stoi(full); } catch (const std::exception&) { return false; }
+    if (halfmoves < 0 || fullmoves < 1) return false;
+    memcpy(squares, b, sizeof(squares));
+    side = (color == "w") ? WHITE : BLACK;
+    castling = rights;
+    ep = target;
+    halfmove = halfmoves;
+    fullmove = fullmoves;
+    history.clear();
+    return true;
+}
+
+bool Position::SetFEN(const string& fen) {
+    Position p;
+    if (!p.Parse(fen)) return false;
+    *this = p;
+    return true;
+}
+
+bool Position::Play(const string& uciMove) {
+    if (uciMove.size() < 4 || uciMove.size() > 5) return false;
+    if (uciMove[0] < 'a' || uciMove[0] > 'h' || uciMove[1] < '1' || uciMove[1] > '8'
+        || uciMove[2] < 'a' || uciMove[2] > 'h' || uciMove[3] < '1' || uciMove[3] > '8') return false;
+    if (uciMove.size() == 5 && !strchr("qrbn", tolower(uciMove[4]))) return false;
+    ThreadPositionScope scope(*this);
+    return Play(parse_uci_move(uciMove));
+}
+
+bool Position::Play(const Move& move) {
+    ThreadPositionScope scope(*this);
+    vector<Move> legal; GenerateLegalMoves(legal);
+    if (find(legal.begin(), legal.end(), move) == legal.end()) return false;
+    MakeMove(move);
+    Capture();
+    return true;
+}
+
+string Position::FEN() const {
+    ThreadPositionScope scope(*this);
+    return GenerateFEN();
+}
+
+vector<Move> Position::LegalMoves() const {
+    ThreadPositionScope scope(*this);
+    vector<Move> legal; GenerateLegalMoves(legal);
+    return legal;
+}
+
+void Position::Load() const {
+    memcpy(board, squares, sizeof(board));
+    currentPlayer = side;
+    castlingRights = castling;
+    enPassantTarget = ep;
+    halfmoveClock = halfmove;
+    Round = fullmove;
+    if (history.empty()) ResetPositionHistory();
+    else positionHistory = history;
+}
+
+void Position::Capture() {
+    memcpy(squares, board, sizeof(squares));
+    side = currentPlayer;
+    castling = castlingRights;
+    ep = enPassantTarget;
+    halfmove = halfmoveClock;
+    fullmove = Round;
+    history = positionHistory;
+}
+
+// --- Engine：一个工作线程按顺序执行提交的搜索与任务 ---
+struct Engine::Impl {
+    TranspositionTable ownTable;
+    TranspositionTable* table = nullptr;
+    size_t hashMB = 0;
+    mutable mutex lock;
+    condition_variable changed;
+    deque<function<void()>> tasks;
+    bool busy = false, quit = false;
+    atomic<bool> stop{false};
+    Position position;
+    SearchResult result;
+    thread worker;
+
+    void Loop() {
+        static atomic<int> engineThreads(0);
+        BindSearchThread(engineThreads++);
+        if (!table) {
+            ownTable.Allocate(hashMB);   // 在工作线程上分配，页落在它所在的节点；失败时表为空，搜索照常进行
+            table = &ownTable;
+        }
+        SetThreadTT(table);
+        searchQuiet = true;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            changed.wait(guard, [&] { return quit || !tasks.empty(); });
+            if (tasks.empty()) break;
+            function<void()> task = move(tasks.front());
+            tasks.pop_front();
+            busy = true;
+            guard.unlock();
+            task();
+            guard.lock();
+            busy = false;
+            changed.notify_all();
+        }
+        SetThreadTT(nullptr);
+    }
+    void Post(function<void()> task) {
+        lock_guard<mutex> guard(lock);
+        tasks.push_back(move(task));
+        changed.notify_all();
+    }
+    void WaitIdle() {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&] { return tasks.empty() && !busy; });
+    }
+    // 在工作线程上执行：以 limits 设置本线程的搜索参数并搜索
+    void RunSearch(const Position& pos, const SearchLimits& limits, const InfoCallback& onInfo, const BestMoveCallback& onBestMove) {
+        if (limits.mate > 0) { Finish(RunMateSearch(pos, limits, onInfo), onBestMove); return; }
+        pos.Load();
+        searchStopFlag = &stop;
+        searchInfoCallback = onInfo;
+        searchMaxDepth = limits.depth > 0 ? limits.depth : 64;
+        searchTimeLimitMs = limits.timeMs > 0 ? limits.timeMs : numeric_limits<int>::max();
+        searchNodeLimit = max(0LL, limits.nodes);
+        searchMultiPV = max(1, limits.multiPV);
+        searchBestMove = Move();
+        searchBestScore = 0;
+        SearchBestMove(max(1, min(limits.minDepth, searchMaxDepth)));
+        searchStopFlag = nullptr;
+        searchInfoCallback = nullptr;
+        SearchResult r;
+        r.best = searchBestMove;
+        r.score = searchBestScore;
+        r.nodes = computedNodes;
+        r.timeMs = (int)chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - searchStartTime).count();
+        r.lines = searchLines;
+        if (!searchLines.empty() && searchLines[0].pv.size() > 1) r.ponder = searchLines[0].pv[1];
+        Finish(r, onBestMove);
+    }
+    // go mate N：df-pn 求最短强制杀，使用全部硬件线程；找到时报告一条深度为总半步数的将杀主变例
+    SearchResult RunMateSearch(const Position& pos, const SearchLimits& limits, const InfoCallback& onInfo) {
+        MateResult m = SolveMate(pos, limits.mate, 0, limits.nodes, 0, &stop);
+        SearchResult r;
+        r.nodes = m.nodes;
+        r.timeMs = m.timeMs;
+        if (m.status != MATE_FOUND) return r;
+        RootLine line;
+        line.move = m.line[0];
+        line.score = 1e9;
+        line.pv = m.line;
+        r.best = line.move;
+        if (m.line.size() > 1) r.ponder = m.line[1];
+        r.score = line.score;
+        r.lines.push_back(line);
+        if (onInfo) {
+            SearchInfo info;
+            info.depth = 2 * m.moves - 1;
+            info.score = line.score;
+            info.nodes = m.nodes;
+            info.timeMs = m.timeMs;
+            info.pv = m.line;
+            onInfo(info);
+        }
+        return r;
+    }
+    void Finish(const SearchResult& r, const BestMoveCallback& onBestMove) {
+        {
+            lock_guard<mutex> guard(lock);
+            result = r;
+        }
+        if (onBestMove) onBestMove(r);
+    }
+};
+
+Engine::Engine(size_t hashMB, TranspositionTable* sharedTable) : impl(new Impl) {
+    impl->table = sharedTable;
+    impl->hashMB = hashMB ? hashMB : ttDefaultSizeMB;
+    impl->worker = thread([this] { impl->Loop(); });
+}
+
+Engine::~Engine() {
+    Stop();
+    {
+        lock_guard<mutex> guard(impl->lock);
+        impl->quit = true;
+        impl->changed.notify_all();
+    }
+    impl->worker.join();
+    delete impl;
+}
+
+void Engine::SetPosition(const Position& position) {
+    lock_guard<mutex> guard(impl->lock);
+    impl->position = position;
+}
+
+Position Engine::GetPosition() const {
+    lock_guard<mutex> guard(impl->lock);
+    return impl->position;
+}
+
+void Engine::Go(const SearchLimits& limits, InfoCallback onInfo, BestMoveCallback onBestMove) {
+    Stop();
+    Wait();
+    impl->stop = false;
+    Position pos = GetPosition();
+    Impl* p = impl;
+    impl->Post([p, pos, limits, onInfo, onBestMove] { p->RunSearch(pos, limits, onInfo, onBestMove); });
+}
+
+void Engine::Stop() { impl->stop = true; }
+
+void Engine::Wait() { impl->WaitIdle(); }
+
+SearchResult Engine::Search(const SearchLimits& limits, InfoCallback onInfo) {
+    Go(limits, onInfo);
+    Wait();
+    return LastResult();
+}
+
+SearchResult Engine::LastResult() const {
+    lock_guard<mutex> guard(impl->lock);
+    return impl->result;
+}
+
+void Engine::Run(const function<void()>& task) {
+    impl->Post(task);
+    Wait();
+}
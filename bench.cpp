@@ -0,0 +1,184 @@
+// bench.cpp
+//Starfish --- chess engine developed by dsyoier
+//bench 命令：固定局面、固定深度的单线程搜索。总节点数是搜索行为的签名，同时用作 PGO 训练负载
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <iomanip>
+
+using namespace std;
+
+// --- 基准局面 (开局、中局、残局各若干；修改此表会改变签名) ---
+const char* BENCH_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "8/8/8/3k4/8/8/3PK3/8 w - - 0 1",
+    "8/8/8/8/4k3/8/8/R3K3 w Q - 0 1",
+    "rnbqkb1r/ppp1pppp/5n2/3p4/3P4/2N5/PPP1PPPP/R1BQKBNR w KQkq - 2 3",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "8/P5k1/8/8/8/8/6p1/K7 w - - 0 60",
+};
+const int BENCH_POSITION_COUNT = sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]);
+
+void PrintBenchUsage() {
+    cout << "Usage: bench [-depth N] [-verbose] [-evalcache on|off|compare] [-lazyeval on|off|compare]\n"
+            "Searches " << BENCH_POSITION_COUNT << " fixed positions to depth N (default 4; the search deepens in steps of 2)\n"
+            "and prints total nodes, time and NPS. The node total is a signature of the search: it changes\n"
+            "whenever search or evaluation behaviour changes.\n"
+            "-evalcache compare runs the suite without and then with the evaluation cache and prints the NPS gain.\n"
+            "-lazyeval compare does the same for the tiered early exits in quiescence evaluation, and also reports\n"
+            "how many best moves and how many nodes differ.\n"
+            "In a -DSTARFISH_PROFILE build the per-function profile of the measured run is printed at the end." << endl;
+}
+
+struct BenchTotals {
+    long long nodes = 0;
+    double ms = 0;
+    vector<Move> best;        // 每个局面的最佳着法
+    double Nps() const { return nodes / max(1e-3, ms / 1000); }
+};
+
+// 干净的单线程状态：默认评估参数、固定大小且逐局面清空的置换表与评估缓存、不限时间与节点、不打印搜索信息
+BenchTotals RunBenchSuite(int depth, bool verbose, TranspositionTable& table) {
+    BenchTotals totals;
+    for (int i = 0; i < BENCH_POSITION_COUNT; ++i) {
+        LoadFEN(BENCH_POSITIONS[i]);
+        table.Clear();
+        ClearEvalCache();
+        auto start = chrono::steady_clock::now();
+        SearchBestMove(depth);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        totals.nodes += computedNodes;
+        totals.ms += ms;
+        totals.best.push_back(searchBestMove);
+        if (verbose) {
+            cout << "Position " << (i + 1) << "/" << BENCH_POSITION_COUNT << ": " << MoveToUCI(searchBestMove)
+                 << " nodes " << computedNodes << " time " << (long long)ms << "ms" << endl;
+        }
+    }
+    return totals;
+}
+
+int RunBench(int argc, char* argv[]) {
+    int depth = 4;
+    bool verbose = false;
+    string evalCacheMode = "on", lazyEvalMode = "on";
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-depth" && i + 1 < argc) depth = max(1, stoi(argv[++i]));
+            else if (a == "-verbose") verbose = true;
+            else if (a == "-evalcache" && i + 1 < argc) evalCacheMode = argv[++i];
+            else if (a == "-lazyeval" && i + 1 < argc) lazyEvalMode = argv[++i];
+            else { PrintBenchUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintBenchUsage(); return 2; }
+    for (const string& mode : {evalCacheMode, lazyEvalMode}) {
+        if (mode != "on" && mode != "off" && mode != "compare") { PrintBenchUsage(); return 2; }
+    }
+    if (evalCacheMode == "compare" && lazyEvalMode == "compare") { PrintBenchUsage(); return 2; }
+
+    const size_t BENCH_HASH_MB = 16;
+    TranspositionTable table;
+    if (!table.Allocate(BENCH_HASH_MB)) return 1;
+    SetThreadTT(&table);
+    searchQuiet = true;
+    searchMaxDepth = depth;
+    searchNodeLimit = 0;
+    searchTimeLimitMs = numeric_limits<int>::max();
+    // compare 时先在关闭该项的情况下跑一遍作为基线
+    bool comparing = evalCacheMode == "compare" || lazyEvalMode == "compare";
+    const char* compared = evalCacheMode == "compare" ? "cache" : "lazy eval";
+    BenchTotals baseline;
+    if (comparing) {
+        evalCacheEnabled = evalCacheMode == "on";
+        lazyEvalEnabled = lazyEvalMode == "on";
+        baseline = RunBenchSuite(depth, false, table);
+    }
+    evalCacheEnabled = evalCacheMode != "off";
+    lazyEvalEnabled = lazyEvalMode != "off";
+    evalCacheProbes = evalCacheHits = 0;
+    lazyEvalCalls = lazyEvalExits[0] = lazyEvalExits[1] = 0;
+#ifdef STARFISH_PROFILE
+    ResetProfile();   // 只统计主测量这一遍 (compare 的基线不计)
+#endif
+    BenchTotals totals = RunBenchSuite(depth, verbose, table);
+    SetThreadTT(nullptr);
+    cout << "===========================" << endl;
+    cout << "Total time (ms) : " << (long long)totals.ms << endl;
+    cout << "Nodes searched  : " << totals.nodes << endl;
+    cout << "Nodes/second    : " << (long long)totals.Nps() << endl;
+    cout << fixed << setprecision(1);
+    if (evalCacheEnabled) {
+        cout << "Eval cache hits : " << evalCacheHits << "/" << evalCacheProbes << " ("
+             << 100.0 * evalCacheHits / max(1LL, evalCacheProbes) << "%)" << endl;
+    }
+    if (lazyEvalEnabled) {
+        cout << "Lazy eval exits : " << lazyEvalExits[0] + lazyEvalExits[1] << "/" << lazyEvalCalls << " ("
+             << 100.0 * lazyEvalExits[0] / max(1LL, lazyEvalCalls) << "% after material, "
+             << 100.0 * lazyEvalExits[1] / max(1LL, lazyEvalCalls) << "% after pawns)" << endl;
+    }
+    if (comparing) {
+        cout << "NPS without " << compared << ": " << (long long)baseline.Nps() << " (" << showpos
+             << 100.0 * (totals.Nps() / max(1.0, baseline.Nps()) - 1) << noshowpos << "% with " << compared << ")" << endl;
+        if (evalCacheMode == "compare" && baseline.nodes != totals.nodes) cout << "info string Warning: node counts differ with and without the cache." << endl;
+        if (lazyEvalMode == "compare") {
+            int differ = 0;
+            for (size_t i = 0; i < totals.best.size(); ++i) differ += !(totals.best[i] == baseline.best[i]);
+            cout << "Best moves      : " << differ << "/" << totals.best.size() << " differ; nodes " << showpos
+                 << 100.0 * ((double)totals.nodes / max(1LL, baseline.nodes) - 1) << noshowpos << "% with lazy eval" << endl;
+        }
+    }
+#ifdef STARFISH_PROFILE
+    cout << defaultfloat << setprecision(6);
+    PrintProfile(totals.nodes);
+#endif
+    return 0;
+}
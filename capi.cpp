@@ -0,0 +1,94 @@
+// capi.cpp
+//Starfish --- chess engine developed by dsyoier
+//C 接口 (starfish_c.h) 到 Engine / Position 的薄封装；异常不会越过 C 边界
+#include "starfish.h"
+#include "starfish_c.h"
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <new>
+
+using namespace std;
+
+struct sf_engine {
+    Engine engine;
+    explicit sf_engine(size_t hashMB) : engine(hashMB) {}
+};
+
+// 将杀分为 ±(1e9 + 剩余深度)，残局库分为 ±(TB_WIN_SCORE - 距根半步数)，都换算成距根的步数
+static void FillInfo(const SearchInfo& in, const string& pv, sf_info& out) {
+    out.depth = in.depth;
+    out.multipv = in.multipv;
+    out.mate = 0;
+    out.score_cp = 0;
+    if (fabs(in.score) > 5e8) {
+        int plies = in.depth - (int)(fabs(in.score) - 1e9);
+        out.mate = (in.score > 0 ? 1 : -1) * max(1, (plies + 1) / 2);
+    } else if (fabs(in.score) > TB_WIN_SCORE / 2) {   // 残局库分：TB_WIN_SCORE 减去距根的将杀半步数
+        int plies = (int)(TB_WIN_SCORE - fabs(in.score));
+        out.mate = (in.score > 0 ? 1 : -1) * max(1, (plies + 1) / 2);
+    } else {
+        out.score_cp = (int)in.score;
+    }
+    out.nodes = in.nodes;
+    out.time_ms = in.timeMs;
+    out.hashfull = in.hashfull;
+    out.pv = pv.c_str();
+}
+
+extern "C" {
+
+sf_engine* sf_engine_new(int hash_mb) {
+    try { return new sf_engine(hash_mb > 0 ? (size_t)hash_mb : 0); } catch (...) { return nullptr; }
+}
+
+void sf_engine_free(sf_engine* engine) { delete engine; }
+
+int sf_engine_set_position(sf_engine* engine, const char* fen, const char* moves) {
+    try {
+        Position pos;
+        if (fen && string(fen) != "startpos" && !pos.SetFEN(fen)) return -1;
+        if (moves) {
+            stringstream ss(moves);
+            string m;
+            while (ss >> m) if (!pos.Play(m)) return -2;
+        }
+        engine->engine.SetPosition(pos);
+        return 0;
+    } catch (...) { return -3; }
+}
+
+int sf_engine_go(sf_engine* engine, const sf_limits* limits, sf_info_callback on_info, sf_bestmove_callback on_bestmove, void* user) {
+    try {
+        SearchLimits l;
+        if (limits) {
+            l.depth = limits->depth;
+            l.timeMs = limits->time_ms;
+            l.nodes = limits->nodes;
+            l.multiPV = limits->multipv;
+            l.mate = limits->mate;
+        }
+        InfoCallback onInfo;
+        if (on_info) onInfo = [on_info, user](const SearchInfo& info) {
+            string pv;
+            for (const auto& m : info.pv) { if (!pv.empty()) pv += ' '; pv += MoveToUCI(m); }
+            sf_info out;
+            FillInfo(info, pv, out);
+            on_info(&out, user);
+        };
+        BestMoveCallback onBestMove;
+        if (on_bestmove) onBestMove = [on_bestmove, user](const SearchResult& r) {
+            string best = r.best.from.ok() ? MoveToUCI(r.best) : "(none)";
+            string ponder = r.ponder.from.ok() ? MoveToUCI(r.ponder) : "";
+            on_bestmove(best.c_str(), ponder.c_str(), user);
+        };
+        engine->engine.Go(l, onInfo, onBestMove);
+        return 0;
+    } catch (...) { return -3; }
+}
+
+void sf_engine_stop(sf_engine* engine) { engine->engine.Stop(); }
+
+void sf_engine_wait(sf_engine* engine) { engine->engine.Wait(); }
+
+}
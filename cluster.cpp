@@ -0,0 +1,490 @@
+// cluster.cpp
+//Starfish --- chess engine developed by dsyoier
+//分布式搜索 (cluster)：协调者在根节点做迭代加深，把根着法作为任务动态分给经 TCP 连入的工作进程；
+//工作进程把较深的置换表条目成批回传，由协调者转发给其它工作进程。工作进程掉线时它手上的任务重新排队。
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+using namespace std;
+
+// --- 协议：以换行结尾的文本消息；hash 消息后紧跟 n 个 24 字节的原始条目 (本机字节序，所有进程须为同一架构) ---
+// 工作者 → 协调者：hello NAME | result ID SCORE NODES PV... | hash N <条目>
+// 协调者 → 工作者：position FEN | job ID DEPTH ALPHA BETA FIRST MOVE | hash N <条目> | quit
+const int CLUSTER_DEFAULT_PORT = 7700;
+const size_t HASH_BATCH_MAX = 4096;                  // 每个任务回传的最深条目数上限
+const size_t OUTBOX_HASH_LIMIT = 8 * 1024 * 1024;    // 工作者积压超过此字节数时不再向它转发条目
+
+#ifndef _WIN32
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// 从 buf 头部取出一条完整消息：line 为不含换行的文本，payload 为 hash 消息的条目；不完整时返回 false
+bool NextClusterMessage(string& buf, string& line, string& payload) {
+    size_t eol = buf.find('\n');
+    if (eol == string::npos) return false;
+    line = buf.substr(0, eol);
+    size_t need = 0;
+    if (line.compare(0, 5, "hash ") == 0) need = strtoull(line.c_str() + 5, nullptr, 10) * sizeof(TTExport);
+    if (buf.size() < eol + 1 + need) return false;
+    payload = buf.substr(eol + 1, need);
+    buf.erase(0, eol + 1 + need);
+    return true;
+}
+
+vector<string> SplitWords(const string& line) {
+    vector<string> words;
+    stringstream ss(line);
+    string w;
+    while (ss >> w) words.push_back(w);
+    return words;
+}
+
+string FormatScore(double s) {
+    ostringstream os;
+    os << setprecision(17) << s;
+    return os.str();
+}
+
+bool SendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+string EncodeHashBatch(const vector<TTExport>& entries) {
+    string msg = "hash " + to_string(entries.size()) + "\n";
+    msg.append((const char*)entries.data(), entries.size() * sizeof(TTExport));
+    return msg;
+}
+
+// --- 工作者：单线程，读一条消息处理一条；搜索期间收到的条目在套接字中排队，下一个任务前导入 ---
+int ConnectTo(const string& host, int port) {
+    addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &res) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* a = res; a; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd >= 0) { int one = 1; setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); }
+    return fd;
+}
+
+struct ClusterWorkerStats { long long jobs = 0, nodes = 0, exported = 0, imported = 0; };
+
+bool ServeCoordinator(int fd, const string& name, int shareDepth, ClusterWorkerStats& stats) {
+    if (!SendAll(fd, "hello " + name + "\n")) return false;
+    TranspositionTable& table = ThreadTT();
+    vector<TTExport> exported;
+    string buf, line, payload;
+    char chunk[65536];
+    for (;;) {
+        while (!NextClusterMessage(buf, line, payload)) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) return false;
+            buf.append(chunk, n);
+        }
+        vector<string> w = SplitWords(line);
+        if (w.empty()) continue;
+        if (w[0] == "quit") return true;
+        if (w[0] == "position" && w.size() > 1) {
+            LoadFEN(line.substr(9));
+            table.NewSearch();
+        } else if (w[0] == "hash") {
+            const TTExport* x = (const TTExport*)payload.data();
+            size_t n = payload.size() / sizeof(TTExport);
+            for (size_t i = 0; i < n; ++i) table.Import(x[i]);
+            stats.imported += n;
+        } else if (w[0] == "job" && w.size() == 7) {
+            int depth = atoi(w[2].c_str());
+            double alpha = strtod(w[3].c_str(), nullptr), beta = strtod(w[4].c_str(), nullptr);
+            Move m = parse_uci_move(w[6]);
+            vector<Move> pv;
+            exported.clear();
+            table.exportLog = &exported;
+            table.exportMinDepth = shareDepth;
+            double score = SearchRootMove(m, depth, alpha, beta, w[5] == "1", pv);
+            table.exportLog = nullptr;
+            stats.jobs++;
+            stats.nodes += computedNodes;
+            // 只回传最深的一批；同一局面的多次写入保留最后一次
+            reverse(exported.begin(), exported.end());
+            stable_sort(exported.begin(), exported.end(), [](const TTExport& a, const TTExport& b) { return a.key < b.key; });
+            exported.erase(unique(exported.begin(), exported.end(), [](const TTExport& a, const TTExport& b) { return a.key == b.key; }), exported.end());
+            if (exported.size() > HASH_BATCH_MAX) {
+                nth_element(exported.begin(), exported.begin() + HASH_BATCH_MAX, exported.end(),
+                            [](const TTExport& a, const TTExport& b) { return ((a.meta >> 16) & 0xFF) > ((b.meta >> 16) & 0xFF); });
+                exported.resize(HASH_BATCH_MAX);
+            }
+            stats.exported += exported.size();
+            string reply = exported.empty() ? string() : EncodeHashBatch(exported);
+            reply += "result " + w[1] + " " + FormatScore(score) + " " + to_string(computedNodes);
+            for (const auto& mv : pv) reply += " " + MoveToUCI(mv);
+            reply += "\n";
+            if (!SendAll(fd, reply)) return false;
+        }
+    }
+}
+
+// --- 协调者 ---
+struct ClusterOptions {
+    string fen = START_FEN;
+    int port = CLUSTER_DEFAULT_PORT;
+    int depth = 8;
+    int workers = 0;          // 开始搜索前等待的工作者数，0 = 本地工作者数 (至少 1)
+    int local = 0;            // 在本进程内启动的工作者线程数 (经回环地址连接)
+    int shareDepth = 3;
+    bool compare = false;     // 之后以单进程搜索同一局面并报告加速比
+};
+struct ClusterPeer {
+    int fd = -1;
+    string name;
+    string in, out;
+    int jobId = -1;           // 正在执行的任务，-1 = 空闲
+    int moveIndex = -1;
+    long long jobs = 0;
+};
+
+int OpenListener(const string& host, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1
+        || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) { close(fd); return -1; }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+class ClusterCoordinator {
+public:
+    ClusterCoordinator(const ClusterOptions& o, int listenFd) : opt(o), listener(listenFd) {}
+    ~ClusterCoordinator() {
+        for (auto& p : peers) close(p.fd);
+    }
+    long long totalNodes = 0, requeued = 0, forwarded = 0;
+    int peakWorkers = 0;
+    chrono::steady_clock::time_point start;   // 等到所需的工作者之后开始计时
+
+    // 返回最后一轮完整迭代的主变例
+    RootLine Search(const vector<Move>& rootMoves) {
+        moves = rootMoves;
+        RootLine best;
+        int needed = max(1, opt.workers > 0 ? opt.workers : opt.local);
+        while ((int)peers.size() < needed) Pump(-1);
+        start = chrono::steady_clock::now();
+        for (int depth = 2; depth <= opt.depth; depth += 2) {
+            scores.assign(moves.size(), 0);
+            lines.assign(moves.size(), vector<Move>());
+            done.assign(moves.size(), false);
+            remaining = (int)moves.size();
+            bestIndex = -1;
+            expanded = false;
+            pending.clear();
+            pending.push_back(0);   // 第一个着法以完整窗口单独搜索，确定 alpha 后其余着法再并行展开
+            iterationDepth = depth;
+            while (remaining > 0) {
+                Dispatch();
+                Pump(-1);
+            }
+            long long ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            best.move = moves[bestIndex];
+            best.score = scores[bestIndex];
+            best.pv = lines[bestIndex];
+            cout << "info depth " << depth << " score cp " << static_cast<int>(currentPlayer == WHITE ? best.score : -best.score)
+                 << " nodes " << totalNodes << " time " << ms << "ms workers " << peers.size() << " pv";
+            for (const auto& m : best.pv) cout << " " << MoveToUCI(m);
+            cout << endl;
+            rotate(moves.begin(), moves.begin() + bestIndex, moves.begin() + bestIndex + 1);   // 下一轮先搜上一轮的最佳着法
+        }
+        for (auto& p : peers) {
+            fcntl(p.fd, F_SETFL, fcntl(p.fd, F_GETFL) & ~O_NONBLOCK);
+            SendAll(p.fd, p.out + "quit\n");
+        }
+        return best;
+    }
+
+private:
+    const ClusterOptions& opt;
+    int listener;
+    vector<ClusterPeer> peers;
+    vector<Move> moves;
+    vector<double> scores;
+    vector<vector<Move>> lines;
+    vector<bool> done;
+    deque<int> pending;
+    int remaining = 0, bestIndex = -1, iterationDepth = 0, nextJobId = 0;
+    bool expanded = false;
+
+    void Dispatch() {
+        for (auto& p : peers) {
+            if (pending.empty()) return;
+            if (p.jobId >= 0) continue;
+            int index = pending.front();
+            pending.pop_front();
+            bool first = bestIndex < 0;
+            double alpha = first ? -numeric_limits<double>::infinity() : scores[bestIndex];
+            p.jobId = nextJobId++;
+            p.moveIndex = index;
+            p.out += "job " + to_string(p.jobId) + " " + to_string(iterationDepth) + " " + FormatScore(alpha) + " inf "
+                   + (first ? "1 " : "0 ") + MoveToUCI(moves[index]) + "\n";
+        }
+    }
+
+    void Drop(size_t i, const char* why) {
+        ClusterPeer& p = peers[i];
+        cout << "info string Worker " << p.name << " " << why;
+        if (p.jobId >= 0) {
+            pending.push_front(p.moveIndex);
+            requeued++;
+            cout << "; its job " << MoveToUCI(moves[p.moveIndex]) << " is requeued";
+        }
+        cout << "." << endl;
+        close(p.fd);
+        peers.erase(peers.begin() + i);
+        if (peers.empty()) cout << "info string No workers left; waiting for a worker to connect on port " << opt.port << "." << endl;
+    }
+
+    void Accept() {
+        for (;;) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) return;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            ClusterPeer p;
+            p.fd = fd;
+            p.name = "#" + to_string(peers.size() + 1);
+            p.out = "position " + opt.fen + "\n";
+            peers.push_back(p);
+            peakWorkers = max(peakWorkers, (int)peers.size());
+        }
+    }
+
+    // 返回 false 表示应断开该工作者
+    bool Handle(ClusterPeer& p, const string& line, const string& payload) {
+        vector<string> w = SplitWords(line);
+        if (w.empty()) return true;
+        if (w[0] == "hello" && w.size() > 1) {
+            p.name = w[1];
+            return true;
+        }
+        if (w[0] == "hash") {
+            string msg = line + "\n" + payload;
+            for (auto& q : peers) {
+                if (&q == &p || q.out.size() > OUTBOX_HASH_LIMIT) continue;
+                q.out += msg;
+                forwarded += payload.size() / sizeof(TTExport);
+            }
+            return true;
+        }
+        if (w[0] == "result" && w.size() >= 4) {
+            if (atoi(w[1].c_str()) != p.jobId) return false;
+            int index = p.moveIndex;
+            p.jobId = -1;
+            p.jobs++;
+            double score = strtod(w[2].c_str(), nullptr);
+            totalNodes += atoll(w[3].c_str());
+            if (done[index]) return true;
+            done[index] = true;
+            remaining--;
+            scores[index] = score;
+            for (size_t k = 4; k < w.size(); ++k) lines[index].push_back(parse_uci_move(w[k]));
+            // 分数高于派发时 alpha 的结果已由工作者以完整窗口重搜，是精确值
+            if (bestIndex < 0 || score > scores[bestIndex]) bestIndex = index;
+            if (!expanded) {
+                expanded = true;
+                for (size_t k = 1; k < moves.size(); ++k) pending.push_back((int)k);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void Pump(int timeoutMs) {
+        vector<pollfd> fds(1 + peers.size());
+        fds[0] = {listener, POLLIN, 0};
+        for (size_t i = 0; i < peers.size(); ++i) fds[i + 1] = {peers[i].fd, (short)(POLLIN | (peers[i].out.empty() ? 0 : POLLOUT)), 0};
+        if (poll(fds.data(), fds.size(), timeoutMs) <= 0) return;
+        size_t count = peers.size();
+        vector<bool> dead(count, false);
+        vector<const char*> why(count, "");
+        char chunk[65536];
+        for (size_t i = 0; i < count; ++i) {
+            ClusterPeer& p = peers[i];
+            short ev = fds[i + 1].revents;
+            if (ev & POLLOUT) {
+                ssize_t n = send(p.fd, p.out.data(), p.out.size(), MSG_NOSIGNAL);
+                if (n > 0) p.out.erase(0, n);
+                else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) { dead[i] = true; why[i] = "disconnected"; continue; }
+            }
+            if (ev & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t n = recv(p.fd, chunk, sizeof(chunk), 0);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) { dead[i] = true; why[i] = "disconnected"; continue; }
+                if (n > 0) p.in.append(chunk, n);
+                string line, payload;
+                while (NextClusterMessage(p.in, line, payload)) {
+                    if (!Handle(p, line, payload)) { dead[i] = true; why[i] = "sent an invalid message"; break; }
+                }
+            }
+        }
+        for (size_t i = count; i-- > 0;) if (dead[i]) Drop(i, why[i]);
+        if (fds[0].revents & POLLIN) Accept();
+    }
+};
+
+void RunLocalClusterWorker(int index, const string& host, int port, int shareDepth) {
+    BindSearchThread(index);
+    searchQuiet = true;
+    int fd = -1;
+    for (int attempt = 0; attempt < 50 && fd < 0; ++attempt) {
+        fd = ConnectTo(host, port);
+        if (fd < 0) this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    if (fd < 0) { cout << "info string Local worker " << index << " could not connect." << endl; return; }
+    ClusterWorkerStats stats;
+    ServeCoordinator(fd, "local-" + to_string(index + 1), shareDepth, stats);
+    close(fd);
+}
+#endif
+
+void PrintClusterUsage() {
+    cout << "Usage: cluster coordinator [-fen FEN] [-depth N] [-host ADDR] [-port P] [-workers N] [-local N] [-sharedepth D] [-compare]\n"
+            "       cluster worker [-host HOST] [-port P] [-sharedepth D]\n"
+            "The coordinator deepens the root position in steps of 2 and hands root moves to the connected workers:\n"
+            "the first move is searched alone with a full window, the rest in parallel with a zero window around the\n"
+            "best score so far. Workers send back their hash entries of depth >= D (default 3), which are forwarded\n"
+            "to the other workers. A worker that disconnects has its job requeued; workers may join at any time.\n"
+            "The coordinator listens on -host ADDR (default 127.0.0.1); use 0.0.0.0 to accept workers on other machines.\n"
+            "-workers N waits for N workers before starting (default: the number of local workers, at least 1).\n"
+            "-local N starts N workers inside the coordinator process, connected to the listening address.\n"
+            "-compare then searches the same position in a single process and prints the speedup." << endl;
+}
+
+int RunCluster(int argc, char* argv[]) {
+    if (argc < 1) { PrintClusterUsage(); return 2; }
+    string role = argv[0];
+    if (role != "coordinator" && role != "worker") { PrintClusterUsage(); return 2; }
+    ClusterOptions opt;
+    string host = "127.0.0.1";   // 协调者的监听地址，或工作者要连接的协调者地址
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-fen" && i + 1 < argc) opt.fen = argv[++i];
+            else if (a == "-depth" && i + 1 < argc) opt.depth = max(2, stoi(argv[++i]));
+            else if (a == "-port" && i + 1 < argc) opt.port = stoi(argv[++i]);
+            else if (a == "-workers" && i + 1 < argc) opt.workers = max(1, stoi(argv[++i]));
+            else if (a == "-local" && i + 1 < argc) opt.local = max(0, stoi(argv[++i]));
+            else if (a == "-sharedepth" && i + 1 < argc) opt.shareDepth = max(1, stoi(argv[++i]));
+            else if (a == "-host" && i + 1 < argc) host = argv[++i];
+            else if (a == "-compare") opt.compare = true;
+            else { PrintClusterUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintClusterUsage(); return 2; }
+#ifdef _WIN32
+    cout << "Error: Distributed search is not supported on this platform." << endl;
+    return 2;
+#else
+    if (role == "worker") {
+        int fd = ConnectTo(host, opt.port);
+        if (fd < 0) { cout << "Error: Could not connect to " << host << ":" << opt.port << endl; return 2; }
+        char hostname[256] = "worker";
+        gethostname(hostname, sizeof(hostname) - 1);
+        string name = string(hostname) + ":" + to_string(getpid());
+        cout << "info string Connected to " << host << ":" << opt.port << " as " << name << endl;
+        searchQuiet = true;
+        ClusterWorkerStats stats;
+        bool clean = ServeCoordinator(fd, name, opt.shareDepth, stats);
+        close(fd);
+        cout << "info string " << (clean ? "Coordinator finished" : "Connection lost") << ": " << stats.jobs << " jobs, " << stats.nodes
+             << " nodes, " << stats.exported << " hash entries sent, " << stats.imported << " received." << endl;
+        return clean ? 0 : 1;
+    }
+
+    LoadFEN(opt.fen);
+    opt.fen = GenerateFEN();
+    vector<Move> rootMoves; GenerateLegalMoves(rootMoves);
+    if (rootMoves.empty()) { cout << "No legal moves in this position." << endl; return 0; }
+    int listener = OpenListener(host, opt.port);
+    if (listener < 0) { cout << "Error: Could not listen on " << host << ":" << opt.port << endl; return 2; }
+    cout << "info string Coordinator listening on " << host << ":" << opt.port << ", depth " << opt.depth << endl;
+    string localHost = (host == "0.0.0.0") ? "127.0.0.1" : host;   // 本地工作者连接监听地址 (通配地址经回环连接)
+    vector<thread> locals;
+    for (int i = 0; i < opt.local; ++i) locals.emplace_back(RunLocalClusterWorker, i, localHost, opt.port, opt.shareDepth);
+    RootLine best;
+    long long nodes, requeued, forwarded;
+    int workers;
+    double ms;
+    {
+        ClusterCoordinator coordinator(opt, listener);
+        best = coordinator.Search(rootMoves);
+        ms = max<double>(1, chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - coordinator.start).count());
+        nodes = coordinator.totalNodes; requeued = coordinator.requeued; forwarded = coordinator.forwarded;
+        workers = coordinator.peakWorkers;
+    }
+    for (auto& t : locals) t.join();
+    close(listener);
+    cout << "----------------------------------" << endl;
+    cout << "Best move       : " << MoveToUCI(best.move) << " (score cp " << static_cast<int>(currentPlayer == WHITE ? best.score : -best.score) << ")" << endl;
+    cout << "Workers         : " << workers << endl;
+    cout << "Total time (ms) : " << (long long)ms << endl;
+    cout << "Nodes searched  : " << nodes << endl;
+    cout << "Nodes/second    : " << (long long)(nodes / (ms / 1000)) << endl;
+    cout << "Jobs requeued   : " << requeued << endl;
+    cout << "Hash forwarded  : " << forwarded << " entries" << endl;
+    if (opt.compare) {
+        LoadFEN(opt.fen);
+        ThreadTT().Clear();
+        searchQuiet = true;
+        searchMultiPV = 1;
+        searchMaxDepth = opt.depth;
+        searchTimeLimitMs = numeric_limits<int>::max();
+        auto singleStart = chrono::steady_clock::now();
+        SearchBestMove(opt.depth);
+        double singleMs = max<double>(1, chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - singleStart).count());
+        cout << "Single process  : " << MoveToUCI(searchBestMove) << " (score cp " << static_cast<int>(currentPlayer == WHITE ? searchBestScore : -searchBestScore)
+             << "), " << (long long)singleMs << " ms, " << computedNodes << " nodes" << endl;
+        cout << "Speedup         : " << fixed << setprecision(2) << singleMs / ms << "x" << defaultfloat << setprecision(6) << endl;
+    }
+    return 0;
+#endif
+}
@@ -0,0 +1,218 @@
+// endgame.cpp
+//Starfish --- chess engine developed by dsyoier
+//残局知识：启动时以逆推迭代生成的 KPK 位库 (24 KB)，以及按子力签名登记的专用评估与缩放函数。
+//Evaluate() 用子力键在开放寻址表中 O(1) 查到对应条目。
+#include "starfish.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+const double KNOWN_WIN = 1000.0;   // 已知胜局的基础分，高于任何常规子力优势中的位置分
+
+// --- KPK 位库：强方视为白方、兵在 a-d 线；下标 = 走子方 | 黑王 << 1 | 白王 << 7 | 兵线 << 13 | (6 - 兵行) << 15 ---
+const int KPK_SIZE = 2 * 24 * 64 * 64;
+uint32_t kpkWins[KPK_SIZE / 32];
+
+inline int KPKIndex(int stm, int bk, int wk, int psq) { return stm | (bk << 1) | (wk << 7) | ((psq % 8) << 13) | ((6 - psq / 8) << 15); }
+inline int SquareDistance(int a, int b) { return max(abs(a % 8 - b % 8), abs(a / 8 - b / 8)); }
+inline bool WhitePawnAttacks(int p, int s) { return s / 8 == p / 8 + 1 && abs(s % 8 - p % 8) == 1; }
+
+struct KPKInit {
+    enum { INVALID = 0, UNKNOWN = 1, DRAW = 2, WIN = 4 };
+    vector<uint8_t> r;
+
+    KPKInit() : r(KPK_SIZE) {
+        for (int i = 0; i < KPK_SIZE; ++i) r[i] = Initial(i);
+        // 反复传播子节点结果直到不再变化
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (int i = 0; i < KPK_SIZE; ++i) {
+                if (r[i] != UNKNOWN) continue;
+                r[i] = Classify(i);
+                changed |= (r[i] != UNKNOWN);
+            }
+        }
+        for (int i = 0; i < KPK_SIZE; ++i) if (r[i] == WIN) kpkWins[i / 32] |= 1u << (i % 32);
+    }
+    static void Decode(int i, int& stm, int& bk, int& wk, int& psq) {
+        stm = i & 1; bk = (i >> 1) & 63; wk = (i >> 7) & 63;
+        psq = ((i >> 13) & 3) + 8 * (6 - ((i >> 15) & 7));
+    }
+    static uint8_t Initial(int i) {
+        int stm, bk, wk, psq;
+        Decode(i, stm, bk, wk, psq);
+        if (SquareDistance(wk, bk) <= 1 || wk == psq || bk == psq || (stm == WHITE && WhitePawnAttacks(psq, bk))) return INVALID;
+        // 白方走且兵可安全升变
+        if (stm == WHITE && psq / 8 == 6 && wk != psq + 8 && (SquareDistance(bk, psq + 8) > 1 || SquareDistance(wk, psq + 8) == 1)) return WIN;
+        if (stm == BLACK) {
+            // 黑王无路可走 (逼和) 或能吃掉无保护的兵
+            bool canMove = false;
+            for (int s = 0; s < 64; ++s)
+                if (SquareDistance(bk, s) == 1 && SquareDistance(wk, s) > 1 && !WhitePawnAttacks(psq, s)) canMove = true;
+            if (!canMove || (SquareDistance(bk, psq) == 1 && SquareDistance(wk, psq) > 1)) return DRAW;
+        }
+        return UNKNOWN;
+    }
+    uint8_t Classify(int i) const {
+        int stm, bk, wk, psq;
+        Decode(i, stm, bk, wk, psq);
+        int good = (stm == WHITE) ? WIN : DRAW, bad = (stm == WHITE) ? DRAW : WIN;
+        int res = INVALID;
+        int k = (stm == WHITE) ? wk : bk;
+        for (int s = 0; s < 64; ++s) {
+            if (SquareDistance(k, s) != 1) continue;
+            res |= (stm == WHITE) ? r[KPKIndex(BLACK, bk, s, psq)] : r[KPKIndex(WHITE, s, wk, psq)];
+        }
+        if (stm == WHITE) {
+            if (psq / 8 < 6) res |= r[KPKIndex(BLACK, bk, wk, psq + 8)];
+            if (psq / 8 == 1 && psq + 8 != wk && psq + 8 != bk) res |= r[KPKIndex(BLACK, bk, wk, psq + 16)];
+        }
+        return (res & good) ? good : (res & UNKNOWN) ? UNKNOWN : bad;
+    }
+} kpkInit;
+
+bool ProbeKPK(int strongSide, int sideToMove, Pos strongKing, Pos pawn, Pos weakKing) {
+    auto square = [&](Pos p) {
+        int x = p.x, y = (strongSide == WHITE) ? p.y : 9 - p.y;
+        if (pawn.x > 4) x = 9 - x;
+        return (x - 1) + 8 * (y - 1);
+    };
+    int stm = (sideToMove == strongSide) ? WHITE : BLACK;
+    int i = KPKIndex(stm, square(weakKing), square(strongKing), square(pawn));
+    return (kpkWins[i / 32] >> (i % 32)) & 1;
+}
+
+// --- 专用评估 (白方视角的完整评估) 与缩放函数 ---
+struct EndgamePieces {
+    Pos king[2];
+    vector<Pos> pieces[2][7];
+    EndgamePieces() {
+        for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) {
+            int p = board[x][y];
+            if (p == EMPTY_PIECE) continue;
+            if ((p & PIECE_TYPE_MASK) == KING) king[PieceColorOf(p)] = Pos(x, y);
+            else pieces[PieceColorOf(p)][p & PIECE_TYPE_MASK].push_back(Pos(x, y));
+        }
+    }
+};
+inline int Distance(Pos a, Pos b) { return max(abs(a.x - b.x), abs(a.y - b.y)); }
+inline int SquareColor(Pos p) { return (p.x + p.y) % 2; }   // a1 为 0 (暗格)
+inline int PushToEdge(Pos p) { return 20 * (max(4 - p.x, p.x - 5) + max(4 - p.y, p.y - 5)); }
+inline int PushClose(Pos a, Pos b) { return 140 - 20 * Distance(a, b); }
+inline double FromStrong(int strong, double v) { return strong == WHITE ? v : -v; }
+
+double EvaluateDraw(int) { return 0; }
+
+double EvaluateKPK(int strong) {
+    EndgamePieces e;
+    Pos pawn = e.pieces[strong][PAWN][0];
+    if (!ProbeKPK(strong, currentPlayer, e.king[strong], pawn, e.king[1 - strong])) return 0;
+    int rank = (strong == WHITE) ? pawn.y : 9 - pawn.y;
+    return FromStrong(strong, KNOWN_WIN + pieceValue[PAWN] + 10 * rank);
+}
+
+// 对光杆王：把弱方王赶到边上、强方王靠近
+double EvaluateKXK(int strong) {
+    EndgamePieces e;
+    double material = 0;
+    for (int t = PAWN; t <= QUEEN; ++t) material += e.pieces[strong][t].size() * pieceValue[t];
+    Pos wk = e.king[1 - strong];
+    return FromStrong(strong, KNOWN_WIN + material + PushToEdge(wk) + PushClose(e.king[strong], wk));
+}
+
+// KBNK：只能在与象同色的角上将死，按到这两个角的距离引导
+double EvaluateKBNK(int strong) {
+    EndgamePieces e;
+    Pos wk = e.king[1 - strong];
+    bool darkBishop = SquareColor(e.pieces[strong][BISHOP][0]) == 0;
+    int corner = darkBishop ? min(Distance(wk, Pos(1, 1)), Distance(wk, Pos(8, 8))) : min(Distance(wk, Pos(1, 8)), Distance(wk, Pos(8, 1)));
+    double v = KNOWN_WIN + pieceValue[BISHOP] + pieceValue[KNIGHT] + 40 * (7 - corner) + PushClose(e.king[strong], wk);
+    return FromStrong(strong, v);
+}
+
+// 异色格象 (只剩象与兵)：兵数差不超过 1 时基本和棋
+double ScaleOppositeBishops(int) {
+    EndgamePieces e;
+    if (SquareColor(e.pieces[WHITE][BISHOP][0]) == SquareColor(e.pieces[BLACK][BISHOP][0])) return 1.0;
+    int diff = abs((int)e.pieces[WHITE][PAWN].size() - (int)e.pieces[BLACK][PAWN].size());
+    return diff <= 1 ? 0.25 : 0.5;
+}
+
+// 象与错误颜色的边兵：兵全在 a 线或全在 h 线，升变格与象异色且弱方王守住升变格
+double ScaleWrongRookPawn(int strong) {
+    EndgamePieces e;
+    const vector<Pos>& pawns = e.pieces[strong][PAWN];
+    int file = pawns[0].x;
+    if (file != 1 && file != 8) return 1.0;
+    for (const auto& p : pawns) if (p.x != file) return 1.0;
+    Pos queening(file, strong == WHITE ? 8 : 1);
+    if (SquareColor(e.pieces[strong][BISHOP][0]) == SquareColor(queening)) return 1.0;
+    return Distance(e.king[1 - strong], queening) <= 1 ? 0.0 : 1.0;
+}
+
+// --- 子力键与登记表 ---
+// 子力键：白方 P N B R Q 与黑方 P N B R Q 的数量各占 4 位
+uint64_t MaterialKey(const int counts[16]) {
+    uint64_t key = 0;
+    for (int t = PAWN; t <= QUEEN; ++t) {
+        key |= (uint64_t)counts[t] << (4 * (t - 1));
+        key |= (uint64_t)counts[t | COLOR_MASK] << (4 * (t + 4));
+    }
+    return key;
+}
+
+const int ENDGAME_TABLE_BITS = 12;
+EndgameEntry endgameTable[1 << ENDGAME_TABLE_BITS];
+inline size_t EndgameSlot(uint64_t key) { return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - ENDGAME_TABLE_BITS)); }
+
+const EndgameEntry* ProbeEndgame(uint64_t materialKey) {
+    for (size_t i = EndgameSlot(materialKey);; i = (i + 1) & ((1 << ENDGAME_TABLE_BITS) - 1)) {
+        const EndgameEntry& e = endgameTable[i];
+        if (!e.evaluate && !e.scale) return nullptr;
+        if (e.key == materialKey) return &e;
+    }
+}
+
+// 静态初始化期间不依赖其它翻译单元的全局表 (charToPiece 可能尚未构造)
+inline int SignaturePieceType(char c) { return (int)(strchr("PNBRQK", c) - "PNBRQK") + 1; }
+
+struct EndgameRegistry {
+    // sig 形如 "KBNK"：第二个 K 之前是强方的子；同时登记黑方为强方的镜像
+    void Add(const string& sig, EndgameEvalFn evaluate, EndgameScaleFn scale = nullptr) {
+        size_t split = sig.find('K', 1);
+        for (int strong = WHITE; strong <= BLACK; ++strong) {
+            int counts[16] = {0};
+            for (size_t i = 0; i < sig.size(); ++i) {
+                int color = (i < split) ? strong : 1 - strong;
+                counts[SignaturePieceType(sig[i]) | (color * COLOR_MASK)]++;
+            }
+            EndgameEntry entry;
+            entry.key = MaterialKey(counts);
+            entry.evaluate = evaluate;
+            entry.scale = scale;
+            entry.strong = strong;
+            size_t i = EndgameSlot(entry.key);
+            while ((endgameTable[i].evaluate || endgameTable[i].scale) && endgameTable[i].key != entry.key) i = (i + 1) & ((1 << ENDGAME_TABLE_BITS) - 1);
+            endgameTable[i] = entry;
+        }
+    }
+    EndgameRegistry() {
+        Add("KK", EvaluateDraw);
+        Add("KNK", EvaluateDraw);
+        Add("KBK", EvaluateDraw);
+        Add("KNNK", EvaluateDraw);
+        Add("KPK", EvaluateKPK);
+        Add("KBNK", EvaluateKBNK);
+        // 有车或后 (可带其它子与兵) 对光杆王
+        for (int q = 0; q <= 2; ++q) for (int r = 0; r <= 2; ++r) for (int b = 0; b <= 2; ++b) for (int n = 0; n <= 2; ++n) for (int p = 0; p <= 8; ++p) {
+            if (q + r == 0) continue;
+            Add("K" + string(q, 'Q') + string(r, 'R') + string(b, 'B') + string(n, 'N') + string(p, 'P') + "K", EvaluateKXK);
+        }
+        for (int p = 1; p <= 8; ++p) Add("KB" + string(p, 'P') + "K", nullptr, ScaleWrongRookPawn);
+        for (int w = 0; w <= 8; ++w) for (int b = 0; b <= w; ++b) Add("KB" + string(w, 'P') + "KB" + string(b, 'P'), nullptr, ScaleOppositeBishops);
+    }
+} endgameRegistry;
@@ -0,0 +1,1500 @@
+// engine.cpp
+//Starfish --- chess engine developed by dsyoier
+//引擎核心：局面状态、走子生成、评估、搜索、统计与剖析
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <mutex>
+#include <cmath>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#ifdef STARFISH_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+using namespace std;
+
+// --- 全局游戏状态 (每线程一份，供并发对局使用) ---
+thread_local int board[10][10];
+thread_local int currentPlayer;
+thread_local Pos enPassantTarget;
+thread_local int castlingRights;
+thread_local int Round;
+thread_local int halfmoveClock;
+
+// --- 局面历史记录，用于三次重复检测 ---
+thread_local map<string, int> positionHistory;
+thread_local bool trackPositionHistory = true;   // 批量重放 PGN 时可关闭以省去每步生成局面键
+
+
+// --- 棋子静态数据 ---
+thread_local int pieceValue[] = {0, 100, 375, 397, 613, 1220, 20000};
+const map<int, char> pieceChar = {
+    {W_PAWN, 'P'}, {W_KNIGHT, 'N'}, {W_BISHOP, 'B'}, {W_ROOK, 'R'}, {W_QUEEN, 'Q'}, {W_KING, 'K'},
+    {B_PAWN, 'p'}, {B_KNIGHT, 'n'}, {B_BISHOP, 'b'}, {B_ROOK, 'r'}, {B_QUEEN, 'q'}, {B_KING, 'k'},
+    {EMPTY_PIECE, '.'}
+};
+const map<char, int> charToPiece = {
+    {'P', W_PAWN}, {'N', W_KNIGHT}, {'B', W_BISHOP}, {'R', W_ROOK}, {'Q', W_QUEEN}, {'K', W_KING},
+    {'p', B_PAWN}, {'n', B_KNIGHT}, {'b', B_BISHOP}, {'r', B_ROOK}, {'q', B_QUEEN}, {'k', B_KING}
+};
+Pos knight_deltas[] = {{1,2}, {1,-2}, {-1,2}, {-1,-2}, {2,1}, {2,-1}, {-2,1}, {-2,-1}};
+Pos bishop_deltas[] = {{1,1}, {1,-1}, {-1,1}, {-1,-1}};
+Pos rook_deltas[]   = {{1,0}, {-1,0}, {0,1}, {0,-1}};
+Pos king_deltas[]   = {{1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {1,-1}, {-1,1}, {-1,-1}};
+
+// --- 棋子位置表 (Piece-Square Tables，可被参数文件按线程覆盖) ---
+thread_local int pawn_pst_mg[64] = {0,0,0,0,0,0,0,0,50,50,50,50,50,50,50,50,10,10,20,30,30,20,10,10,5,5,10,25,25,10,5,5,0,0,0,20,20,0,0,0,5,-5,-10,0,0,-10,-5,5,5,10,10,-20,-20,10,10,5,0,0,0,0,0,0,0,0};
+thread_local int pawn_pst_eg[64] = {0,0,0,0,0,0,0,0,80,80,80,80,80,80,80,80,50,50,50,50,50,50,50,50,30,30,30,30,30,30,30,30,20,20,20,20,20,20,20,20,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,0,0,0,0,0,0,0,0};
+thread_local int knight_pst_mg[64] = {-250,-40,-30,-30,-30,-30,-40,-250,-40,-20,0,0,0,0,-20,-40,-30,0,10,15,15,10,0,-30,-30,5,15,20,20,15,5,-30,-30,0,15,20,20,15,0,-30,-30,5,10,15,15,10,5,-30,-40,-20,0,5,5,0,-20,-40,-250,-40,-30,-30,-30,-30,-40,-250};
+thread_local int knight_pst_eg[64] = {-50,-30,-20,-20,-20,-20,-30,-50,-30,-10,0,5,5,0,-10,-30,-20,0,5,10,10,5,0,-20,-20,5,10,15,15,10,5,-20,-20,5,10,15,15,10,5,-20,-20,0,5,10,10,5,0,-20,-30,-10,0,5,5,0,-10,-30,-50,-30,-20,-20,-20,-20,-30,-50};
+thread_local int bishop_pst_mg[64] = {-20,-10,-10,-10,-10,-10,-10,-20,-10,0,0,0,0,0,0,-10,-10,0,5,10,10,5,0,-10,-10,5,5,10,10,5,5,-10,-10,0,10,10,10,10,0,-10,-10,10,10,10,10,10,10,-10,-10,5,0,0,0,0,5,-10,-20,-10,-10,-10,-10,-10,-10,-20};
+thread_local int bishop_pst_eg[64] = {-20,-10,-10,-10,-10,-10,-10,-20,-10,0,5,0,0,5,0,-10,-10,5,5,5,5,5,5,-10,-10,0,5,5,5,5,0,-10,-10,5,5,5,5,5,5,-10,-10,0,5,0,0,5,0,-10,-10,0,0,0,0,0,0,-10,-20,-10,-10,-10,-10,-10,-10,-20};
+thread_local int rook_pst_mg[64] = {0,0,0,0,0,0,0,0,5,10,10,10,10,10,10,5,-5,0,0,0,0,0,0,-5,-5,0,0,0,0,0,0,-5,-5,0,0,0,0,0,0,-5,-5,0,0,0,0,0,0,-5,-5,0,0,0,0,0,0,-5,0,0,0,5,5,0,0,0};
+thread_local int rook_pst_eg[64] = {10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,10,10,10,10,10,10,10,10};
+thread_local int queen_pst_mg[64] = {-20,-10,-10,-5,-5,-10,-10,-20,-10,0,0,0,0,0,0,-10,-10,0,5,5,5,5,0,-10,-5,0,5,5,5,5,0,-5,0,0,5,5,5,5,0,-5,-10,5,5,5,5,5,0,-10,-10,0,5,0,0,0,0,-10,-20,-10,-10,-5,-5,-10,-10,-20};
+thread_local int queen_pst_eg[64] = {-20,-10,-10,-5,-5,-10,-10,-20,-10,0,0,0,0,0,0,-10,-10,0,5,5,5,5,0,-10,-5,0,5,5,5,5,0,-5,0,0,5,5,5,5,0,-5,-10,5,5,5,5,5,0,-10,-10,0,5,0,0,0,0,-10,-20,-10,-10,-5,-5,-10,-10,-20};
+thread_local int king_pst_mg[64] = {-30,-40,-40,-50,-50,-40,-40,-30,-30,-40,-40,-50,-50,-40,-40,-30,-30,-40,-40,-50,-50,-40,-40,-30,-30,-40,-40,-50,-50,-40,-40,-30,-20,-30,-30,-40,-40,-30,-30,-20,-10,-20,-20,-20,-20,-20,-20,-10,20,20,0,0,0,0,20,20,20,30,10,0,0,10,30,20};
+thread_local int king_pst_eg[64] = {-50,-40,-30,-20,-20,-30,-40,-50,-30,-20,-10,0,0,-10,-20,-30,-30,-10,20,30,30,20,-10,-30,-30,-10,30,40,40,30,-10,-30,-30,-10,30,40,40,30,-10,-30,-30,-10,20,30,30,20,-10,-30,-30,-30,0,0,0,0,-30,-30,-50,-30,-30,-30,-30,-30,-30,-50};
+
+// --- 性能剖析 (以 -DSTARFISH_PROFILE 编译时启用；未启用时 PROFILE_SCOPE 展开为空) ---
+#ifdef STARFISH_PROFILE
+enum ProfileSection {
+    PROF_GENERATE_MOVES, PROF_MAKE_MOVE, PROF_UNMAKE_MOVE, PROF_POSITION_KEY, PROF_SQUARE_ATTACKED,
+    PROF_EVALUATE, PROF_PST, PROF_POSITIONAL, PROF_SORT, PROF_SECTION_COUNT
+};
+const char* profileSectionNames[PROF_SECTION_COUNT] = {
+    "GenerateMoves", "MakeMove", "UnmakeMove", "GeneratePositionKey", "IsSquareAttacked",
+    "Evaluate", "GetPSTValue", "EvaluatePositional", "sort (move ordering)"
+};
+struct ProfileCounters {
+    uint64_t cycles[PROF_SECTION_COUNT];
+    uint64_t calls[PROF_SECTION_COUNT];
+    uint64_t searchCycles, searches;
+    uint64_t allocations, allocatedBytes;
+};
+thread_local ProfileCounters profileCounters;   // 零初始化；每个线程各自计数
+
+inline uint64_t ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+struct ProfileScope {
+    int section;
+    uint64_t start;
+    explicit ProfileScope(int s) : section(s), start(ReadCycleCounter()) {}
+    ~ProfileScope() {
+        uint64_t elapsed = ReadCycleCounter() - start;
+        if (section == PROF_SECTION_COUNT) { profileCounters.searchCycles += elapsed; profileCounters.searches++; }
+        else { profileCounters.cycles[section] += elapsed; profileCounters.calls[section]++; }
+    }
+};
+#define PROFILE_SCOPE(section) ProfileScope profileScope(section)
+#define PROFILE_SEARCH() ProfileScope profileSearchScope(PROF_SECTION_COUNT)
+
+void ResetProfile() { memset(&profileCounters, 0, sizeof(profileCounters)); }
+void PrintProfile(long long nodes) {
+    const ProfileCounters& p = profileCounters;
+    double total = (double)max<uint64_t>(1, p.searchCycles);
+    cout << "Profile: " << p.searches << " searches, " << fixed << setprecision(1) << p.searchCycles / 1e6 << " Mcycles in search"
+         << " (inclusive times; nested sections are also counted in their callers)" << endl;
+    cout << left << setw(24) << "Section" << right << setw(14) << "Calls" << setw(14) << "Mcycles" << setw(14) << "Cycles/call" << setw(10) << "Search%" << endl;
+    for (int i = 0; i < PROF_SECTION_COUNT; ++i) {
+        cout << left << setw(24) << profileSectionNames[i] << right << setw(14) << p.calls[i] << setw(14) << p.cycles[i] / 1e6
+             << setw(14) << (p.calls[i] ? (double)p.cycles[i] / p.calls[i] : 0.0) << setw(9) << 100.0 * p.cycles[i] / total << "%" << endl;
+    }
+    cout << "Heap allocations: " << p.allocations << " (" << p.allocatedBytes << " bytes)";
+    if (nodes > 0) cout << ", " << setprecision(2) << (double)p.allocations / nodes << " per node";
+    cout << defaultfloat << setprecision(6) << endl;
+}
+
+// 统计堆分配：替换全局 operator new/delete，计入当前线程
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"   // GCC 把替换后的 new/delete 与 malloc/free 配对误报
+#endif
+void* operator new(size_t size) {
+    profileCounters.allocations++;
+    profileCounters.allocatedBytes += size;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+#else
+#define PROFILE_SCOPE(section) ((void)0)
+#define PROFILE_SEARCH() ((void)0)
+#endif
+
+// --- FEN 开局库 ---
+map<string, string> openingBook;
+
+// --- 生成用于三同检测的局面唯一键 ---
+string GeneratePositionKey() {
+    PROFILE_SCOPE(PROF_POSITION_KEY);
+    stringstream key;
+    for (int y = 8; y >= 1; --y) {
+        int empty_count = 0;
+        for (int x = 1; x <= 8; ++x) {
+            int piece = board[x][y];
+            if (piece == EMPTY_PIECE) { empty_count++; } else {
+                if (empty_count > 0) { key << empty_count; empty_count = 0; }
+                key << pieceChar.at(piece);
+            }
+        }
+        if (empty_count > 0) { key << empty_count; }
+        if (y > 1) { key << '/'; }
+    }
+    key << (currentPlayer == WHITE ? " w " : " b ");
+    string castle_str;
+    if (castlingRights & WK_CASTLE) castle_str += 'K';
+    if (castlingRights & WQ_CASTLE) castle_str += 'Q';
+    if (castlingRights & BK_CASTLE) castle_str += 'k';
+    if (castlingRights & BQ_CASTLE) castle_str += 'q';
+    key << (castle_str.empty() ? "-" : castle_str) << " ";
+    if (enPassantTarget.ok()) { key << (char)('a' + enPassantTarget.x - 1) << (char)('0' + enPassantTarget.y); } else { key << "-"; }
+    return key.str();
+}
+
+string GenerateFEN() {
+    string key = GeneratePositionKey();
+    stringstream fen;
+    fen << key << " " << halfmoveClock << " " << Round;
+    return fen.str();
+}
+// --- Zobrist 局面哈希 (固定种子：磁盘上的局面索引依赖其跨版本稳定) ---
+uint64_t zobristPiece[16][64];
+uint64_t zobristCastling[16];
+uint64_t zobristEnPassant[9];
+uint64_t zobristSide;
+struct ZobristInit {
+    ZobristInit() {
+        uint64_t state = 0x5374617266697368ULL;
+        auto next = [&]() { uint64_t z = (state += 0x9E3779B97F4A7C15ULL); z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL; z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL; return z ^ (z >> 31); };
+        for (auto& row : zobristPiece) for (auto& v : row) v = next();
+        for (auto& v : zobristCastling) v = next();
+        for (auto& v : zobristEnPassant) v = next();
+        zobristSide = next();
+    }
+} zobristInit;
+
+uint64_t ComputePositionHash() {
+    uint64_t h = 0;
+    for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) if (board[x][y] != EMPTY_PIECE) h ^= zobristPiece[board[x][y]][(y - 1) * 8 + (x - 1)];
+    h ^= zobristCastling[castlingRights];
+    if (enPassantTarget.ok()) h ^= zobristEnPassant[enPassantTarget.x];
+    if (currentPlayer == BLACK) h ^= zobristSide;
+    return h;
+}
+
+void LoadOpeningBook() {
+    ifstream bookFile("opening_book.txt");
+    if (!bookFile.is_open()) { cout << "info string Opening book file 'opening_book.txt' not found." << endl; return; }
+    string line;
+    int count = 0;
+    while (getline(bookFile, line)) {
+        size_t first_space = line.find(' ');
+        if (first_space != string::npos) {
+            size_t last_space = line.rfind(' ');
+            if(last_space != string::npos && last_space > first_space) {
+                string fen = line.substr(0, last_space);
+                string uci_move = line.substr(last_space + 1);
+                openingBook[fen] = uci_move;
+                count++;
+            }
+        }
+    }
+    cout << "info string Loaded " << count << " positions from FEN opening book." << endl;
+    bookFile.close();
+}
+
+
+// --- 辅助函数 ---
+void ResetPositionHistory() {
+    positionHistory.clear();
+    positionHistory[GeneratePositionKey()]++;
+}
+// --- 核心功能函数 ---
+void SetBoard() {
+    memset(board, 0, sizeof(board));
+    board[1][1]=W_ROOK; board[2][1]=W_KNIGHT; board[3][1]=W_BISHOP; board[4][1]=W_QUEEN; board[5][1]=W_KING; board[6][1]=W_BISHOP; board[7][1]=W_KNIGHT; board[8][1]=W_ROOK;
+    for (int i=1; i<=8; i++) board[i][2]=W_PAWN;
+    board[1][8]=B_ROOK; board[2][8]=B_KNIGHT; board[3][8]=B_BISHOP; board[4][8]=B_QUEEN; board[5][8]=B_KING; board[6][8]=B_BISHOP; board[7][8]=B_KNIGHT; board[8][8]=B_ROOK;
+    for (int i=1; i<=8; i++) board[i][7]=B_PAWN;
+    currentPlayer = WHITE; castlingRights = WK_CASTLE | WQ_CASTLE | BK_CASTLE | BQ_CASTLE; enPassantTarget = Pos(0,0); Round = 1;
+    halfmoveClock = 0;
+    ResetPositionHistory();
+}
+void LoadFEN(const string& fen) {
+    memset(board, 0, sizeof(board));
+    stringstream ss(fen);
+    string piece_placement, active_color, castling, en_passant, halfmove, fullmove;
+    ss >> piece_placement >> active_color >> castling >> en_passant >> halfmove >> fullmove;
+
+    int x = 1, y = 8;
+    for (char c : piece_placement) {
+        if (c == '/') { y--; x = 1; }
+        else if (isdigit(c)) { x += (c - '0'); }
+        else { auto it = charToPiece.find(c); board[x++][y] = (it != charToPiece.end()) ? it->second : EMPTY_PIECE; }
+    }
+    currentPlayer = (active_color == "w") ? WHITE : BLACK;
+    castlingRights = 0;
+    for (char c : castling) {
+        if (c == 'K') castlingRights |= WK_CASTLE;
+        else if (c == 'Q') castlingRights |= WQ_CASTLE;
+        else if (c == 'k') castlingRights |= BK_CASTLE;
+        else if (c == 'q') castlingRights |= BQ_CASTLE;
+    }
+    if (en_passant == "-") { enPassantTarget = Pos(0, 0); }
+    else { enPassantTarget = Pos(en_passant[0] - 'a' + 1, en_passant[1] - '0'); }
+    try {
+        halfmoveClock = stoi(halfmove);
+        Round = stoi(fullmove);
+    } catch (const std::invalid_argument& ia) {
+        halfmoveClock = 0;
+        Round = 1;
+    }
+    ResetPositionHistory();
+}
+
+// --- 走子生成、着法执行与攻击检测按颜色特化：兵的方向、起始/升变横排与易位横排都是编译期常量，对外接口只按颜色分派一次 ---
+template <int By>
+bool IsSquareAttackedBy(Pos p) {
+    PROFILE_SCOPE(PROF_SQUARE_ATTACKED);
+    const int color = By * COLOR_MASK;
+    const int pawnDir = (By == WHITE) ? 1 : -1;
+    Pos a1 = {p.x - 1, p.y - pawnDir};
+    if (a1.ok() && board[a1.x][a1.y] == (PAWN | color)) return true;
+    Pos a2 = {p.x + 1, p.y - pawnDir};
+    if (a2.ok() && board[a2.x][a2.y] == (PAWN | color)) return true;
+    for (const auto& d : knight_deltas) {
+        Pos target = {p.x + d.x, p.y + d.y};
+        if (target.ok() && board[target.x][target.y] == (KNIGHT | color)) return true;
+    }
+    for (const auto& d : king_deltas) {
+        Pos target = {p.x + d.x, p.y + d.y};
+        if (target.ok() && board[target.x][target.y] == (KING | color)) return true;
+    }
+    for (const auto& d : rook_deltas) {
+        for (int i = 1; i < 8; i++) {
+            Pos target = {p.x + d.x * i, p.y + d.y * i};
+            if (!target.ok()) break;
+            int piece = board[target.x][target.y];
+            if (piece != EMPTY_PIECE) {
+                if (piece == (ROOK | color) || piece == (QUEEN | color)) return true;
+                break;
+            }
+        }
+    }
+    for (const auto& d : bishop_deltas) {
+        for (int i = 1; i < 8; i++) {
+            Pos target = {p.x + d.x * i, p.y + d.y * i};
+            if (!target.ok()) break;
+            int piece = board[target.x][target.y];
+            if (piece != EMPTY_PIECE) {
+                if (piece == (BISHOP | color) || piece == (QUEEN | color)) return true;
+                break;
+            }
+        }
+    }
+    return false;
+}
+bool IsSquareAttacked(Pos p, int attackerCamp) {
+    if (attackerCamp == WHITE) return IsSquareAttackedBy<WHITE>(p);
+    if (attackerCamp == BLACK) return IsSquareAttackedBy<BLACK>(p);
+    return false;
+}
+
+template <int Us, bool CapturesOnly>
+void GenerateMovesFor(vector<Move>& moves) {
+    PROFILE_SCOPE(PROF_GENERATE_MOVES);
+    const int Them = 1 - Us;
+    const int color = Us * COLOR_MASK;
+    const int pawnDir = (Us == WHITE) ? 1 : -1;
+    const int startRank = (Us == WHITE) ? 2 : 7;
+    const int promotionRank = (Us == WHITE) ? 8 : 1;
+    const int homeRank = (Us == WHITE) ? 1 : 8;
+    moves.clear();
+    for (int x = 1; x <= 8; x++) {
+        for (int y = 1; y <= 8; y++) {
+            int piece = board[x][y];
+            if (piece == EMPTY_PIECE || (piece & COLOR_MASK) != color) continue;
+            int pieceType = piece & PIECE_TYPE_MASK;
+            Pos from = {x, y};
+            switch (pieceType) {
+                case PAWN: {
+                    Pos to1 = {x, y + pawnDir};
+                    if (!CapturesOnly && to1.ok() && board[to1.x][to1.y] == EMPTY_PIECE) {
+                        if (to1.y == promotionRank) {
+                            moves.push_back({from, to1, QUEEN | color}); moves.push_back({from, to1, ROOK | color}); moves.push_back({from, to1, BISHOP | color}); moves.push_back({from, to1, KNIGHT | color});
+                        } else { moves.push_back({from, to1}); }
+                    }
+                    if (!CapturesOnly && y == startRank && board[x][y + pawnDir] == EMPTY_PIECE && board[x][y + 2 * pawnDir] == EMPTY_PIECE) {
+                        moves.push_back({from, {x, y + 2 * pawnDir}});
+                    }
+                    Pos to_eat[] = {{x - 1, y + pawnDir}, {x + 1, y + pawnDir}};
+                    for (const auto& to_e : to_eat) {
+                        if (to_e.ok()) {
+                            int targetPiece = board[to_e.x][to_e.y];
+                            if (targetPiece != EMPTY_PIECE && (targetPiece & COLOR_MASK) != color) {
+                                if (to_e.y == promotionRank) {
+                                    moves.push_back({from, to_e, QUEEN | color}); moves.push_back({from, to_e, ROOK | color}); moves.push_back({from, to_e, BISHOP | color}); moves.push_back({from, to_e, KNIGHT | color});
+                                } else { moves.push_back({from, to_e}); }
+                            }
+                        }
+                    }
+                    if (enPassantTarget.ok() && ((abs(x - enPassantTarget.x) == 1) && (y + pawnDir == enPassantTarget.y))) {
+                         moves.push_back({from, enPassantTarget});
+                    }
+                    break;
+                }
+                case KNIGHT: case KING: {
+                    Pos* deltas = (pieceType == KNIGHT) ? knight_deltas : king_deltas;
+                    for (int i = 0; i < 8; i++) {
+                        Pos to = {x + deltas[i].x, y + deltas[i].y};
+                        if (to.ok()) {
+                            int targetPiece = board[to.x][to.y];
+                            if (targetPiece == EMPTY_PIECE) {
+                                if (!CapturesOnly) moves.push_back({from, to});
+                            } else if ((targetPiece & COLOR_MASK) != color) {
+                                moves.push_back({from, to});
+                            }
+                        }
+                    }
+                    if (!CapturesOnly && pieceType == KING) {
+                        const int rank = homeRank;
+                        if (!IsSquareAttackedBy<Them>({x,y})) {
+                            if ((castlingRights & (Us == WHITE ? WK_CASTLE : BK_CASTLE)) && board[x + 1][rank] == EMPTY_PIECE && board[x + 2][rank] == EMPTY_PIECE && !IsSquareAttackedBy<Them>({x + 1, rank}) && !IsSquareAttackedBy<Them>({x + 2, rank})) {
+                                moves.push_back({from, {x + 2, rank}});
+                            }
+                            if ((castlingRights & (Us == WHITE ? WQ_CASTLE : BQ_CASTLE)) && board[x - 1][rank] == EMPTY_PIECE && board[x - 2][rank] == EMPTY_PIECE && board[x - 3][rank] == EMPTY_PIECE && !IsSquareAttackedBy<Them>({x - 1, rank}) && !IsSquareAttackedBy<Them>({x - 2, rank})) {
+                                moves.push_back({from, {x - 2, rank}});
+                            }
+                        }
+                    }
+                    break;
+                }
+                case BISHOP: case ROOK: case QUEEN: {
+                    Pos* deltas; int end_idx = 0;
+                    if (pieceType == BISHOP) { deltas = bishop_deltas; end_idx = 4; } else if (pieceType == ROOK) { deltas = rook_deltas; end_idx = 4; } else { deltas = king_deltas; end_idx = 8; }
+                    for (int i = 0; i < end_idx; i++) {
+                        for (int j = 1; j < 8; j++) {
+                            Pos to = {x + deltas[i].x * j, y + deltas[i].y * j};
+                            if (!to.ok()) break;
+                            int targetPiece = board[to.x][to.y];
+                            if (targetPiece == EMPTY_PIECE) {
+                                if (!CapturesOnly) moves.push_back({from, to});
+                            } else {
+                                if ((targetPiece & COLOR_MASK) != color) { moves.push_back({from, to}); }
+                                break;
+                            }
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}
+void GenerateMoves(vector<Move>& moves, bool capturesOnly) {
+    if (currentPlayer == WHITE) { if (capturesOnly) GenerateMovesFor<WHITE, true>(moves); else GenerateMovesFor<WHITE, false>(moves); }
+    else { if (capturesOnly) GenerateMovesFor<BLACK, true>(moves); else GenerateMovesFor<BLACK, false>(moves); }
+}
+
+// Us 为走子一方 (即调用前的 currentPlayer)
+template <int Us>
+UndoInfo MakeMoveFor(const Move& move) {
+    PROFILE_SCOPE(PROF_MAKE_MOVE);
+    const int Them = 1 - Us;
+    const int pawnDir = (Us == WHITE) ? 1 : -1;
+    const int homeRank = (Us == WHITE) ? 1 : 8;
+    const int theirHomeRank = (Us == WHITE) ? 8 : 1;
+    const int ourRook = ROOK | (Us * COLOR_MASK), theirRook = ROOK | (Them * COLOR_MASK);
+    const int ourCastling = (Us == WHITE) ? (WK_CASTLE | WQ_CASTLE) : (BK_CASTLE | BQ_CASTLE);
+    const int ourKingSide = (Us == WHITE) ? WK_CASTLE : BK_CASTLE, ourQueenSide = (Us == WHITE) ? WQ_CASTLE : BQ_CASTLE;
+    const int theirKingSide = (Us == WHITE) ? BK_CASTLE : WK_CASTLE, theirQueenSide = (Us == WHITE) ? BQ_CASTLE : WQ_CASTLE;
+    UndoInfo undo;
+    undo.capturedPiece = board[move.to.x][move.to.y];
+    undo.enPassantTarget = enPassantTarget;
+    undo.castlingRights = castlingRights;
+    undo.halfmoveClock = halfmoveClock;
+    int piece = board[move.from.x][move.from.y];
+    int pieceType = piece & PIECE_TYPE_MASK;
+    if (pieceType == PAWN || undo.capturedPiece != EMPTY_PIECE) { halfmoveClock = 0; } else { halfmoveClock++; }
+    board[move.to.x][move.to.y] = piece;
+    board[move.from.x][move.from.y] = EMPTY_PIECE;
+    enPassantTarget = Pos(0, 0);
+    if (pieceType == PAWN) {
+        if (abs(move.to.y - move.from.y) == 2) {
+            enPassantTarget = Pos(move.from.x, move.from.y + pawnDir);
+        } else if (move.to == undo.enPassantTarget && undo.enPassantTarget.ok()) {
+            int capturedPawnY = move.to.y - pawnDir;
+            undo.capturedPiece = board[move.to.x][capturedPawnY];
+            board[move.to.x][capturedPawnY] = EMPTY_PIECE;
+        } else if (move.promotion != EMPTY_PIECE) {
+            board[move.to.x][move.to.y] = move.promotion;
+        }
+    } else if (pieceType == KING) {
+        castlingRights &= ~ourCastling;
+        if (abs(move.to.x - move.from.x) == 2) {
+            if (move.to.x == 7) { board[6][homeRank] = board[8][homeRank]; board[8][homeRank] = EMPTY_PIECE;
+            } else { board[4][homeRank] = board[1][homeRank]; board[1][homeRank] = EMPTY_PIECE; }
+        }
+    } else if (piece == ourRook && move.from.y == homeRank) {
+        if (move.from.x == 1) castlingRights &= ~ourQueenSide;
+        else if (move.from.x == 8) castlingRights &= ~ourKingSide;
+    }
+    if (undo.capturedPiece == theirRook && move.to.y == theirHomeRank) {
+        if (move.to.x == 1) castlingRights &= ~theirQueenSide;
+        else if (move.to.x == 8) castlingRights &= ~theirKingSide;
+    }
+    currentPlayer = Them;
+    if (Us == BLACK) { Round++; }
+
+    if (trackPositionHistory) positionHistory[GeneratePositionKey()]++;
+
+    return undo;
+}
+UndoInfo MakeMove(const Move& move) {
+    return currentPlayer == WHITE ? MakeMoveFor<WHITE>(move) : MakeMoveFor<BLACK>(move);
+}
+
+// Us 为走了 move 的一方 (即调用时 currentPlayer 的对方)
+template <int Us>
+void UnmakeMoveFor(const Move& move, const UndoInfo& undo) {
+    PROFILE_SCOPE(PROF_UNMAKE_MOVE);
+    const int pawnDir = (Us == WHITE) ? 1 : -1;
+    const int homeRank = (Us == WHITE) ? 1 : 8;
+    if (trackPositionHistory) positionHistory[GeneratePositionKey()]--;
+
+    currentPlayer = Us;
+    int movedPiece;
+    if (move.promotion != EMPTY_PIECE) { movedPiece = PAWN | (Us * COLOR_MASK); } else { movedPiece = board[move.to.x][move.to.y]; }
+    board[move.from.x][move.from.y] = movedPiece;
+    board[move.to.x][move.to.y] = undo.capturedPiece;
+    int movedPieceType = movedPiece & PIECE_TYPE_MASK;
+    if (movedPieceType == PAWN && move.to == undo.enPassantTarget && undo.enPassantTarget.ok()) {
+        board[move.to.x][move.to.y] = EMPTY_PIECE;
+        board[move.to.x][move.to.y - pawnDir] = undo.capturedPiece;
+    } else if (movedPieceType == KING && abs(move.to.x - move.from.x) == 2) {
+        if (move.to.x == 7) { board[8][homeRank] = board[6][homeRank]; board[6][homeRank] = EMPTY_PIECE;
+        } else { board[1][homeRank] = board[4][homeRank]; board[4][homeRank] = EMPTY_PIECE; }
+    }
+    castlingRights = undo.castlingRights;
+    enPassantTarget = undo.enPassantTarget;
+    halfmoveClock = undo.halfmoveClock;
+    if (Us == BLACK) { Round--; }
+}
+void UnmakeMove(const Move& move, const UndoInfo& undo) {
+    if (currentPlayer == BLACK) UnmakeMoveFor<WHITE>(move, undo); else UnmakeMoveFor<BLACK>(move, undo);
+}
+
+// --- 评估函数部分 ---
+thread_local double DOUBLED_PAWN_PENALTY = -15.0;
+thread_local double ISOLATED_PAWN_PENALTY = -10.0;
+thread_local double PASSED_PAWN_BONUS[] = {0, 10, 20, 30, 50, 80, 120, 200}; 
+thread_local double BISHOP_PAIR_BONUS = 40.0;
+thread_local double ROOK_ON_SEMI_OPEN_FILE_BONUS = 15.0;
+thread_local double ROOK_ON_OPEN_FILE_BONUS = 30.0;
+thread_local double PAWN_SHIELD_PENALTY = -10.0; 
+
+// 局面阶段 phase 由调用者按全盘子数算出 (同一局面的所有棋子相同)
+inline double PSTValueAt(int piece, int x, int y, double phase) {
+    PROFILE_SCOPE(PROF_PST);
+    int piece_type = piece & PIECE_TYPE_MASK;
+    int color = PieceColorOf(piece);
+    int square_idx = (y - 1) * 8 + (x - 1);
+    if (color == BLACK) { square_idx = 63 - square_idx; }
+    const int* mg_table = nullptr; const int* eg_table = nullptr;
+    switch (piece_type) {
+        case PAWN:   mg_table = pawn_pst_mg;   eg_table = pawn_pst_eg;   break;
+        case KNIGHT: mg_table = knight_pst_mg; eg_table = knight_pst_eg; break;
+        case BISHOP: mg_table = bishop_pst_mg; eg_table = bishop_pst_eg; break;
+        case ROOK:   mg_table = rook_pst_mg;   eg_table = rook_pst_eg;   break;
+        case QUEEN:  mg_table = queen_pst_mg;  eg_table = queen_pst_eg;  break;
+        case KING:   mg_table = king_pst_mg;   eg_table = king_pst_eg;   break;
+        default: return 0;
+    }
+    double mg_score = mg_table[square_idx]; double eg_score = eg_table[square_idx];
+    return (mg_score * phase) + (eg_score * (1.0 - phase));
+}
+inline double GamePhase(int total_pieces) { return min(1.0, (total_pieces - 8) / 24.0); }
+
+double GetPSTValue(int piece, int x, int y) {
+    int total_pieces = 0;
+    for (int i = 1; i <= 8; ++i) for (int j = 1; j <= 8; ++j) if(board[i][j]!=EMPTY_PIECE) total_pieces++;
+    return PSTValueAt(piece, x, y, GamePhase(total_pieces));
+}
+
+// 一方的兵型：叠兵、孤兵与通路兵，按该方视角计分
+template <int Us>
+double EvaluatePawnsSide(const int (&pawnsOnFile)[2][9]) {
+    const int Them = 1 - Us;
+    const int ourPawn = PAWN | (Us * COLOR_MASK), theirPawn = PAWN | (Them * COLOR_MASK);
+    const int forward = (Us == WHITE) ? 1 : -1;
+    const int* ours = pawnsOnFile[Us];
+    double score = 0;
+    for (int i = 1; i <= 8; ++i) if (ours[i] > 1) score += (ours[i] - 1) * DOUBLED_PAWN_PENALTY;
+    for (int x = 1; x <= 8; ++x) {
+        if (ours[x] == 0) continue;
+        for (int y = 2; y <= 7; ++y) {
+            if (board[x][y] != ourPawn) continue;
+            if (ours[max(1, x - 1)] == 0 && ours[min(8, x + 1)] == 0) score += ISOLATED_PAWN_PENALTY;
+            bool is_passed = true;
+            for (int dx = -1; dx <= 1 && is_passed; ++dx) {
+                int check_x = x + dx; if (check_x < 1 || check_x > 8) continue;
+                for (int check_y = y + forward; check_y >= 1 && check_y <= 8; check_y += forward) {
+                    if (board[check_x][check_y] == theirPawn) { is_passed = false; break; }
+                }
+            }
+            if (is_passed) score += PASSED_PAWN_BONUS[(Us == WHITE ? y : 9 - y) - 1];
+        }
+    }
+    return score;
+}
+
+// 一方的子力位置：车的线路、双象与王前兵盾，按该方视角计分
+template <int Us>
+double EvaluatePiecesSide(const int (&pawnsOnFile)[2][9], int bishops, Pos king) {
+    const int Them = 1 - Us;
+    const int ourPawn = PAWN | (Us * COLOR_MASK), ourRook = ROOK | (Us * COLOR_MASK);
+    const int forward = (Us == WHITE) ? 1 : -1;
+    const int shieldRank = (Us == WHITE) ? 2 : 7;
+    const int* ours = pawnsOnFile[Us];
+    const int* theirs = pawnsOnFile[Them];
+    double score = 0;
+    for (int x = 1; x <= 8; ++x) {
+        if (ours[x] != 0) continue;
+        for (int y = 1; y <= 8; ++y) {
+            if (board[x][y] == ourRook) score += (theirs[x] == 0) ? ROOK_ON_OPEN_FILE_BONUS : ROOK_ON_SEMI_OPEN_FILE_BONUS;
+        }
+    }
+    if (bishops >= 2) score += BISHOP_PAIR_BONUS;
+    if (Us == WHITE ? king.y <= 2 : king.y >= 7) {
+        int firstFile = (king.x >= 6) ? 6 : (king.x <= 4 ? 1 : 0);
+        if (firstFile) {
+            for (int f = firstFile; f < firstFile + 3; ++f) {
+                if (board[f][shieldRank] != ourPawn) score += PAWN_SHIELD_PENALTY * 2;
+                else if (board[f][shieldRank + forward] == ourPawn) score += PAWN_SHIELD_PENALTY;
+            }
+        }
+    }
+    return score;
+}
+
+double EvaluatePositional() {
+    PROFILE_SCOPE(PROF_POSITIONAL);
+    int pawns_on_file[2][9] = {{0}};
+    int bishops[2] = {0, 0};
+    Pos king_pos[2];
+    for (int x = 1; x <= 8; ++x) {
+        for (int y = 1; y <= 8; ++y) {
+            int piece = board[x][y];
+            if (piece == EMPTY_PIECE) continue;
+            int piece_type = piece & PIECE_TYPE_MASK;
+            int color = PieceColorOf(piece);
+            if (piece_type == PAWN) pawns_on_file[color][x]++;
+            else if (piece_type == BISHOP) bishops[color]++;
+            else if (piece_type == KING) king_pos[color] = {x, y};
+        }
+    }
+    return EvaluatePawnsSide<WHITE>(pawns_on_file) - EvaluatePawnsSide<BLACK>(pawns_on_file)
+         + EvaluatePiecesSide<WHITE>(pawns_on_file, bishops[WHITE], king_pos[WHITE])
+         - EvaluatePiecesSide<BLACK>(pawns_on_file, bishops[BLACK], king_pos[BLACK]);
+}
+
+// --- 分层评估：子力与位置表 → 兵型 → 车的线路、双象与王前兵盾 ---
+// 每层之后按余下各层可能的最小与最大贡献得到完整分数的区间，区间整个落在窗口 (lo, hi) 之外时提前结束，
+// 返回区间靠近窗口的一端 (仍在窗口同侧的界)；有缩放系数的残局不提前结束。
+// 上下限是严格的：每个兵至多各计一次叠兵、孤兵与通路兵，每个车至多计一次线路奖励，王前兵盾每方三列、每列至多两倍罚分，
+// 双象已知。每兵、每车与兵盾的极值由当前参数算出，ApplyEvalParams 改变参数时重算。
+struct LazyEvalBounds { double pawnMin, pawnMax, rookMin, rookMax, shieldMin, shieldMax; };
+LazyEvalBounds ComputeLazyEvalBounds() {
+    LazyEvalBounds b;
+    double passedMin = 0, passedMax = 0;
+    for (int i = 1; i <= 6; ++i) { passedMin = min(passedMin, PASSED_PAWN_BONUS[i]); passedMax = max(passedMax, PASSED_PAWN_BONUS[i]); }
+    b.pawnMin = min(0.0, DOUBLED_PAWN_PENALTY) + min(0.0, ISOLATED_PAWN_PENALTY) + passedMin;
+    b.pawnMax = max(0.0, DOUBLED_PAWN_PENALTY) + max(0.0, ISOLATED_PAWN_PENALTY) + passedMax;
+    b.rookMin = min(0.0, min(ROOK_ON_OPEN_FILE_BONUS, ROOK_ON_SEMI_OPEN_FILE_BONUS));
+    b.rookMax = max(0.0, max(ROOK_ON_OPEN_FILE_BONUS, ROOK_ON_SEMI_OPEN_FILE_BONUS));
+    b.shieldMin = 3 * min(0.0, 2 * PAWN_SHIELD_PENALTY);
+    b.shieldMax = 3 * max(0.0, 2 * PAWN_SHIELD_PENALTY);
+    return b;
+}
+thread_local LazyEvalBounds lazyEvalBounds = ComputeLazyEvalBounds();
+thread_local bool lazyEvalEnabled = true;
+thread_local long long lazyEvalCalls = 0, lazyEvalExits[2] = {0, 0};
+
+double EvaluateTiered(double lo, double hi, bool& exact) {
+    PROFILE_SCOPE(PROF_EVALUATE);
+    exact = true;
+    int total_pieces = 0;
+    for (int x = 1; x <= 8; x++) for (int y = 1; y <= 8; y++) if (board[x][y] != EMPTY_PIECE) total_pieces++;
+    double phase = GamePhase(total_pieces);
+    double score = 0;
+    int counts[16] = {0};
+    int pawns_on_file[2][9] = {{0}};
+    int bishops[2] = {0, 0};
+    Pos king_pos[2];
+    for (int x = 1; x <= 8; x++) {
+        for (int y = 1; y <= 8; y++) {
+            int piece = board[x][y];
+            if (piece == EMPTY_PIECE) continue;
+            counts[piece]++;
+            int pieceColor = PieceColorOf(piece);
+            int pieceType = piece & PIECE_TYPE_MASK;
+            if (pieceType == PAWN) pawns_on_file[pieceColor][x]++;
+            else if (pieceType == BISHOP) bishops[pieceColor]++;
+            else if (pieceType == KING) king_pos[pieceColor] = {x, y};
+            double current_score = pieceValue[pieceType] + PSTValueAt(piece, x, y, phase);
+            score += (pieceColor == WHITE) ? current_score : -current_score;
+        }
+    }
+    const EndgameEntry* endgame = ProbeEndgame(MaterialKey(counts));
+    if (endgame && endgame->evaluate) return endgame->evaluate(endgame->strong);
+    const bool lazy = !endgame;
+    const LazyEvalBounds& lb = lazyEvalBounds;
+    // 余下两层相对白方的贡献区间
+    int pawns[2] = {counts[W_PAWN], counts[B_PAWN]}, rooks[2] = {counts[W_ROOK], counts[B_ROOK]};
+    double pair = (bishops[WHITE] >= 2 ? BISHOP_PAIR_BONUS : 0) - (bishops[BLACK] >= 2 ? BISHOP_PAIR_BONUS : 0);
+    double pieceLo = rooks[WHITE] * lb.rookMin - rooks[BLACK] * lb.rookMax + lb.shieldMin - lb.shieldMax + pair;
+    double pieceHi = rooks[WHITE] * lb.rookMax - rooks[BLACK] * lb.rookMin + lb.shieldMax - lb.shieldMin + pair;
+    double pawnLo = pawns[WHITE] * lb.pawnMin - pawns[BLACK] * lb.pawnMax;
+    double pawnHi = pawns[WHITE] * lb.pawnMax - pawns[BLACK] * lb.pawnMin;
+    if (lazy && score + pawnLo + pieceLo >= hi) { exact = false; lazyEvalExits[0]++; return score + pawnLo + pieceLo; }
+    if (lazy && score + pawnHi + pieceHi <= lo) { exact = false; lazyEvalExits[0]++; return score + pawnHi + pieceHi; }
+    {
+        PROFILE_SCOPE(PROF_POSITIONAL);
+        score += EvaluatePawnsSide<WHITE>(pawns_on_file) - EvaluatePawnsSide<BLACK>(pawns_on_file);
+        if (lazy && score + pieceLo >= hi) { exact = false; lazyEvalExits[1]++; return score + pieceLo; }
+        if (lazy && score + pieceHi <= lo) { exact = false; lazyEvalExits[1]++; return score + pieceHi; }
+        score += EvaluatePiecesSide<WHITE>(pawns_on_file, bishops[WHITE], king_pos[WHITE])
+               - EvaluatePiecesSide<BLACK>(pawns_on_file, bishops[BLACK], king_pos[BLACK]);
+    }
+    if (endgame && endgame->scale) score *= endgame->scale(endgame->strong);
+    return score;
+}
+
+double Evaluate() {
+    bool exact;
+    return EvaluateTiered(-numeric_limits<double>::infinity(), numeric_limits<double>::infinity(), exact);
+}
+
+// --- 评估缓存：每线程一张直接映射表，以局面哈希为键保存 Evaluate() 的结果；评估参数改变时清空 ---
+const int EVAL_CACHE_BITS = 16;   // 64K 项，1 MB
+thread_local unique_ptr<EvalCacheEntry[]> evalCache;   // 首次使用时分配
+thread_local bool evalCacheEnabled = true;
+thread_local long long evalCacheProbes = 0, evalCacheHits = 0;
+
+void ClearEvalCache() { evalCache.reset(); }
+void SwapEvalCache(unique_ptr<EvalCacheEntry[]>& other) { evalCache.swap(other); }
+
+EvalCacheEntry& EvalCacheSlot(uint64_t hash) {
+    if (!evalCache) evalCache.reset(new EvalCacheEntry[1 << EVAL_CACHE_BITS]());
+    evalCacheProbes++;
+    return evalCache[hash >> (64 - EVAL_CACHE_BITS)];
+}
+
+double CachedEvaluate(uint64_t hash) {
+    if (!evalCacheEnabled) return Evaluate();
+    EvalCacheEntry& e = EvalCacheSlot(hash);
+    if (e.key == hash) { evalCacheHits++; return e.score; }
+    e.key = hash;
+    e.score = Evaluate();
+    return e.score;
+}
+
+// 只有提前结束的结果是界而非精确值，不写入缓存
+double LazyEvaluate(uint64_t hash, double lo, double hi) {
+    if (!lazyEvalEnabled) return CachedEvaluate(hash);
+    lazyEvalCalls++;
+    EvalCacheEntry* e = nullptr;
+    if (evalCacheEnabled) {
+        e = &EvalCacheSlot(hash);
+        if (e->key == hash) { evalCacheHits++; return e->score; }
+    }
+    bool exact;
+    double score = EvaluateTiered(lo, hi, exact);
+    if (e && exact) { e->key = hash; e->score = score; }
+    return score;
+}
+
+// --- AI 搜索 ---
+thread_local Move searchBestMove;
+thread_local double searchBestScore;
+thread_local long long computedNodes;
+thread_local chrono::time_point<chrono::high_resolution_clock> searchStartTime;
+thread_local int searchTimeLimitMs;
+thread_local long long searchNodeLimit = 0;    // 0 = 不限节点
+thread_local int searchMaxDepth = 64;
+thread_local bool searchQuiet = false;         // 对局测试等批量模式下不打印 info
+thread_local int searchMultiPV = 1;            // >1 时每轮迭代对前 K 个根着法各做一次全窗口搜索
+thread_local vector<RootLine> searchLines;     // 最近一轮完整迭代的结果，按名次排列
+thread_local const atomic<bool>* searchStopFlag = nullptr;   // 由其它线程置位以中止搜索 (Engine::Stop)
+thread_local function<void(const SearchInfo&)> searchInfoCallback;   // 每轮迭代完成后对每条主变例调用一次
+double QuiescenceSearch(double alpha, double beta);
+thread_local bool time_is_up = false;
+thread_local int search_min_depth;
+thread_local int iterative_deepening_current_depth;
+
+// --- 主变例 (三角形 PV 表；只在 alpha 被抬高时更新) ---
+const int MAX_PLY = 128;
+thread_local Move pvTable[MAX_PLY][MAX_PLY];
+thread_local int pvLength[MAX_PLY];
+thread_local int searchPly = 0;
+inline void UpdatePV(const Move& m) {
+    int ply = searchPly;
+    pvTable[ply][ply] = m;
+    for (int i = ply + 1; i < pvLength[ply + 1]; ++i) pvTable[ply][i] = pvTable[ply + 1][i];
+    pvLength[ply] = max(ply + 1, pvLength[ply + 1]);
+}
+// 根着法 m 刚搜索完时的完整主变例
+RootLine MakeRootLine(const Move& m, double score) {
+    RootLine line;
+    line.move = m; line.score = score;
+    line.pv.push_back(m);
+    for (int i = 1; i < pvLength[1]; ++i) line.pv.push_back(pvTable[1][i]);
+    return line;
+}
+
+// --- 搜索统计 (以 -DSTARFISH_STATS 编译时启用；未启用时下列宏展开为空) ---
+#ifdef STARFISH_STATS
+struct SearchStats {
+    long long nodes = 0, qnodes = 0, interiorNodes = 0;
+    long long betaCutoffs = 0, firstMoveCutoffs = 0, standPatCutoffs = 0;
+    long long hashProbes = 0, hashHits = 0, hashCutoffs = 0;
+    int seldepth = 0;
+    void Add(const SearchStats& o) {
+        nodes += o.nodes; qnodes += o.qnodes; interiorNodes += o.interiorNodes;
+        betaCutoffs += o.betaCutoffs; firstMoveCutoffs += o.firstMoveCutoffs; standPatCutoffs += o.standPatCutoffs;
+        hashProbes += o.hashProbes; hashHits += o.hashHits; hashCutoffs += o.hashCutoffs;
+        seldepth = max(seldepth, o.seldepth);
+    }
+};
+thread_local SearchStats threadStats;      // 搜索热路径只写本线程的计数，每轮迭代结束时合并
+thread_local int statsPly = 0;
+thread_local SearchStats gameStats;        // 本局所有搜索的累计
+thread_local long long gameSearches = 0, gameIterations = 0;
+thread_local double gameSearchMs = 0, gameEbfSum = 0;
+thread_local int gameEbfCount = 0;
+mutex statsJsonMutex;
+ostream* statsJson = nullptr;
+#define STAT_INC(field) (++threadStats.field)
+#define STAT_ENTER_NODE() (++threadStats.nodes, threadStats.seldepth = max(threadStats.seldepth, statsPly))
+#define STAT_PLY_PUSH() (++statsPly)
+#define STAT_PLY_POP() (--statsPly)
+#define STAT_CUTOFF(first) (++threadStats.betaCutoffs, threadStats.firstMoveCutoffs += (first) ? 1 : 0)
+
+// 把本线程的计数并入 into 并清零；参与同一搜索的其它线程也在各自迭代结束时调用
+void MergeThreadStats(SearchStats& into) {
+    into.Add(threadStats);
+    threadStats = SearchStats();
+}
+inline double StatRatio(long long a, long long b) { return b > 0 ? (double)a / b : 0.0; }
+void WriteStatsJson(const string& line) {
+    if (!statsJson) return;
+    lock_guard<mutex> lock(statsJsonMutex);
+    *statsJson << line << "\n";
+    statsJson->flush();
+}
+void ReportIterationStats(int depth, const SearchStats& it, long long prevIterNodes, double iterMs, double totalMs,
+                          double score, const Move& best, bool complete) {
+    double ebf = (prevIterNodes > 0) ? sqrt((double)it.nodes / prevIterNodes) : 0.0;
+    gameIterations++;
+    if (complete && ebf > 0) { gameEbfSum += ebf; gameEbfCount++; }
+    stringstream js;
+    js << fixed << setprecision(4)
+       << "{\"type\":\"iter\",\"depth\":" << depth << ",\"seldepth\":" << it.seldepth << ",\"complete\":" << (complete ? "true" : "false")
+       << ",\"nodes\":" << it.nodes << ",\"qnodes\":" << it.qnodes << ",\"iter_time_ms\":" << iterMs << ",\"time_ms\":" << totalMs
+       << ",\"nps\":" << (long long)(it.nodes / max(1e-3, iterMs / 1000)) << ",\"ebf\":" << ebf
+       << ",\"beta_cutoff_rate\":" << StatRatio(it.betaCutoffs, it.interiorNodes) << ",\"first_move_cutoff_rate\":" << StatRatio(it.firstMoveCutoffs, it.betaCutoffs)
+       << ",\"stand_pat_rate\":" << StatRatio(it.standPatCutoffs, it.qnodes)
+       << ",\"hash_probes\":" << it.hashProbes << ",\"hash_hit_rate\":" << StatRatio(it.hashHits, it.hashProbes) << ",\"hash_cutoff_rate\":" << StatRatio(it.hashCutoffs, it.hashProbes)
+       << ",\"score\":" << (long long)score << ",\"move\":\"" << MoveToUCI(best) << "\"}";
+    WriteStatsJson(js.str());
+}
+void ResetGameStats() {
+    gameStats = SearchStats();
+    gameSearches = gameIterations = 0;
+    gameSearchMs = gameEbfSum = 0; gameEbfCount = 0;
+}
+void ReportGameStats(const string& game) {
+    const SearchStats& g = gameStats;
+    double avgEbf = gameEbfCount ? gameEbfSum / gameEbfCount : 0.0;
+    stringstream js;
+    js << fixed << setprecision(4)
+       << "{\"type\":\"game\",\"game\":\"" << game << "\",\"searches\":" << gameSearches << ",\"iterations\":" << gameIterations
+       << ",\"nodes\":" << g.nodes << ",\"qnodes\":" << g.qnodes << ",\"time_ms\":" << gameSearchMs
+       << ",\"nps\":" << (long long)(g.nodes / max(1e-3, gameSearchMs / 1000)) << ",\"seldepth\":" << g.seldepth << ",\"avg_ebf\":" << avgEbf
+       << ",\"beta_cutoff_rate\":" << StatRatio(g.betaCutoffs, g.interiorNodes) << ",\"first_move_cutoff_rate\":" << StatRatio(g.firstMoveCutoffs, g.betaCutoffs)
+       << ",\"hash_hit_rate\":" << StatRatio(g.hashHits, g.hashProbes) << "}";
+    WriteStatsJson(js.str());
+    if (!searchQuiet) {
+        cout << "info string Game search stats: " << gameSearches << " searches, " << g.nodes << " nodes (" << g.qnodes << " quiescence), "
+             << (long long)(g.nodes / max(1e-3, gameSearchMs / 1000)) << " nps, avg EBF " << setprecision(3) << avgEbf
+             << ", cutoff rate " << StatRatio(g.betaCutoffs, g.interiorNodes) << ", first-move cutoffs " << StatRatio(g.firstMoveCutoffs, g.betaCutoffs)
+             << setprecision(6) << endl;
+    }
+}
+void GameHashStats(long long& probes, long long& hits) {
+    probes = gameStats.hashProbes;
+    hits = gameStats.hashHits;
+}
+#else
+#define STAT_INC(field) ((void)0)
+#define STAT_ENTER_NODE() ((void)0)
+#define STAT_PLY_PUSH() ((void)0)
+#define STAT_PLY_POP() ((void)0)
+#define STAT_CUTOFF(first) ((void)0)
+#endif
+
+int scoreMove(const Move& move) {
+    int score = 0;
+    int capturedPieceType = board[move.to.x][move.to.y] & PIECE_TYPE_MASK;
+    if (capturedPieceType != EMPTY_PIECE) {
+        int movingPieceType = board[move.from.x][move.from.y] & PIECE_TYPE_MASK;
+        score = 10000 + pieceValue[capturedPieceType] - pieceValue[movingPieceType];
+    }
+    if (move.promotion != EMPTY_PIECE) { score += pieceValue[move.promotion & PIECE_TYPE_MASK]; }
+    return score;
+}
+
+// 将杀分在置换表中按"距本节点的步数"保存，取出时再换算回当前剩余深度
+const double MATE_THRESHOLD = 5e8;
+// 将杀分按剩余深度、残局库分按距根的 ply 计，存入置换表前都换成与节点位置无关的值，取出时再换回
+inline double ScoreToTT(double s, int depth, int ply) {
+    if (fabs(s) > MATE_THRESHOLD) return s > 0 ? s - depth : s + depth;
+    if (fabs(s) > TB_WIN_SCORE / 2) return s > 0 ? s + ply : s - ply;
+    return s;
+}
+inline double ScoreFromTT(double s, int depth, int ply) {
+    if (fabs(s) > MATE_THRESHOLD) return s > 0 ? s + depth : s - depth;
+    if (fabs(s) > TB_WIN_SCORE / 2) return s > 0 ? s - ply : s + ply;
+    return s;
+}
+// 把 m 移到着法表最前面 (若存在)
+inline void MoveToFront(vector<Move>& moves, const Move& m) {
+    auto it = find(moves.begin(), moves.end(), m);
+    if (it != moves.end()) rotate(moves.begin(), it, it + 1);
+}
+
+// 外部停止请求随时生效；时间与节点上限只在完成最小深度之后检查
+inline bool SearchShouldStop() {
+    if (searchStopFlag && searchStopFlag->load(memory_order_relaxed)) return true;
+    if (iterative_deepening_current_depth <= search_min_depth) return false;
+    return chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - searchStartTime).count() > searchTimeLimitMs
+        || (searchNodeLimit > 0 && computedNodes >= searchNodeLimit);
+}
+
+// --- 搜索按节点类型与行棋方特化：PV 节点以完整窗口搜索并维护主变例，非 PV 节点只需以零窗口证明分数落在哪一侧 ---
+enum NodeType { NODE_PV, NODE_NONPV };
+const double NULL_WINDOW = 1e-3;   // 评估是连续值，零窗口取一个很窄的宽度
+
+template <NodeType NT, int Us> double AlphaBetaSearch(int depth, double alpha, double beta);
+template <int Us> double QSearch(double alpha, double beta);
+
+// 根节点与 PV 节点的子节点 (Us 为子节点的行棋方，searchPly 已指向子节点)：第一个着法以完整窗口搜索，
+// 其余着法先以零窗口证明不优于 alpha，落在窗口之内时再以完整窗口重搜
+template <int Us>
+double SearchPVChild(int depth, double alpha, double beta, bool first) {
+    if (first || alpha == -numeric_limits<double>::infinity()) return -AlphaBetaSearch<NODE_PV, Us>(depth, -beta, -alpha);
+    pvLength[searchPly] = searchPly;
+    double score = -AlphaBetaSearch<NODE_NONPV, Us>(depth, -alpha - NULL_WINDOW, -alpha);
+    if (score > alpha && score < beta && !time_is_up) score = -AlphaBetaSearch<NODE_PV, Us>(depth, -beta, -alpha);
+    return score;
+}
+
+template <NodeType NT, int Us>
+double AlphaBetaSearch(int depth, double alpha, double beta) {
+    const bool pvNode = NT == NODE_PV;
+    const int Them = 1 - Us;
+    if (pvNode) pvLength[searchPly] = searchPly;
+    if (time_is_up) { return 0; }
+    if (SearchShouldStop()) { time_is_up = true; return 0; }
+    if (searchTrace) searchTrace->Enter(pvNode ? TRACE_PV : TRACE_NONPV, depth, alpha, beta);
+    if (positionHistory[GeneratePositionKey()] >= 2) { return Traced(0.0, TRACE_REPETITION); }
+    if (tablebaseMaxPieces && searchPly > 0) {
+        TBProbe tb;
+        if (ProbeTablebase(tb)) return Traced(tb.wdl * (TB_WIN_SCORE - searchPly - tb.plies), TRACE_TABLEBASE);
+    }
+    if (depth == 0) {
+        if (searchTrace) searchTrace->Drop();
+        return QSearch<Us>(alpha, beta);
+    }
+    STAT_ENTER_NODE();
+    TranspositionTable& table = ThreadTT();
+    uint64_t hash = ComputePositionHash();
+    TTData tte;
+    Move ttMove;
+    STAT_INC(hashProbes);
+    if (table.Probe(hash, tte)) {
+        STAT_INC(hashHits);
+        ttMove = tte.move;
+        if (tte.depth >= depth) {
+            double s = ScoreFromTT(tte.score, depth, searchPly);
+            if (tte.bound == TT_EXACT || (tte.bound == TT_LOWER && s >= beta) || (tte.bound == TT_UPPER && s <= alpha)) { STAT_INC(hashCutoffs); return Traced(s, TRACE_HASH_CUTOFF); }
+        }
+    }
+    double alphaOrig = alpha;
+    vector<Move> moves; GenerateMovesFor<Us, false>(moves);
+    vector<Move> legal_moves;
+    Pos kingPos;
+    for(int x=1; x<=8; ++x) for(int y=1; y<=8; ++y) { if(board[x][y] == (KING | (Us * COLOR_MASK))) { kingPos = {x,y}; break; } }
+    for (const auto& m : moves) {
+        Pos kingPos_after = kingPos;
+        if ((board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == KING) kingPos_after = m.to;
+        UndoInfo undo = MakeMoveFor<Us>(m);
+        if (!IsSquareAttackedBy<Them>(kingPos_after)) { legal_moves.push_back(m); }
+        UnmakeMoveFor<Us>(m, undo);
+    }
+    if (legal_moves.empty()) {
+        if (IsSquareAttackedBy<Them>(kingPos)) { return Traced(-1e9 - depth, TRACE_CHECKMATE); }
+        else { return Traced(0, TRACE_STALEMATE); }
+    }
+    { PROFILE_SCOPE(PROF_SORT); sort(legal_moves.begin(), legal_moves.end(), [&](const Move& a, const Move& b) { return scoreMove(a) > scoreMove(b); }); }
+    if (ttMove.from.ok()) MoveToFront(legal_moves, ttMove);
+    STAT_INC(interiorNodes);
+    double bestScore = -numeric_limits<double>::infinity();
+    Move bestMove;
+    int searched = 0;
+    for (const auto& m : legal_moves) {
+        UndoInfo undo = MakeMoveFor<Us>(m);
+        computedNodes++;
+        searched++;
+        STAT_PLY_PUSH();
+        if (searchTrace) searchTrace->SetMove(m);
+        searchPly++;
+        double score = pvNode ? SearchPVChild<Them>(depth - 1, alpha, beta, &m == &legal_moves.front())
+                              : -AlphaBetaSearch<NODE_NONPV, Them>(depth - 1, -beta, -alpha);
+        searchPly--;
+        STAT_PLY_POP();
+        UnmakeMoveFor<Us>(m, undo);
+        if (time_is_up) { return Traced(0, TRACE_ABORTED, searched); }
+        if (score > bestScore) { bestScore = score; bestMove = m; }
+        if (bestScore > alpha) { alpha = bestScore; if (pvNode) UpdatePV(m); }
+        if (alpha >= beta) { STAT_CUTOFF(&m == &legal_moves.front()); break; }
+    }
+    int bound = (bestScore <= alphaOrig) ? TT_UPPER : (bestScore >= beta ? TT_LOWER : TT_EXACT);
+    table.Store(hash, bestMove, ScoreToTT(bestScore, depth, searchPly), depth, bound);
+    return Traced(bestScore, bestScore >= beta ? TRACE_BETA_CUTOFF : (bestScore <= alphaOrig ? TRACE_FAIL_LOW : TRACE_EXACT), searched);
+}
+template <int Us>
+double QSearch(double alpha, double beta) {
+    const int Them = 1 - Us;
+    if (time_is_up) { return 0; }
+    if (SearchShouldStop()) { time_is_up = true; return 0; }
+    if (searchTrace) searchTrace->Enter(TRACE_QS, 0, alpha, beta);
+    STAT_ENTER_NODE();
+    STAT_INC(qnodes);
+    // 站立分只需判断是否 >= beta 或 <= alpha 时允许分层评估提前结束 (窗口换算到白方视角)
+    double eval = Us == WHITE ? LazyEvaluate(ComputePositionHash(), alpha, beta) : LazyEvaluate(ComputePositionHash(), -beta, -alpha);
+    double stand_pat = (Us == WHITE ? eval : -eval);
+    if (stand_pat >= beta) { STAT_INC(standPatCutoffs); return Traced(beta, TRACE_STAND_PAT); }
+    if (alpha < stand_pat) { alpha = stand_pat; }
+    vector<Move> capture_moves; GenerateMovesFor<Us, true>(capture_moves);
+    vector<Move> legal_captures;
+    Pos kingPos;
+    for(int x=1; x<=8; ++x) for(int y=1; y<=8; ++y) { if(board[x][y] == (KING | (Us * COLOR_MASK))) { kingPos = {x,y}; break; } }
+     for (const auto& m : capture_moves) {
+        Pos kingPos_after = kingPos;
+        if ((board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == KING) kingPos_after = m.to;
+        UndoInfo undo = MakeMoveFor<Us>(m);
+        if (!IsSquareAttackedBy<Them>(kingPos_after)) { legal_captures.push_back(m); }
+        UnmakeMoveFor<Us>(m, undo);
+    }
+    { PROFILE_SCOPE(PROF_SORT); sort(legal_captures.begin(), legal_captures.end(), [&](const Move& a, const Move& b) { return scoreMove(a) > scoreMove(b); }); }
+    int searched = 0;
+    for (const auto& m : legal_captures) {
+        UndoInfo undo = MakeMoveFor<Us>(m);
+        computedNodes++;
+        searched++;
+        STAT_PLY_PUSH();
+        if (searchTrace) searchTrace->SetMove(m);
+        double score = -QSearch<Them>(-beta, -alpha);
+        STAT_PLY_POP();
+        UnmakeMoveFor<Us>(m, undo);
+        if (time_is_up) { return Traced(0, TRACE_ABORTED, searched); }
+        if (score >= beta) { return Traced(beta, TRACE_QS_CUTOFF, searched); }
+        if (score > alpha) { alpha = score; }
+    }
+    return Traced(alpha, TRACE_QS_DONE, searched);
+}
+double QuiescenceSearch(double alpha, double beta) {
+    return currentPlayer == WHITE ? QSearch<WHITE>(alpha, beta) : QSearch<BLACK>(alpha, beta);
+}
+// 根着法刚走出之后调用：按子节点的行棋方分派一次
+double SearchRootChild(int depth, double alpha, double beta, bool first) {
+    return currentPlayer == WHITE ? SearchPVChild<WHITE>(depth, alpha, beta, first) : SearchPVChild<BLACK>(depth, alpha, beta, first);
+}
+double SearchFixedDepth(int depth) {
+    searchStartTime = chrono::high_resolution_clock::now();
+    computedNodes = 0;
+    time_is_up = false;
+    search_min_depth = iterative_deepening_current_depth = depth;
+    searchPly = 0;
+    const double inf = numeric_limits<double>::infinity();
+    return currentPlayer == WHITE ? AlphaBetaSearch<NODE_PV, WHITE>(depth, -inf, inf) : AlphaBetaSearch<NODE_PV, BLACK>(depth, -inf, inf);
+}
+double SearchRootMove(const Move& m, int depth, double alpha, double beta, bool first, vector<Move>& pv) {
+    searchStartTime = chrono::high_resolution_clock::now();
+    computedNodes = 0;
+    time_is_up = false;
+    search_min_depth = iterative_deepening_current_depth = depth;
+    UndoInfo undo = MakeMove(m);
+    searchPly = 1;
+    double score = SearchRootChild(depth - 1, alpha, beta, first);
+    searchPly = 0;
+    UnmakeMove(m, undo);
+    pv = MakeRootLine(m, score).pv;
+    return score;
+}
+void SearchBestMove(int min_depth) {
+    PROFILE_SEARCH();
+    searchStartTime = chrono::high_resolution_clock::now();
+    computedNodes = 0;
+    time_is_up = false;
+    search_min_depth = min_depth;
+    double bestScoreSoFar = -numeric_limits<double>::infinity();
+    const int MAX_DEPTH = 64;
+    vector<Move> moves; GenerateMoves(moves, false);
+    vector<Move> legal_moves;
+    Pos kingPos;
+    for(int x=1; x<=8; ++x) for(int y=1; y<=8; ++y) if(board[x][y] == (KING | (currentPlayer * COLOR_MASK))) { kingPos = {x,y}; break; }
+    for (const auto& m : moves) {
+        Pos kingPos_after = kingPos;
+        if ((board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == KING) kingPos_after = m.to;
+        UndoInfo undo = MakeMove(m);
+        if (!IsSquareAttacked(kingPos_after, currentPlayer)) legal_moves.push_back(m);
+        UnmakeMove(m, undo);
+    }
+    vector<RootLine> previousLines;
+    searchLines.clear();
+    searchPly = 0;
+    ThreadTT().NewSearch();
+    if (legal_moves.empty()) return;
+    searchBestMove = legal_moves[0];
+    searchBestScore = 0;
+#ifdef STARFISH_STATS
+    threadStats = SearchStats();
+    statsPly = 0;
+    long long prevIterNodes = 0;
+    auto iterStart = searchStartTime;
+    gameSearches++;
+#endif
+    for (int current_depth = 2; current_depth <= min(MAX_DEPTH, searchMaxDepth); current_depth += 2) {
+        iterative_deepening_current_depth = current_depth;
+        STAT_ENTER_NODE();
+        STAT_INC(interiorNodes);
+        { PROFILE_SCOPE(PROF_SORT); sort(legal_moves.begin(), legal_moves.end(), [&](const Move& a, const Move& b) { return scoreMove(a) > scoreMove(b); }); }
+        for (size_t k = previousLines.size(); k-- > 0;) MoveToFront(legal_moves, previousLines[k].move);   // 上一轮的名次在前
+        Move bestMoveThisIteration = legal_moves[0];
+        double bestScoreThisIteration = -numeric_limits<double>::infinity();
+        vector<RootLine> linesThisIteration;
+        if (searchMultiPV <= 1) {
+            double alpha = -numeric_limits<double>::infinity();
+            double beta = numeric_limits<double>::infinity();
+            RootLine bestLine;
+            for (const auto& m : legal_moves) {
+                UndoInfo undo = MakeMove(m);
+                STAT_PLY_PUSH();
+                if (searchTrace) searchTrace->SetMove(m);
+                searchPly = 1;
+                double score = SearchRootChild(current_depth - 1, alpha, beta, &m == &legal_moves.front());
+                searchPly = 0;
+                STAT_PLY_POP();
+                UnmakeMove(m, undo);
+                if (time_is_up) { break; }
+                if (score > bestScoreThisIteration) {
+                    bestScoreThisIteration = score;
+                    bestMoveThisIteration = m;
+                    bestLine = MakeRootLine(m, score);
+                    if (score > alpha) { alpha = score; }
+                }
+            }
+            linesThisIteration.push_back(bestLine);
+        } else {
+            // 第 k 趟在尚未报告的根着法中以全窗口 (-inf, +inf) 起步，胜出者的分数是精确值
+            vector<bool> reported(legal_moves.size(), false);
+            int lines = min<int>(searchMultiPV, (int)legal_moves.size());
+            for (int k = 0; k < lines && !time_is_up; ++k) {
+                double alpha = -numeric_limits<double>::infinity();
+                double beta = numeric_limits<double>::infinity();
+                double bestScore = -numeric_limits<double>::infinity();
+                int bestIndex = -1;
+                RootLine bestLine;
+                for (size_t i = 0; i < legal_moves.size(); ++i) {
+                    if (reported[i]) continue;
+                    const Move& m = legal_moves[i];
+                    UndoInfo undo = MakeMove(m);
+                    STAT_PLY_PUSH();
+                    if (searchTrace) searchTrace->SetMove(m);
+                    searchPly = 1;
+                    double score = SearchRootChild(current_depth - 1, alpha, beta, bestIndex < 0);
+                    searchPly = 0;
+                    STAT_PLY_POP();
+                    UnmakeMove(m, undo);
+                    if (time_is_up) { break; }
+                    if (bestIndex < 0 || score > bestScore) {
+                        bestScore = score; bestIndex = (int)i;
+                        bestLine = MakeRootLine(m, score);
+                        if (score > alpha) { alpha = score; }
+                    }
+                }
+                if (time_is_up) { break; }
+                reported[bestIndex] = true;
+                linesThisIteration.push_back(bestLine);
+            }
+            if (!time_is_up) {
+                bestMoveThisIteration = linesThisIteration[0].move;
+                bestScoreThisIteration = linesThisIteration[0].score;
+            }
+        }
+#ifdef STARFISH_STATS
+        {
+            SearchStats iterStats;
+            MergeThreadStats(iterStats);
+            auto now = chrono::high_resolution_clock::now();
+            double iterMs = chrono::duration<double, milli>(now - iterStart).count();
+            double totalMs = chrono::duration<double, milli>(now - searchStartTime).count();
+            ReportIterationStats(current_depth, iterStats, prevIterNodes, iterMs, totalMs,
+                                 time_is_up ? bestScoreSoFar : bestScoreThisIteration, time_is_up ? searchBestMove : bestMoveThisIteration, !time_is_up);
+            gameStats.Add(iterStats);
+            gameSearchMs += iterMs;
+            prevIterNodes = iterStats.nodes;
+            iterStart = now;
+        }
+#endif
+        if (time_is_up) {
+            if (!searchQuiet) cout << "info string Time up during depth " << current_depth << ". Using results from depth " << current_depth - 2 << "." << endl;
+            break; 
+        }
+        bestScoreSoFar = bestScoreThisIteration;
+        searchBestMove = bestMoveThisIteration;
+        searchBestScore = bestScoreSoFar;
+        searchLines = linesThisIteration;
+        previousLines = linesThisIteration;
+        auto end_time = chrono::high_resolution_clock::now();
+        chrono::duration<double> diff = end_time - searchStartTime;
+        if (searchInfoCallback) {
+            for (size_t k = 0; k < searchLines.size(); ++k) {
+                SearchInfo info;
+                info.depth = current_depth;
+                info.multipv = (int)k + 1;
+                info.score = searchLines[k].score;
+                info.nodes = computedNodes;
+                info.timeMs = static_cast<int>(diff.count() * 1000);
+                info.hashfull = ThreadTT().Hashfull();
+                info.pv = searchLines[k].pv;
+                searchInfoCallback(info);
+            }
+        }
+        if (!searchQuiet) {
+            for (size_t k = 0; k < searchLines.size(); ++k) {
+                const RootLine& line = searchLines[k];
+                cout << "info depth " << current_depth;
+                if (searchMultiPV > 1) cout << " multipv " << (k + 1);
+                cout << " score cp " << static_cast<int>(currentPlayer == WHITE ? line.score : -line.score)
+                     << " nodes " << computedNodes << " time " << static_cast<int>(diff.count() * 1000) << "ms hashfull " << ThreadTT().Hashfull() << " pv";
+                for (const auto& m : line.pv) cout << " " << MoveToUCI(m);
+                cout << endl;
+            }
+        }
+        if (current_depth >= min_depth) {
+            auto now = chrono::high_resolution_clock::now();
+            if (chrono::duration_cast<chrono::milliseconds>(now - searchStartTime).count() > searchTimeLimitMs
+                || (searchNodeLimit > 0 && computedNodes >= searchNodeLimit)) {
+                if (!searchQuiet) cout << "info string Not enough time to start next depth." << endl;
+                break;
+            }
+        }
+    }
+}
+// --- UI 辅助函数 ---
+Move parse_uci_move(const string& uci_str) {
+    Move move;
+    move.from.x = uci_str[0] - 'a' + 1; move.from.y = uci_str[1] - '0';
+    move.to.x = uci_str[2] - 'a' + 1; move.to.y = uci_str[3] - '0';
+    if (uci_str.length() == 5) {
+        char prom_char = tolower(uci_str[4]); int prom_piece_type = EMPTY_PIECE;
+        if (prom_char == 'q') prom_piece_type = QUEEN; else if (prom_char == 'r') prom_piece_type = ROOK;
+        else if (prom_char == 'b') prom_piece_type = BISHOP; else if (prom_char == 'n') prom_piece_type = KNIGHT;
+        move.promotion = prom_piece_type | (currentPlayer * COLOR_MASK);
+    }
+    return move;
+}
+void PrintBoard() {
+    cout << "\n   a  b  c  d  e  f  g  h" << endl;
+    cout << "  +------------------------+" << endl;
+    for (int j = 8; j >= 1; j--) {
+        cout << j << " |";
+        for (int i = 1; i <= 8; i++) {
+            char symbol = pieceChar.at(board[i][j]); int piece = board[i][j];
+            if (piece != EMPTY_PIECE) {
+                int color = PieceColorOf(piece);
+                if (color == WHITE) cout << " " << "\033[37m" << symbol << "\033[0m" << " ";
+                else cout << " " << "\033[31m" << symbol << "\033[0m" << " ";
+            } else { cout << " " << '.' << " "; }
+        }
+        cout << "| " << j << endl;
+    }
+    cout << "  +------------------------+" << endl;
+    cout << "   a  b  c  d  e  f  g  h" << endl;
+    cout << "FEN: " << GenerateFEN() << endl << endl;
+}
+Move ParseAlgebraicMove(const string& san_str, const vector<Move>& legal_moves) {
+    string s = san_str;
+    if (s == "O-O" || s == "0-0") {
+        int rank = (currentPlayer == WHITE) ? 1 : 8;
+        for (const auto& m : legal_moves) {
+            if ((board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == KING &&
+                m.from.x == 5 && m.from.y == rank && m.to.x == 7 && m.to.y == rank) {
+                return m;
+            }
+        }
+    }
+    if (s == "O-O-O" || s == "0-0-0") {
+        int rank = (currentPlayer == WHITE) ? 1 : 8;
+        for (const auto& m : legal_moves) {
+            if ((board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == KING &&
+                m.from.x == 5 && m.from.y == rank && m.to.x == 3 && m.to.y == rank) {
+                return m;
+            }
+        }
+    }
+    
+    s.erase(remove(s.begin(), s.end(), '+'), s.end());
+    s.erase(remove(s.begin(), s.end(), '#'), s.end());
+    s.erase(remove(s.begin(), s.end(), 'x'), s.end());
+    
+    int promotion_piece = EMPTY_PIECE;
+    size_t promotion_pos = s.find('=');
+    if (promotion_pos != string::npos) {
+        char prom_char = toupper(s[promotion_pos + 1]);
+        if (prom_char == 'Q') promotion_piece = QUEEN;
+        else if (prom_char == 'R') promotion_piece = ROOK;
+        else if (prom_char == 'B') promotion_piece = BISHOP;
+        else if (prom_char == 'N') promotion_piece = KNIGHT;
+        promotion_piece |= (currentPlayer * COLOR_MASK);
+        s = s.substr(0, promotion_pos);
+    }
+    
+    Pos to_pos;
+    to_pos.y = s.back() - '0';
+    s.pop_back();
+    to_pos.x = s.back() - 'a' + 1;
+    s.pop_back();
+
+    int piece_type = PAWN;
+    if (!s.empty() && isupper(s[0])) {
+        if (s[0] == 'N') piece_type = KNIGHT;
+        else if (s[0] == 'B') piece_type = BISHOP;
+        else if (s[0] == 'R') piece_type = ROOK;
+        else if (s[0] == 'Q') piece_type = QUEEN;
+        else if (s[0] == 'K') piece_type = KING;
+        s = s.substr(1);
+    }
+    
+    int from_file = -1, from_rank = -1;
+    if (!s.empty()) {
+        if (s.length() == 1) {
+            if (s[0] >= 'a' && s[0] <= 'h') from_file = s[0] - 'a' + 1;
+            else if (s[0] >= '1' && s[0] <= '8') from_rank = s[0] - '0';
+        } else if (s.length() == 2) {
+            from_file = s[0] - 'a' + 1;
+            from_rank = s[1] - '0';
+        }
+    }
+    
+    vector<Move> candidates;
+    for (const auto& m : legal_moves) {
+        if (m.to == to_pos && (board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == piece_type) {
+            bool file_match = (from_file == -1 || m.from.x == from_file);
+            bool rank_match = (from_rank == -1 || m.from.y == from_rank);
+            bool promotion_match = (promotion_piece == EMPTY_PIECE) ? (m.promotion == EMPTY_PIECE) : (m.promotion == promotion_piece);
+
+            if (file_match && rank_match && promotion_match) {
+                candidates.push_back(m);
+            }
+        }
+    }
+    
+    if (candidates.size() == 1) {
+        return candidates[0];
+    }
+    
+    return Move{Pos(0,0), Pos(0,0)};
+}
+// --- 通用辅助：合法着法、将军检测与 SAN 输出 ---
+Pos FindKing(int color) {
+    for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) if (board[x][y] == (KING | (color * COLOR_MASK))) return {x, y};
+    return Pos(0, 0);
+}
+void GenerateLegalMoves(vector<Move>& legal_moves) {
+    vector<Move> moves; GenerateMoves(moves, false);
+    legal_moves.clear();
+    Pos kingPos = FindKing(currentPlayer);
+    for (const auto& m : moves) {
+        Pos kingPos_after = kingPos;
+        if ((board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == KING) kingPos_after = m.to;
+        UndoInfo undo = MakeMove(m);
+        if (!IsSquareAttacked(kingPos_after, currentPlayer)) legal_moves.push_back(m);
+        UnmakeMove(m, undo);
+    }
+}
+bool IsInCheck() { return IsSquareAttacked(FindKing(currentPlayer), 1 - currentPlayer); }
+
+bool IsInsufficientMaterial() {
+    int minors = 0;
+    for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) {
+        int t = board[x][y] & PIECE_TYPE_MASK;
+        if (t == PAWN || t == ROOK || t == QUEEN) return false;
+        if (t == KNIGHT || t == BISHOP) minors++;
+    }
+    return minors <= 1;
+}
+
+string MoveToUCI(const Move& m) {
+    string s;
+    s += (char)('a' + m.from.x - 1); s += (char)('0' + m.from.y);
+    s += (char)('a' + m.to.x - 1); s += (char)('0' + m.to.y);
+    if (m.promotion != EMPTY_PIECE) s += (char)tolower(pieceChar.at(m.promotion & PIECE_TYPE_MASK));
+    return s;
+}
+
+string MoveToSAN(const Move& m, const vector<Move>& legal_moves) {
+    int piece = board[m.from.x][m.from.y];
+    int pieceType = piece & PIECE_TYPE_MASK;
+    string san;
+    if (pieceType == KING && abs(m.to.x - m.from.x) == 2) {
+        san = (m.to.x == 7) ? "O-O" : "O-O-O";
+    } else {
+        bool capture = board[m.to.x][m.to.y] != EMPTY_PIECE || (pieceType == PAWN && m.to.x != m.from.x);
+        if (pieceType == PAWN) {
+            if (capture) san += (char)('a' + m.from.x - 1);
+        } else {
+            san += pieceChar.at(pieceType);
+            bool ambiguous = false, same_file = false, same_rank = false;
+            for (const auto& o : legal_moves) {
+                if (o.to == m.to && !(o.from == m.from) && (board[o.from.x][o.from.y] & PIECE_TYPE_MASK) == pieceType) {
+                    ambiguous = true;
+                    if (o.from.x == m.from.x) same_file = true;
+                    if (o.from.y == m.from.y) same_rank = true;
+                }
+            }
+            if (ambiguous) {
+                if (!same_file) san += (char)('a' + m.from.x - 1);
+                else if (!same_rank) san += (char)('0' + m.from.y);
+                else { san += (char)('a' + m.from.x - 1); san += (char)('0' + m.from.y); }
+            }
+        }
+        if (capture) san += 'x';
+        san += (char)('a' + m.to.x - 1); san += (char)('0' + m.to.y);
+        if (m.promotion != EMPTY_PIECE) { san += '='; san += pieceChar.at(m.promotion & PIECE_TYPE_MASK); }
+    }
+    UndoInfo undo = MakeMove(m);
+    if (IsInCheck()) {
+        vector<Move> replies; GenerateLegalMoves(replies);
+        san += replies.empty() ? '#' : '+';
+    }
+    UnmakeMove(m, undo);
+    return san;
+}
+
+// --- 评估参数表：按名字读写当前线程的评估参数 ---
+vector<EvalParamRef> EvalParamRefs() {
+    return {
+        {"pieceValue", pieceValue, nullptr, 7},
+        {"pawn_pst_mg", pawn_pst_mg, nullptr, 64},     {"pawn_pst_eg", pawn_pst_eg, nullptr, 64},
+        {"knight_pst_mg", knight_pst_mg, nullptr, 64}, {"knight_pst_eg", knight_pst_eg, nullptr, 64},
+        {"bishop_pst_mg", bishop_pst_mg, nullptr, 64}, {"bishop_pst_eg", bishop_pst_eg, nullptr, 64},
+        {"rook_pst_mg", rook_pst_mg, nullptr, 64},     {"rook_pst_eg", rook_pst_eg, nullptr, 64},
+        {"queen_pst_mg", queen_pst_mg, nullptr, 64},   {"queen_pst_eg", queen_pst_eg, nullptr, 64},
+        {"king_pst_mg", king_pst_mg, nullptr, 64},     {"king_pst_eg", king_pst_eg, nullptr, 64},
+        {"DOUBLED_PAWN_PENALTY", nullptr, &DOUBLED_PAWN_PENALTY, 1},
+        {"ISOLATED_PAWN_PENALTY", nullptr, &ISOLATED_PAWN_PENALTY, 1},
+        {"PASSED_PAWN_BONUS", nullptr, PASSED_PAWN_BONUS, 8},
+        {"BISHOP_PAIR_BONUS", nullptr, &BISHOP_PAIR_BONUS, 1},
+        {"ROOK_ON_SEMI_OPEN_FILE_BONUS", nullptr, &ROOK_ON_SEMI_OPEN_FILE_BONUS, 1},
+        {"ROOK_ON_OPEN_FILE_BONUS", nullptr, &ROOK_ON_OPEN_FILE_BONUS, 1},
+        {"PAWN_SHIELD_PENALTY", nullptr, &PAWN_SHIELD_PENALTY, 1},
+    };
+}
+ParamSet CaptureEvalParams() {
+    ParamSet p;
+    for (const auto& r : EvalParamRefs()) for (int i = 0; i < r.count; ++i) p.push_back(r.ivals ? r.ivals[i] : r.dvals[i]);
+    return p;
+}
+void ApplyEvalParams(const ParamSet& p) {
+    size_t k = 0;
+    for (const auto& r : EvalParamRefs()) for (int i = 0; i < r.count; ++i, ++k) {
+        if (r.ivals) r.ivals[i] = (int)lround(p[k]); else r.dvals[i] = p[k];
+    }
+    lazyEvalBounds = ComputeLazyEvalBounds();
+    ClearEvalCache();
+}
+// 参数文件每行: <名字> <值...>，未出现的参数保持 base 中的值
+bool LoadEvalParamFile(const string& filename, const ParamSet& base, ParamSet& out) {
+    ifstream in(filename);
+    if (!in.is_open()) { cout << "Error: Could not open parameter file '" << filename << "'" << endl; return false; }
+    out = base;
+    vector<EvalParamRef> refs = EvalParamRefs();
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        stringstream ss(line);
+        string name; ss >> name;
+        size_t offset = 0; bool found = false;
+        for (const auto& r : refs) {
+            if (name == r.name) {
+                double v; int i = 0;
+                while (i < r.count && ss >> v) out[offset + i++] = v;
+                if (i != r.count) { cout << "Error: Parameter '" << name << "' expects " << r.count << " values." << endl; return false; }
+                found = true; break;
+            }
+            offset += r.count;
+        }
+        if (!found) { cout << "Error: Unknown parameter '" << name << "' in " << filename << endl; return false; }
+    }
+    return true;
+}
+
+// --- 剖析命令 (profile)：对单个局面搜索并打印各子系统耗时 ---
+int RunProfile(int argc, char* argv[]) {
+#ifdef STARFISH_PROFILE
+    string fen = START_FEN;
+    int depth = 4, timeMs = 0;
+    for (int i = 0; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "-fen" && i + 1 < argc) fen = argv[++i];
+        else if (a == "-depth" && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (a == "-time" && i + 1 < argc) timeMs = atoi(argv[++i]);
+        else { cout << "Usage: chess_AI_multithreads profile [-fen FEN] [-depth N] [-time MS]" << endl; return 2; }
+    }
+    LoadFEN(fen);
+    searchMaxDepth = (timeMs > 0) ? 64 : depth;
+    searchTimeLimitMs = (timeMs > 0) ? timeMs : numeric_limits<int>::max();
+    ResetProfile();
+    SearchBestMove(timeMs > 0 ? 2 : depth);
+    PrintProfile(computedNodes);
+    return 0;
+#else
+    (void)argc; (void)argv;
+    cout << "Error: profile requires a build with -DSTARFISH_PROFILE." << endl;
+    return 2;
+#endif
+}
@@ -0,0 +1,533 @@
+// gensfen.cpp
+//Starfish --- chess engine developed by dsyoier
+//训练数据生成 (gensfen)：多线程固定节点自对弈，从开局库出口加随机着法起步，每个搜索过的局面打包成 32 字节定长记录
+//(棋盘、走子方、分数、半回合数、终局结果)；文件可按块压缩，同一种子下结果确定且可以续写；SfenReader 流式读取并跨文件打乱
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <sstream>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// --- 文件格式：32 字节文件头，之后是连续的 PackedSfen (未压缩) 或一串块 (压缩)，均为本机字节序 ---
+// 块：记录数与压缩后字节数各 4 字节，随后是数据。块之间相互独立，且总在一局结束处截断，便于续写与按块打乱
+const char SFEN_MAGIC[8] = {'S', 'F', 'S', 'F', 'E', 'N', '0', '1'};
+const uint32_t SFEN_FILE_COMPRESSED = 1;
+const size_t SFEN_BLOCK_RECORDS = 4096;
+struct SfenFileHeader {
+    char magic[8];
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t seed;
+    uint64_t settings;        // 生成参数的指纹，续写时必须一致
+};
+
+bool ReadSfenHeader(FILE* file, SfenFileHeader& h) {
+    return fread(&h, sizeof(h), 1, file) == 1 && memcmp(h.magic, SFEN_MAGIC, sizeof(SFEN_MAGIC)) == 0;
+}
+
+bool IsSfenFile(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    SfenFileHeader h;
+    bool ok = ReadSfenHeader(file, h);
+    fclose(file);
+    return ok;
+}
+
+// --- 打包与解包 ---
+bool PackSfen(PackedSfen& out) {
+    memset(&out, 0, sizeof(out));
+    int n = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        int piece = board[sq % 8 + 1][sq / 8 + 1];
+        if (piece == EMPTY_PIECE) continue;
+        if (n == 32) return false;
+        out.occupied |= 1ULL << sq;
+        out.pieces[n / 2] |= (uint8_t)(piece << (4 * (n & 1)));
+        n++;
+    }
+    int epFile = enPassantTarget.ok() ? enPassantTarget.x : 0;
+    out.state = (uint16_t)(currentPlayer | castlingRights << 1 | epFile << 5 | min(halfmoveClock, 127) << 9);
+    out.ply = (uint16_t)max(0, (Round - 1) * 2 + currentPlayer);
+    return true;
+}
+
+string SfenToFEN(const PackedSfen& s) {
+    int squares[64] = {0};
+    for (int sq = 0, n = 0; sq < 64; ++sq) {
+        if (!(s.occupied >> sq & 1)) continue;
+        squares[sq] = s.pieces[n / 2] >> (4 * (n & 1)) & 15;
+        n++;
+    }
+    string fen;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            int piece = squares[rank * 8 + file];
+            if (piece == EMPTY_PIECE) { empty++; continue; }
+            if (empty) { fen += char('0' + empty); empty = 0; }
+            auto it = pieceChar.find(piece);
+            fen += (it != pieceChar.end()) ? it->second : '?';
+        }
+        if (empty) fen += char('0' + empty);
+        if (rank) fen += '/';
+    }
+    int side = s.state & 1, castling = s.state >> 1 & 15, epFile = s.state >> 5 & 15, halfmove = s.state >> 9;
+    fen += (side == WHITE) ? " w " : " b ";
+    if (castling & WK_CASTLE) fen += 'K';
+    if (castling & WQ_CASTLE) fen += 'Q';
+    if (castling & BK_CASTLE) fen += 'k';
+    if (castling & BQ_CASTLE) fen += 'q';
+    if (!castling) fen += '-';
+    fen += ' ';
+    if (epFile >= 1 && epFile <= 8) { fen += char('a' + epFile - 1); fen += (side == WHITE) ? '6' : '3'; }
+    else fen += '-';
+    return fen + " " + to_string(halfmove) + " " + to_string(s.ply / 2 + 1);
+}
+
+// --- 块压缩：每条记录与前一条逐字节异或 (同一局相邻局面的多数字节相同)，连续的零字节写成 0 与长度 ---
+void CompressSfenBlock(const vector<PackedSfen>& records, vector<uint8_t>& out) {
+    out.clear();
+    uint8_t prev[sizeof(PackedSfen)] = {0};
+    size_t zeros = 0;
+    auto flushZeros = [&] {
+        for (; zeros > 0; zeros -= min<size_t>(zeros, 255)) { out.push_back(0); out.push_back((uint8_t)min<size_t>(zeros, 255)); }
+    };
+    for (const auto& r : records) {
+        const uint8_t* bytes = (const uint8_t*)&r;
+        for (size_t i = 0; i < sizeof(PackedSfen); ++i) {
+            uint8_t x = bytes[i] ^ prev[i];
+            prev[i] = bytes[i];
+            if (x == 0) { zeros++; continue; }
+            flushZeros();
+            out.push_back(x);
+        }
+    }
+    flushZeros();
+}
+
+bool DecompressSfenBlock(const uint8_t* data, size_t size, uint32_t count, vector<PackedSfen>& records) {
+    records.resize(count);
+    uint8_t* dst = (uint8_t*)records.data();
+    size_t total = (size_t)count * sizeof(PackedSfen), pos = 0;
+    for (size_t i = 0; i < size;) {
+        if (data[i]) {
+            if (pos >= total) return false;
+            dst[pos++] = data[i++];
+        } else {
+            if (i + 1 >= size || data[i + 1] == 0 || pos + data[i + 1] > total) return false;
+            memset(dst + pos, 0, data[i + 1]);
+            pos += data[i + 1];
+            i += 2;
+        }
+    }
+    if (pos != total) return false;
+    for (size_t k = sizeof(PackedSfen); k < total; ++k) dst[k] ^= dst[k - sizeof(PackedSfen)];
+    return true;
+}
+
+// 读一个压缩块；read 为 false 表示已到文件末尾，返回 false 而 read 为 true 表示块残缺或损坏
+bool ReadSfenBlock(FILE* file, vector<uint8_t>& bytes, vector<PackedSfen>& records, bool& read) {
+    uint32_t head[2];
+    read = fread(head, sizeof(head), 1, file) == 1;
+    if (!read || head[0] == 0 || head[0] > (1u << 24) || head[1] > head[0] * 2 * sizeof(PackedSfen)) return false;
+    bytes.resize(head[1]);
+    return fread(bytes.data(), 1, head[1], file) == head[1] && DecompressSfenBlock(bytes.data(), head[1], head[0], records);
+}
+
+// --- 流式读取 ---
+struct SfenReader::Impl {
+    struct Source { FILE* file; bool compressed; string path; };
+    vector<Source> sources;           // 尚未读完的文件
+    vector<PackedSfen> buffer;        // 打乱缓冲区；顺序读取时为当前块
+    vector<PackedSfen> block;
+    vector<uint8_t> bytes;
+    size_t cursor = 0, shuffle = 0;
+    mt19937_64 rng;
+
+    ~Impl() { for (auto& s : sources) fclose(s.file); }
+    // 从第 i 个文件读入一块追加到 out；读完的文件关闭并移出
+    void ReadChunk(size_t i, vector<PackedSfen>& out) {
+        Source& s = sources[i];
+        bool more;
+        if (s.compressed) {
+            bool read;
+            more = ReadSfenBlock(s.file, bytes, block, read);
+            if (more) out.insert(out.end(), block.begin(), block.end());
+            else if (read) cout << "info string Warning: '" << s.path << "' ends with a damaged block; the rest is skipped." << endl;
+        } else {
+            size_t old = out.size();
+            out.resize(old + SFEN_BLOCK_RECORDS);
+            size_t got = fread(&out[old], sizeof(PackedSfen), SFEN_BLOCK_RECORDS, s.file);
+            out.resize(old + got);
+            more = got == SFEN_BLOCK_RECORDS;
+        }
+        if (!more) { fclose(s.file); sources.erase(sources.begin() + i); }
+    }
+};
+
+SfenReader::SfenReader() : impl(new Impl) {}
+SfenReader::~SfenReader() { delete impl; }
+
+bool SfenReader::Open(const vector<string>& paths, size_t shuffle, uint64_t seed) {
+    delete impl;
+    impl = new Impl;
+    impl->shuffle = shuffle;
+    impl->rng.seed(seed);
+    for (const auto& path : paths) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) { cout << "Error: Could not open training data '" << path << "'" << endl; return false; }
+        SfenFileHeader h;
+        if (!ReadSfenHeader(file, h)) { fclose(file); cout << "Error: '" << path << "' is not a packed training data file." << endl; return false; }
+        impl->sources.push_back({file, (h.flags & SFEN_FILE_COMPRESSED) != 0, path});
+    }
+    return true;
+}
+
+bool SfenReader::Next(PackedSfen& s) {
+    Impl& d = *impl;
+    if (d.shuffle == 0) {
+        while (d.cursor == d.buffer.size()) {
+            if (d.sources.empty()) return false;
+            d.buffer.clear();
+            d.cursor = 0;
+            d.ReadChunk(0, d.buffer);
+        }
+        s = d.buffer[d.cursor++];
+        return true;
+    }
+    while (d.buffer.size() < d.shuffle && !d.sources.empty()) d.ReadChunk(d.rng() % d.sources.size(), d.buffer);
+    if (d.buffer.empty()) return false;
+    size_t k = d.rng() % d.buffer.size();
+    s = d.buffer[k];
+    d.buffer[k] = d.buffer.back();
+    d.buffer.pop_back();
+    return true;
+}
+
+// --- 自对弈 ---
+struct GenSfenOptions {
+    long long games = 1000;
+    long long nodes = 5000;
+    int threads = 1;
+    int randomMoves = 8;
+    int maxPlies = 400;
+    int evalLimit = 3000;     // 任一方的搜索分数达到此值即判该方胜
+    int bookDepth = 3;
+    uint64_t seed = 1;
+    string openings = "book";
+    string out = "sfen.bin";
+    bool compress = false;
+
+    uint64_t Fingerprint() const {   // 决定对局内容的参数 (不含线程数与局数)，FNV-1a
+        stringstream ss;
+        ss << nodes << '|' << randomMoves << '|' << maxPlies << '|' << evalLimit << '|' << bookDepth << '|' << openings;
+        uint64_t h = 1469598103934665603ULL;
+        for (char c : ss.str()) { h ^= (uint8_t)c; h *= 1099511628211ULL; }
+        return h;
+    }
+};
+
+// 第 index 局只由 (seed, index) 决定：开局、随机着法、固定节点搜索 (每局清空置换表) 都与线程调度无关
+void PlaySfenGame(const GenSfenOptions& opt, const vector<string>& openings, long long index, TranspositionTable& table, vector<PackedSfen>& out) {
+    seed_seq seq{(uint32_t)opt.seed, (uint32_t)(opt.seed >> 32), (uint32_t)index, (uint32_t)(index >> 32)};
+    mt19937_64 rng(seq);
+    vector<Move> legal;
+    // 开局库出口之后再走若干步均匀随机的着法；走到终局则重新抽取
+    for (;;) {
+        LoadFEN(openings[rng() % openings.size()]);
+        for (int k = 0; k < opt.randomMoves; ++k) {
+            GenerateLegalMoves(legal);
+            if (legal.empty()) break;
+            MakeMove(legal[rng() % legal.size()]);
+        }
+        GenerateLegalMoves(legal);
+        if (!legal.empty() && !IsInsufficientMaterial() && halfmoveClock < 100 && positionHistory[GeneratePositionKey()] < 3) break;
+    }
+    table.Clear();
+    out.clear();
+    int whiteResult = 0;
+    for (int ply = 0; ply < opt.maxPlies; ++ply) {
+        GenerateLegalMoves(legal);
+        if (legal.empty()) { whiteResult = IsInCheck() ? (currentPlayer == WHITE ? -1 : 1) : 0; break; }
+        if (positionHistory[GeneratePositionKey()] >= 3 || halfmoveClock >= 100 || IsInsufficientMaterial()) break;
+
+        bool inCheck = IsInCheck();
+        SearchBestMove(2);
+        const Move& m = searchBestMove;
+        double score = searchBestScore;
+        bool noisy = board[m.to.x][m.to.y] != EMPTY_PIECE || m.promotion != EMPTY_PIECE
+                  || ((board[m.from.x][m.from.y] & PIECE_TYPE_MASK) == PAWN && m.to == enPassantTarget);
+        PackedSfen rec;
+        if (PackSfen(rec)) {
+            rec.score = (int16_t)lround(max<double>(-SFEN_SCORE_LIMIT, min<double>(SFEN_SCORE_LIMIT, score)));
+            rec.flags = (inCheck ? SFEN_IN_CHECK : 0) | (noisy ? SFEN_NOISY : 0);
+            out.push_back(rec);
+        }
+        if (fabs(score) >= opt.evalLimit) { whiteResult = ((score > 0) == (currentPlayer == WHITE)) ? 1 : -1; break; }
+        MakeMove(m);
+    }
+    for (auto& r : out) r.result = (int8_t)((r.state & 1) == WHITE ? whiteResult : -whiteResult);
+    if (!out.empty()) out.back().flags |= SFEN_GAME_END;
+}
+
+// 按对局编号顺序写出；压缩时攒满一块 (且恰在一局结束处) 才写
+struct SfenWriter {
+    FILE* file = nullptr;
+    bool compressed = false;
+    long long positions = 0;
+    vector<PackedSfen> block;
+    vector<uint8_t> bytes;
+
+    void Write(const vector<PackedSfen>& game) {
+        positions += game.size();
+        if (!compressed) { fwrite(game.data(), sizeof(PackedSfen), game.size(), file); return; }
+        block.insert(block.end(), game.begin(), game.end());
+        if (block.size() >= SFEN_BLOCK_RECORDS) Flush();
+    }
+    void Flush() {
+        if (compressed && !block.empty()) {
+            CompressSfenBlock(block, bytes);
+            uint32_t head[2] = {(uint32_t)block.size(), (uint32_t)bytes.size()};
+            fwrite(head, sizeof(head), 1, file);
+            fwrite(bytes.data(), 1, bytes.size(), file);
+            block.clear();
+        }
+        fflush(file);
+    }
+};
+
+// 续写：统计已完整写入的对局 (以 SFEN_GAME_END 计)，返回有效数据的末尾位置，其后的残缺部分由调用者截掉
+long ScanSfenFile(FILE* file, bool compressed, long long& games, long long& positions) {
+    long valid = (long)sizeof(SfenFileHeader);
+    games = positions = 0;
+    vector<PackedSfen> records;
+    if (compressed) {
+        vector<uint8_t> bytes;
+        bool read;
+        while (ReadSfenBlock(file, bytes, records, read) && (records.back().flags & SFEN_GAME_END)) {
+            for (const auto& r : records) games += (r.flags & SFEN_GAME_END) != 0;
+            positions += records.size();
+            valid = ftell(file);
+        }
+    } else {
+        records.resize(SFEN_BLOCK_RECORDS);
+        long long seen = 0;
+        size_t got;
+        while ((got = fread(records.data(), sizeof(PackedSfen), records.size(), file)) > 0) {
+            for (size_t i = 0; i < got; ++i) {
+                if (!(records[i].flags & SFEN_GAME_END)) continue;
+                games++;
+                positions = seen + i + 1;
+            }
+            seen += got;
+        }
+        valid += (long)(positions * sizeof(PackedSfen));
+    }
+    return valid;
+}
+
+bool TruncateFile(FILE* file, long size) {
+    fflush(file);
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), size) == 0;
+#else
+    return ftruncate(fileno(file), size) == 0;
+#endif
+}
+
+int GenerateSfen(const GenSfenOptions& opt) {
+    vector<string> openings, candidates;
+    if (!LoadMatchOpenings(opt.openings, opt.bookDepth, candidates)) return 2;
+    vector<Move> legal;
+    for (const auto& fen : candidates) {   // 去掉无合法着法或无法打包的开局
+        LoadFEN(fen);
+        PackedSfen probe;
+        GenerateLegalMoves(legal);
+        if (!legal.empty() && PackSfen(probe)) openings.push_back(fen);
+    }
+    if (openings.empty()) { cout << "Error: No usable opening positions in '" << opt.openings << "'" << endl; return 2; }
+
+    SfenFileHeader header = {};
+    memcpy(header.magic, SFEN_MAGIC, sizeof(SFEN_MAGIC));
+    header.flags = opt.compress ? SFEN_FILE_COMPRESSED : 0;
+    header.seed = opt.seed;
+    header.settings = opt.Fingerprint();
+    long long done = 0, existing = 0;
+    FILE* file = fopen(opt.out.c_str(), "r+b");
+    if (file) {
+        SfenFileHeader h;
+        if (!ReadSfenHeader(file, h)) { fclose(file); cout << "Error: '" << opt.out << "' exists and is not a packed training data file." << endl; return 2; }
+        if (h.flags != header.flags || h.seed != header.seed || h.settings != header.settings) {
+            fclose(file);
+            cout << "Error: '" << opt.out << "' was generated with a different seed, compression or settings; use another -out file." << endl;
+            return 2;
+        }
+        long valid = ScanSfenFile(file, opt.compress, done, existing);
+        if (!TruncateFile(file, valid) || fseek(file, valid, SEEK_SET) != 0) { fclose(file); cout << "Error: Could not resume '" << opt.out << "'" << endl; return 2; }
+        cout << "info string Resuming '" << opt.out << "' after " << done << " games (" << existing << " positions)" << endl;
+    } else {
+        file = fopen(opt.out.c_str(), "w+b");
+        if (!file) { cout << "Error: Could not create '" << opt.out << "'" << endl; return 2; }
+        fwrite(&header, sizeof(header), 1, file);
+    }
+    if (done >= opt.games) { fclose(file); cout << "info string '" << opt.out << "' already holds " << done << " games." << endl; return 0; }
+    cout << "Generating " << opt.games - done << " games at " << opt.nodes << " nodes per move with " << opt.threads << " threads ("
+         << openings.size() << " openings, " << opt.randomMoves << " random moves, seed " << opt.seed << ")" << endl;
+
+    SfenWriter writer;
+    writer.file = file;
+    writer.compressed = opt.compress;
+    atomic<long long> nextGame(done);
+    mutex lock;
+    map<long long, vector<PackedSfen>> pending;   // 已下完但前面还有对局未写出
+    long long nextToWrite = done;
+    auto start = chrono::steady_clock::now();
+    auto lastReport = start;
+    auto worker = [&](int t) {
+        BindSearchThread(t);
+        TranspositionTable table;
+        table.Allocate(ttDefaultSizeMB);
+        SetThreadTT(&table);
+        searchQuiet = true;
+        searchMultiPV = 1;
+        searchMaxDepth = 64;
+        searchTimeLimitMs = numeric_limits<int>::max();
+        searchNodeLimit = opt.nodes;
+        vector<PackedSfen> game;
+        for (long long idx; (idx = nextGame++) < opt.games;) {
+            PlaySfenGame(opt, openings, idx, table, game);
+            lock_guard<mutex> guard(lock);
+            pending[idx].swap(game);
+            for (auto it = pending.begin(); it != pending.end() && it->first == nextToWrite; it = pending.erase(it), ++nextToWrite) writer.Write(it->second);
+            auto now = chrono::steady_clock::now();
+            if (now - lastReport >= chrono::seconds(10)) {
+                double secs = chrono::duration<double>(now - start).count();
+                cout << "info string " << nextToWrite << "/" << opt.games << " games, " << existing + writer.positions << " positions, "
+                     << (long long)(writer.positions / secs) << " positions/s" << endl;
+                lastReport = now;
+            }
+        }
+        SetThreadTT(nullptr);
+    };
+    vector<thread> pool;
+    for (int t = 0; t < opt.threads; ++t) pool.emplace_back(worker, t);
+    for (auto& th : pool) th.join();
+    writer.Flush();
+    long bytes = ftell(file);
+    fclose(file);
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long total = existing + writer.positions;
+    cout << "Wrote " << writer.positions << " positions from " << opt.games - done << " games in " << fixed << setprecision(1) << secs << "s ("
+         << (long long)(writer.positions / max(1e-3, secs)) << " positions/s)" << endl;
+    cout << "'" << opt.out << "' holds " << total << " positions from " << opt.games << " games, " << bytes << " bytes ("
+         << setprecision(2) << (double)(bytes - (long)sizeof(SfenFileHeader)) / max(1LL, total) << " bytes/position)" << endl;
+    cout << defaultfloat << setprecision(6);
+    return 0;
+}
+
+// --- gensfen 命令 ---
+void PrintGenSfenUsage() {
+    cout << "Usage: gensfen [-games N] [-nodes N] [-threads N] [-seed N] [-out FILE] [-compress]\n"
+            "               [-openings book|FILE.epd] [-bookdepth N] [-randommoves N] [-maxplies N] [-evallimit CP]\n"
+            "       gensfen read FILE... [-shuffle N] [-seed N] [-limit N] [-quiet]\n"
+            "       gensfen stats FILE...\n"
+            "Plays fixed-node self-play games (default 1000 games, 5000 nodes per move) from book positions followed\n"
+            "by -randommoves uniformly random moves, and writes every searched position to FILE (default sfen.bin) as\n"
+            "a 32-byte record: board, side to move, castling, en passant, search score, ply and game result.\n"
+            "-compress stores the records in independently compressed blocks. Game I depends only on the seed and I,\n"
+            "so the output is identical for any thread count; if FILE exists with the same seed and settings,\n"
+            "generation resumes after its last complete game until FILE holds N games.\n"
+            "read prints 'FEN score [result]' lines (a format 'tune' accepts), shuffled through an N-record buffer\n"
+            "across all files; -quiet skips positions in check or whose best move captures or promotes.\n"
+            "tune -data also reads packed files directly." << endl;
+}
+
+int RunGenSfen(int argc, char* argv[]) {
+    string mode = (argc > 0 && argv[0][0] != '-') ? argv[0] : "";
+    if (!mode.empty() && mode != "read" && mode != "stats") { PrintGenSfenUsage(); return 2; }
+    GenSfenOptions opt;
+    opt.threads = max(1u, thread::hardware_concurrency());
+    vector<string> files;
+    size_t shuffle = 0;
+    long long limit = 0;
+    bool quietOnly = false;
+    try {
+        for (int i = mode.empty() ? 0 : 1; i < argc; ++i) {
+            string a = argv[i];
+            if (!mode.empty() && a[0] != '-') files.push_back(a);
+            else if (a == "-seed" && i + 1 < argc) opt.seed = stoull(argv[++i]);
+            else if (mode == "read" && a == "-shuffle" && i + 1 < argc) shuffle = stoull(argv[++i]);
+            else if (mode == "read" && a == "-limit" && i + 1 < argc) limit = stoll(argv[++i]);
+            else if (mode == "read" && a == "-quiet") quietOnly = true;
+            else if (!mode.empty()) { PrintGenSfenUsage(); return 2; }
+            else if (a == "-games" && i + 1 < argc) opt.games = max(1LL, stoll(argv[++i]));
+            else if (a == "-nodes" && i + 1 < argc) opt.nodes = max(1LL, stoll(argv[++i]));
+            else if (a == "-threads" && i + 1 < argc) opt.threads = max(1, stoi(argv[++i]));
+            else if (a == "-out" && i + 1 < argc) opt.out = argv[++i];
+            else if (a == "-compress") opt.compress = true;
+            else if (a == "-openings" && i + 1 < argc) opt.openings = argv[++i];
+            else if (a == "-bookdepth" && i + 1 < argc) opt.bookDepth = stoi(argv[++i]);
+            else if (a == "-randommoves" && i + 1 < argc) opt.randomMoves = max(0, stoi(argv[++i]));
+            else if (a == "-maxplies" && i + 1 < argc) opt.maxPlies = max(1, stoi(argv[++i]));
+            else if (a == "-evallimit" && i + 1 < argc) opt.evalLimit = max(1, stoi(argv[++i]));
+            else { PrintGenSfenUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintGenSfenUsage(); return 2; }
+    if (mode.empty()) return GenerateSfen(opt);
+    if (files.empty()) { PrintGenSfenUsage(); return 2; }
+
+    SfenReader reader;
+    if (!reader.Open(files, shuffle, opt.seed)) return 2;
+    PackedSfen s;
+    if (mode == "read") {
+        const char* results[] = {"0.0", "0.5", "1.0"};
+        for (long long n = 0; (limit == 0 || n < limit) && reader.Next(s);) {
+            if (quietOnly && (s.flags & (SFEN_IN_CHECK | SFEN_NOISY))) continue;
+            int white = (s.state & 1) == WHITE ? s.result : -s.result;
+            cout << SfenToFEN(s) << " " << s.score << " [" << results[white + 1] << "]\n";
+            n++;
+        }
+        cout.flush();
+        return 0;
+    }
+    long long positions = 0, games = 0, inCheck = 0, noisy = 0, outcomes[3] = {0, 0, 0}, plies = 0;
+    double absScore = 0;
+    while (reader.Next(s)) {
+        positions++;
+        inCheck += (s.flags & SFEN_IN_CHECK) != 0;
+        noisy += (s.flags & SFEN_NOISY) != 0;
+        absScore += abs(s.score);
+        plies += s.ply;
+        if (s.flags & SFEN_GAME_END) { games++; outcomes[((s.state & 1) == WHITE ? s.result : -s.result) + 1]++; }
+    }
+    cout << "Positions       : " << positions << endl;
+    cout << "Games           : " << games << " (white " << outcomes[2] << ", draw " << outcomes[1] << ", black " << outcomes[0] << ")" << endl;
+    cout << fixed << setprecision(1);
+    cout << "Positions/game  : " << (double)positions / max(1LL, games) << endl;
+    cout << "Mean ply        : " << (double)plies / max(1LL, positions) << endl;
+    cout << "Mean |score|    : " << absScore / max(1LL, positions) << endl;
+    cout << "In check        : " << 100.0 * inCheck / max(1LL, positions) << "%" << endl;
+    cout << "Noisy best move : " << 100.0 * noisy / max(1LL, positions) << "%" << endl;
+    cout << defaultfloat << setprecision(6);
+    return 0;
+}
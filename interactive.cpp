@@ -0,0 +1,216 @@
+// interactive.cpp
+//Starfish --- chess engine developed by dsyoier
+//人机对弈界面 (两个可执行文件共用)：棋盘与人类走子在调用线程上处理，引擎着法交给 Engine 对象搜索
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+int RunInteractive(TranspositionTable* sharedTable) {
+    cout << "\nSelect Game Mode:" << endl;
+    cout << "1. Start a new game" << endl;
+    cout << "2. Load position from FEN string" << endl;
+    cout << "3. Load game from PGN file" << endl;
+    cout << "Enter your choice (1-3): ";
+
+    int mode_choice;
+    cin >> mode_choice;
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    switch (mode_choice) {
+        case 2: {
+            cout << "Enter FEN string: ";
+            string fen;
+            getline(cin, fen);
+            Position pos;
+            if (!pos.SetFEN(fen)) { cout << "Error: Invalid FEN '" << fen << "'" << endl; return 1; }
+            pos.Load();
+            break;
+        }
+        case 3: {
+            cout << "Enter PGN file name (e.g., game.pgn): ";
+            string filename;
+            getline(cin, filename);
+            if (!LoadPGN(filename)) return 1;
+            break;
+        }
+        default:
+            SetBoard();
+            break;
+    }
+
+
+    int enginePlayerColor = -1;
+    cout << "\nWhich color should the engine play as? (w for white, b for black): ";
+    char choice;
+    while (cin >> choice) {
+        choice = tolower(choice);
+        if (choice == 'w') { enginePlayerColor = WHITE; break; }
+        else if (choice == 'b') { enginePlayerColor = BLACK; break; }
+        else { cout << "Invalid input. Please enter 'w' or 'b': "; }
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    const int MIN_SEARCH_DEPTH = 6;
+    const int MAX_SEARCH_TIME_MS = 8000;
+    Engine engine(0, sharedTable);
+    engine.Run([] { searchQuiet = false; });   // 引擎线程直接打印 info 行
+    int multiPV = 1;
+    // 后台思考：人类走子期间搜索预测着法之后的局面 (没有预测时搜索当前局面，只为预热置换表与历史表)
+    bool ponderEnabled = true;
+    Move predicted;                 // 引擎上一步主变例中的第二步
+    bool ponderHit = false;
+    int ponderMs = 0, ponderDepth = 0;
+    SearchResult ponderResult;
+
+    while (true) {
+        PrintBoard();
+
+        if (positionHistory[GeneratePositionKey()] >= 3) { cout << "Draw by three-fold repetition!" << endl; break; }
+        if (halfmoveClock >= 100) { cout << "Draw by 50-move rule!" << endl; break; }
+
+        vector<Move> legal_moves; GenerateLegalMoves(legal_moves);
+        if (legal_moves.empty()) {
+            if (IsInCheck()) { cout << "Checkmate! " << ((currentPlayer == WHITE) ? "Black" : "White") << " Player Won." << endl;
+            } else { cout << "Stalemate! It's a draw." << endl; }
+            break;
+        }
+
+        if (currentPlayer == enginePlayerColor) {
+            bool book_move_found = false;
+            string current_fen = GenerateFEN();
+            auto book = openingBook.find(current_fen);
+            if (book != openingBook.end()) {
+                string uci_move_str = book->second;
+                Move book_move = parse_uci_move(uci_move_str);
+                bool is_legal = find(legal_moves.begin(), legal_moves.end(), book_move) != legal_moves.end();
+                if (is_legal) {
+                    cout << "----------------------------------" << endl;
+                    cout << "StarFish plays from its opening book (FEN: " << current_fen << ")" << endl;
+                    cout << "Move: " << uci_move_str << endl;
+                    cout << "----------------------------------" << endl;
+                    MakeMove(book_move); book_move_found = true;
+                    predicted = Move();
+                }
+            }
+            if (!book_move_found && ponderHit && ponderDepth >= MIN_SEARCH_DEPTH && ponderMs >= MAX_SEARCH_TIME_MS && ponderResult.best.from.ok()) {
+                // 预测命中且后台已用满一步的时间：直接采用后台搜索的结果
+                cout << "----------------------------------" << endl;
+                cout << "AI has made its move (ponder hit, depth " << ponderDepth << " searched while you thought)." << endl;
+                cout << "Move: From (" << (char)('a' + ponderResult.best.from.x - 1) << ponderResult.best.from.y << ") to (" << (char)('a' + ponderResult.best.to.x - 1) << ponderResult.best.to.y << ")" << endl;
+                cout << "Total Nodes Computed: " << ponderResult.nodes << endl;
+                cout << "Total Time Taken: " << ponderMs / 1000.0 << " seconds (in the background)" << endl;
+                cout << "----------------------------------" << endl;
+                MakeMove(ponderResult.best);
+                predicted = ponderResult.ponder;
+                book_move_found = true;
+            }
+            if (!book_move_found) {
+                string engineColorStr = (enginePlayerColor == WHITE ? "White" : "Black");
+                cout << "StarFish (" << engineColorStr << ") is thinking (min depth " << MIN_SEARCH_DEPTH
+                     << ", max time " << MAX_SEARCH_TIME_MS / 1000.0 << "s)..." << endl;
+                Position pos;
+                pos.Capture();
+                engine.SetPosition(pos);
+#ifdef STARFISH_PROFILE
+                engine.Run([] { ResetProfile(); });
+#endif
+                SearchLimits limits;
+                limits.minDepth = MIN_SEARCH_DEPTH;
+                limits.timeMs = MAX_SEARCH_TIME_MS;
+                limits.multiPV = multiPV;
+                if (ponderHit) {   // 后台已搜过这个局面：只用剩余的时间，浅层迭代从置换表中几乎立即完成
+                    limits.timeMs = max(1, MAX_SEARCH_TIME_MS - ponderMs);
+                    cout << "info string Ponder hit after " << ponderMs << " ms (depth " << ponderDepth << "); " << limits.timeMs << " ms left." << endl;
+                }
+                SearchResult result = engine.Search(limits);
+                predicted = result.ponder;
+
+                cout << "----------------------------------" << endl;
+                cout << "AI has made its move." << endl;
+                cout << "Move: From (" << (char)('a' + result.best.from.x - 1) << result.best.from.y << ") to (" << (char)('a' + result.best.to.x - 1) << result.best.to.y << ")" << endl;
+                cout << "Total Nodes Computed: " << result.nodes << endl;
+                cout << "Total Time Taken: " << result.timeMs / 1000.0 << " seconds" << endl;
+                cout << "----------------------------------" << endl;
+                MakeMove(result.best);
+            }
+        } else {
+             string playerColorStr = (currentPlayer == WHITE ? "White" : "Black");
+             cout << "Your turn (" << playerColorStr << ")." << endl;
+             cout << "Enter your move in algebraic notation (e.g., e4, Nf3, O-O): ";
+             Position ponderPosition;
+             ponderPosition.Capture();
+             Move guess = predicted;
+             if (guess.from.ok() && !ponderPosition.Play(guess)) guess = Move();
+             bool pondering = ponderEnabled;
+             atomic<int> depthReached(0);
+             auto ponderStart = chrono::steady_clock::now();
+             if (pondering) {
+                 engine.Run([] { searchQuiet = true; });
+                 engine.SetPosition(ponderPosition);
+                 SearchLimits ponderLimits;   // 不限深度与时间，直到输入到达
+                 ponderLimits.minDepth = 1;
+                 engine.Go(ponderLimits, [&depthReached](const SearchInfo& info) { depthReached = info.depth; });
+             }
+             // 任何输入都先结束后台搜索 (停止后等待工作线程空闲，之后才能向引擎提交别的任务)
+             auto stopPondering = [&] {
+                 if (!pondering) return;
+                 pondering = false;
+                 engine.Stop();
+                 engine.Wait();
+                 ponderMs = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - ponderStart).count();
+                 ponderDepth = depthReached;
+                 ponderResult = engine.LastResult();
+                 engine.Run([] { searchQuiet = false; });
+             };
+             ponderHit = false;
+             string san_input;
+             while (getline(cin, san_input)) {
+                stopPondering();
+                if (san_input.empty()) continue;
+                if (san_input == "profile") {
+#ifdef STARFISH_PROFILE
+                    long long nodes = engine.LastResult().nodes;
+                    engine.Run([nodes] { PrintProfile(nodes); });
+#else
+                    cout << "Profiling is not compiled in (build with -DSTARFISH_PROFILE)." << endl;
+#endif
+                    cout << "Enter your move: ";
+                    continue;
+                }
+                if (san_input.compare(0, 6, "ponder") == 0) {
+                    ponderEnabled = san_input.find("off") == string::npos;
+                    cout << "Thinking on your time " << (ponderEnabled ? "enabled" : "disabled") << ". Enter your move: ";
+                    continue;
+                }
+                if (san_input.compare(0, 8, "multipv ") == 0) {
+                    multiPV = max(1, atoi(san_input.c_str() + 8));
+                    cout << "MultiPV set to " << multiPV << ". Enter your move: ";
+                    continue;
+                }
+                Move human_move = ParseAlgebraicMove(san_input, legal_moves);
+                if (human_move.from.ok()) {
+                    ponderHit = guess.from.ok() && human_move == guess;
+                    MakeMove(human_move);
+                    break;
+                } else {
+                    cout << "Invalid or illegal move '" << san_input << "'. Try again: ";
+                }
+            }
+            stopPondering();
+            if (cin.eof()) break;
+        }
+    }
+#ifdef STARFISH_STATS
+    engine.Run([] { ReportGameStats("interactive"); });
+#endif
+    return 0;
+}
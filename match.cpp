@@ -0,0 +1,346 @@
+// match.cpp
+//Starfish --- chess engine developed by dsyoier
+//自对弈测试 (match)
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <cmath>
+#include <iomanip>
+#include <functional>
+#include <memory>
+#include <cstdlib>
+
+using namespace std;
+
+// --- 自对弈测试 (match)：并发对局、裁决、Elo/LOS/SPRT 统计与 PGN 输出 ---
+struct MatchEngine {
+    string name;
+    int depth = 0;
+    int timeMs = 0;
+    long long nodes = 0;
+    ParamSet params;
+};
+struct MatchOptions {
+    int games = 100;
+    int concurrency = 1;
+    int maxPlies = 400;
+    int drawMoveNumber = 40, drawMoveCount = 8, drawScore = 10;
+    int resignMoveCount = 3, resignScore = 600;
+    bool sprt = false;
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+    string pgnOut;
+};
+struct GameRecord {
+    string startFen;
+    vector<string> sanMoves;
+    vector<string> comments;
+    string result;
+    string termination;
+};
+
+void ConfigureMatchSearch(const MatchEngine& e) {
+    searchQuiet = true;
+    searchMaxDepth = (e.depth > 0) ? e.depth : 64;
+    searchNodeLimit = e.nodes;
+    searchTimeLimitMs = (e.timeMs > 0) ? e.timeMs : numeric_limits<int>::max();
+}
+
+void PlayMatchGame(const string& fen, const MatchEngine& white, const MatchEngine& black, const MatchOptions& opt, GameRecord& rec) {
+    LoadFEN(fen);
+    rec.startFen = GenerateFEN();
+    int losingStreak[2] = {0, 0};
+    double lastScore[2] = {0, 0};
+    int drawStreak = 0;
+    TranspositionTable tables[2];   // 双方各用一张私有置换表 (参数可能不同)
+    for (auto& t : tables) t.Allocate(ttDefaultSizeMB);
+    struct RestoreTT { ~RestoreTT() { SetThreadTT(nullptr); } } restoreTT;
+    // 评估参数只在开局应用一次；双方参数不同时各用一张评估缓存，轮到一方时连同它的参数一起换入
+    bool sameParams = white.params == black.params;
+    unique_ptr<EvalCacheEntry[]> caches[2];
+    int applied = -1;
+    if (sameParams) ApplyEvalParams(white.params);
+    for (int ply = 0; ; ++ply) {
+        vector<Move> legal_moves; GenerateLegalMoves(legal_moves);
+        if (legal_moves.empty()) {
+            if (IsInCheck()) { rec.result = (currentPlayer == WHITE) ? "0-1" : "1-0"; rec.termination = "checkmate"; }
+            else { rec.result = "1/2-1/2"; rec.termination = "stalemate"; }
+            return;
+        }
+        if (positionHistory[GeneratePositionKey()] >= 3) { rec.result = "1/2-1/2"; rec.termination = "3-fold repetition"; return; }
+        if (halfmoveClock >= 100) { rec.result = "1/2-1/2"; rec.termination = "fifty moves rule"; return; }
+        if (IsInsufficientMaterial()) { rec.result = "1/2-1/2"; rec.termination = "insufficient material"; return; }
+        // 残局库裁决：全局选项 -tbpath 载入的表覆盖当前局面时，按探查结果 (相对于走子方) 判定胜负
+        TBProbe tb;
+        if (tablebaseMaxPieces && ProbeTablebase(tb)) {
+            rec.result = (tb.wdl == 0) ? "1/2-1/2" : ((tb.wdl > 0) == (currentPlayer == WHITE) ? "1-0" : "0-1");
+            rec.termination = "adjudication: tablebase"; return;
+        }
+        if (ply >= opt.maxPlies) { rec.result = "1/2-1/2"; rec.termination = "adjudication: max plies"; return; }
+
+        const MatchEngine& side = (currentPlayer == WHITE) ? white : black;
+        ConfigureMatchSearch(side);
+        if (!sameParams && applied != currentPlayer) {
+            if (applied >= 0) SwapEvalCache(caches[applied]);
+            ApplyEvalParams(side.params);
+            SwapEvalCache(caches[currentPlayer]);
+            applied = currentPlayer;
+        }
+        SetThreadTT(&tables[currentPlayer]);
+        SearchBestMove(side.depth > 0 ? side.depth : 2);
+        double score = searchBestScore;
+        auto end_time = chrono::high_resolution_clock::now();
+        chrono::duration<double> diff = end_time - searchStartTime;
+
+        int mover = currentPlayer;
+        stringstream comment;
+        comment << showpos << fixed << setprecision(2) << max(-999.0, min(999.0, score / 100.0)) << noshowpos
+                << "/" << iterative_deepening_current_depth << " " << setprecision(3) << diff.count() << "s";
+        rec.sanMoves.push_back(MoveToSAN(searchBestMove, legal_moves));
+        rec.comments.push_back(comment.str());
+        MakeMove(searchBestMove);
+
+        // 认输裁决：走棋方连续若干步自评落后超过阈值，且对方同样认为自己领先
+        lastScore[mover] = score;
+        losingStreak[mover] = (score <= -opt.resignScore) ? losingStreak[mover] + 1 : 0;
+        if (opt.resignMoveCount > 0 && losingStreak[mover] >= opt.resignMoveCount && lastScore[1 - mover] >= opt.resignScore) {
+            rec.result = (mover == WHITE) ? "0-1" : "1-0"; rec.termination = "adjudication: resign"; return;
+        }
+        // 和棋裁决：达到指定回合后双方连续若干步评估都接近 0
+        drawStreak = (fabs(score) <= opt.drawScore) ? drawStreak + 1 : 0;
+        if (opt.drawMoveCount > 0 && Round >= opt.drawMoveNumber && drawStreak >= opt.drawMoveCount) {
+            rec.result = "1/2-1/2"; rec.termination = "adjudication: draw"; return;
+        }
+    }
+}
+
+string FormatPGN(const GameRecord& rec, const string& whiteName, const string& blackName, int round) {
+    stringstream pgn;
+    time_t t = time(nullptr);
+    char date[16]; strftime(date, sizeof(date), "%Y.%m.%d", localtime(&t));
+    pgn << "[Event \"Starfish match\"]\n[Site \"local\"]\n[Date \"" << date << "\"]\n[Round \"" << round << "\"]\n"
+        << "[White \"" << whiteName << "\"]\n[Black \"" << blackName << "\"]\n[Result \"" << rec.result << "\"]\n";
+    if (rec.startFen != "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") {
+        pgn << "[FEN \"" << rec.startFen << "\"]\n[SetUp \"1\"]\n";
+    }
+    pgn << "[PlyCount \"" << rec.sanMoves.size() << "\"]\n";
+    pgn << "[Termination \"" << (rec.termination.compare(0, 11, "adjudicatio") == 0 ? "adjudication" : "normal") << "\"]\n\n";
+
+    stringstream fs(rec.startFen);
+    string field; int side = WHITE, moveNumber = 1;
+    for (int i = 0; fs >> field; ++i) { if (i == 1) side = (field == "w") ? WHITE : BLACK; if (i == 5) moveNumber = stoi(field); }
+    string line;
+    auto emit = [&](const string& token) {
+        if (!line.empty() && line.size() + 1 + token.size() > 79) { pgn << line << "\n"; line.clear(); }
+        line += (line.empty() ? "" : " ") + token;
+    };
+    for (size_t i = 0; i < rec.sanMoves.size(); ++i) {
+        if (side == WHITE) emit(to_string(moveNumber) + ".");
+        else if (i == 0) emit(to_string(moveNumber) + "...");
+        emit(rec.sanMoves[i]);
+        emit("{" + rec.comments[i] + "}");
+        if (side == BLACK) moveNumber++;
+        side = 1 - side;
+    }
+    emit("{" + rec.termination + "}");
+    emit(rec.result);
+    pgn << line << "\n\n";
+    return pgn.str();
+}
+
+double EloToScore(double elo) { return 1.0 / (1.0 + pow(10.0, -elo / 400.0)); }
+double ScoreToElo(double s) { s = max(1e-6, min(1.0 - 1e-6, s)); return -400.0 * log10(1.0 / s - 1.0); }
+// 正态近似下的广义 SPRT (GSPRT) 对数似然比
+double SprtLLR(int w, int d, int l, double elo0, double elo1) {
+    double n = w + d + l;
+    if (n == 0) return 0;
+    double s = (w + 0.5 * d) / n;
+    double var = (w + 0.25 * d) / n - s * s;
+    if (var <= 0) return 0;
+    double s0 = EloToScore(elo0), s1 = EloToScore(elo1);
+    return n * (s1 - s0) * (2 * s - s0 - s1) / (2 * var);
+}
+void PrintMatchStats(const string& a, const string& b, int w, int d, int l, const MatchOptions& opt) {
+    int n = w + d + l;
+    double s = (w + 0.5 * d) / n;
+    double var = (w + 0.25 * d) / n - s * s;
+    double margin = 1.96 * sqrt(max(0.0, var) / n);
+    double elo = ScoreToElo(s);
+    double elo_err = (ScoreToElo(s + margin) - ScoreToElo(s - margin)) / 2;
+    double los = (w + l > 0) ? 0.5 * (1 + erf((w - l) / sqrt(2.0 * (w + l)))) : 0.5;
+    cout << "Score of " << a << " vs " << b << ": " << w << " - " << l << " - " << d << "  [" << fixed << setprecision(3) << s << "] " << n << endl;
+    cout << "Elo difference: " << setprecision(1) << elo << " +/- " << elo_err << ", LOS: " << los * 100 << " %" << endl;
+    if (opt.sprt) {
+        double lower = log(opt.beta / (1 - opt.alpha)), upper = log((1 - opt.beta) / opt.alpha);
+        cout << "SPRT: llr " << setprecision(2) << SprtLLR(w, d, l, opt.elo0, opt.elo1) << " (" << lower << ", " << upper
+             << "), elo0 " << opt.elo0 << " elo1 " << opt.elo1 << endl;
+    }
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+bool ParseEngineSpec(const vector<string>& tokens, MatchEngine& e, const ParamSet& defaults) {
+    for (const auto& tok : tokens) {
+        size_t eq = tok.find('=');
+        if (eq == string::npos) { cout << "Error: Bad engine option '" << tok << "'" << endl; return false; }
+        string key = tok.substr(0, eq), value = tok.substr(eq + 1);
+        try {
+            if (key == "name") e.name = value;
+            else if (key == "depth") e.depth = stoi(value);
+            else if (key == "time") e.timeMs = stoi(value);
+            else if (key == "nodes") e.nodes = stoll(value);
+            else if (key == "params") { if (!LoadEvalParamFile(value, defaults, e.params)) return false; }
+            else { cout << "Error: Unknown engine option '" << key << "'" << endl; return false; }
+        } catch (const std::exception&) { cout << "Error: Bad value in engine option '" << tok << "'" << endl; return false; }
+    }
+    return true;
+}
+
+bool LoadMatchOpenings(const string& source, int bookDepth, vector<string>& openings) {
+    if (source == "book") {
+        for (const auto& entry : openingBook) {
+            size_t last_space = entry.first.rfind(' ');
+            if (last_space != string::npos && atoi(entry.first.c_str() + last_space + 1) >= bookDepth) openings.push_back(entry.first);
+        }
+    } else {
+        ifstream in(source);
+        if (!in.is_open()) { cout << "Error: Could not open opening file '" << source << "'" << endl; return false; }
+        string line;
+        while (getline(in, line)) {
+            stringstream ss(line);
+            string f[6]; int n = 0;
+            while (n < 6 && ss >> f[n]) n++;
+            if (n < 4) continue;
+            bool has_clocks = (n == 6 && isdigit(f[4][0]) && isdigit(f[5][0]));
+            openings.push_back(f[0] + " " + f[1] + " " + f[2] + " " + f[3] + (has_clocks ? " " + f[4] + " " + f[5] : string(" 0 1")));
+        }
+    }
+    if (openings.empty()) { cout << "Error: No opening positions found in '" << source << "'" << endl; return false; }
+    return true;
+}
+
+void PrintMatchUsage() {
+    cout << "Usage: chess_AI_multithreads match -engine name=A [depth=N] [time=MS] [nodes=N] [params=FILE]\n"
+            "                                  -engine name=B ... [-each OPTIONS...]\n"
+            "       [-games N] [-concurrency N] [-openings book|FILE.epd] [-bookdepth N] [-seed N]\n"
+            "       [-pgnout FILE] [-maxplies N] [-draw MOVENUMBER MOVECOUNT SCORE] [-resign MOVECOUNT SCORE]\n"
+            "       [-sprt ELO0 ELO1 ALPHA BETA]\n"
+            "Each opening is played twice with colors reversed. Positions covered by the tablebases loaded\n"
+            "with the global option -tbpath are adjudicated from the table. With -sprt the exit status is\n"
+            "0 when H1 is accepted, 1 when H0 is accepted and 2 when the test is inconclusive." << endl;
+}
+
+int RunMatch(int argc, char* argv[]) {
+    ParamSet defaults = CaptureEvalParams();
+    MatchOptions opt;
+    opt.concurrency = max(1u, thread::hardware_concurrency());
+    string openingSource = "book";
+    int bookDepth = 3;
+    unsigned seed = 1;
+    vector<vector<string>> engineTokens;
+    vector<string> eachTokens;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            auto next = [&]() -> string { if (i + 1 >= argc) throw invalid_argument(a); return argv[++i]; };
+            if (a == "-engine" || a == "-each") {
+                vector<string> tokens;
+                while (i + 1 < argc && argv[i + 1][0] != '-') tokens.push_back(argv[++i]);
+                if (a == "-engine") engineTokens.push_back(tokens); else eachTokens = tokens;
+            }
+            else if (a == "-games") opt.games = stoi(next());
+            else if (a == "-concurrency") opt.concurrency = max(1, stoi(next()));
+            else if (a == "-openings") openingSource = next();
+            else if (a == "-bookdepth") bookDepth = stoi(next());
+            else if (a == "-seed") seed = (unsigned)stoul(next());
+            else if (a == "-pgnout") opt.pgnOut = next();
+            else if (a == "-maxplies") opt.maxPlies = stoi(next());
+            else if (a == "-draw") { opt.drawMoveNumber = stoi(next()); opt.drawMoveCount = stoi(next()); opt.drawScore = stoi(next()); }
+            else if (a == "-resign") { opt.resignMoveCount = stoi(next()); opt.resignScore = stoi(next()); }
+            else if (a == "-sprt") { opt.sprt = true; opt.elo0 = stod(next()); opt.elo1 = stod(next()); opt.alpha = stod(next()); opt.beta = stod(next()); }
+            else { cout << "Error: Unknown match option '" << a << "'" << endl; PrintMatchUsage(); return 2; }
+        }
+    } catch (const std::exception&) { cout << "Error: Missing or bad value for match option." << endl; PrintMatchUsage(); return 2; }
+    if (engineTokens.size() != 2) { PrintMatchUsage(); return 2; }
+
+    MatchEngine engines[2];
+    for (int k = 0; k < 2; ++k) {
+        engines[k].name = (k == 0) ? "A" : "B";
+        engines[k].params = defaults;
+        vector<string> tokens = eachTokens;
+        tokens.insert(tokens.end(), engineTokens[k].begin(), engineTokens[k].end());
+        if (!ParseEngineSpec(tokens, engines[k], defaults)) return 2;
+        if (engines[k].depth == 0 && engines[k].timeMs == 0 && engines[k].nodes == 0) engines[k].depth = 4;
+    }
+    vector<string> openings;
+    if (!LoadMatchOpenings(openingSource, bookDepth, openings)) return 2;
+    mt19937 rng(seed);
+    shuffle(openings.begin(), openings.end(), rng);
+
+    ofstream pgnFile;
+    if (!opt.pgnOut.empty()) {
+        pgnFile.open(opt.pgnOut, ios::app);
+        if (!pgnFile.is_open()) { cout << "Error: Could not open PGN output '" << opt.pgnOut << "'" << endl; return 2; }
+    }
+    cout << "Started match of " << opt.games << " games between " << engines[0].name << " and " << engines[1].name
+         << " (" << opt.concurrency << " concurrent, " << openings.size() << " openings)" << endl;
+
+    atomic<int> nextGame(0);
+    atomic<bool> stop(false);
+    mutex resultMutex;
+    int wins = 0, draws = 0, losses = 0, finished = 0;
+    int sprtVerdict = -1;
+    double lower = log(opt.beta / (1 - opt.alpha)), upper = log((1 - opt.beta) / opt.alpha);
+
+    auto worker = [&]() {
+        while (!stop) {
+            int idx = nextGame++;
+            if (idx >= opt.games) break;
+            const string& fen = openings[(idx / 2) % openings.size()];
+            const MatchEngine& white = engines[idx % 2];
+            const MatchEngine& black = engines[1 - idx % 2];
+            GameRecord rec;
+#ifdef STARFISH_STATS
+            ResetGameStats();
+            PlayMatchGame(fen, white, black, opt, rec);
+            ReportGameStats(to_string(idx + 1));
+#else
+            PlayMatchGame(fen, white, black, opt, rec);
+#endif
+
+            lock_guard<mutex> lock(resultMutex);
+            if (stop) break;
+            int a_result = (rec.result == "1/2-1/2") ? 0 : ((rec.result == "1-0") == (idx % 2 == 0) ? 1 : -1);
+            if (a_result > 0) wins++; else if (a_result < 0) losses++; else draws++;
+            finished++;
+            cout << "Finished game " << idx + 1 << " (" << white.name << " vs " << black.name << "): " << rec.result << " {" << rec.termination << "}" << endl;
+            PrintMatchStats(engines[0].name, engines[1].name, wins, draws, losses, opt);
+            if (pgnFile.is_open()) { pgnFile << FormatPGN(rec, white.name, black.name, idx + 1); pgnFile.flush(); }
+            if (opt.sprt) {
+                double llr = SprtLLR(wins, draws, losses, opt.elo0, opt.elo1);
+                if (llr >= upper) { sprtVerdict = 0; stop = true; cout << "SPRT: H1 was accepted" << endl; }
+                else if (llr <= lower) { sprtVerdict = 1; stop = true; cout << "SPRT: H0 was accepted" << endl; }
+            }
+        }
+    };
+    vector<thread> pool;
+    for (int t = 0; t < opt.concurrency; ++t) pool.emplace_back([&worker, t] { BindSearchThread(t); worker(); });
+    for (auto& th : pool) th.join();
+
+    cout << "Finished match (" << finished << " games)" << endl;
+    if (finished > 0) PrintMatchStats(engines[0].name, engines[1].name, wins, draws, losses, opt);
+    if (!opt.sprt) return 0;
+    return (sprtVerdict >= 0) ? sprtVerdict : 2;
+}
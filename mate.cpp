@@ -0,0 +1,347 @@
+// mate.cpp
+//Starfish --- chess engine developed by dsyoier
+//将杀求解 (mate 命令与 Engine 的 go mate N)：深度优先证明数搜索 (df-pn)。
+//攻方只走将军着法，守方走全部合法着法；独立的置换表按 (局面, 攻方剩余步数) 保存证明数与反证数，
+//剩余步数严格递减，因此搜索图中没有环。
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <cstring>
+#include <random>
+
+using namespace std;
+
+// --- 证明数表：每桶 4 项，按桶分段加锁；替换时保留子树工作量大的条目 ---
+const uint32_t DFPN_INF = 100000000;
+struct MateEntry {
+    uint64_t key = 0;
+    uint32_t pn = 0, dn = 0;
+    uint32_t work = 0;
+};
+struct MateTable {
+    static const int BUCKET = 4;
+    static const int LOCKS = 1024;
+    MateEntry* entries = nullptr;
+    size_t buckets = 0, mappedBytes = 0;
+    mutex locks[LOCKS];
+
+    MateTable() {}
+    MateTable(const MateTable&) = delete;
+    MateTable& operator=(const MateTable&) = delete;
+    ~MateTable() { FreeLargePages(entries, mappedBytes); }
+    bool Allocate(size_t mb) {
+        FreeLargePages(entries, mappedBytes);
+        buckets = max<size_t>(1, mb * 1024 * 1024 / (sizeof(MateEntry) * BUCKET));
+        entries = (MateEntry*)AllocateLargePages(buckets * BUCKET * sizeof(MateEntry), mappedBytes);   // 全零即空条目
+        if (!entries) { buckets = 0; return false; }
+        ParallelByNode(buckets * BUCKET * sizeof(MateEntry), [this](size_t begin, size_t end) { memset((char*)entries + begin, 0, end - begin); });
+        ReportLargeTable("Mate table", entries, mappedBytes);
+        return true;
+    }
+    bool Lookup(uint64_t key, uint32_t& pn, uint32_t& dn) {
+        size_t b = key % buckets;
+        lock_guard<mutex> guard(locks[b % LOCKS]);
+        for (int i = 0; i < BUCKET; ++i) {
+            const MateEntry& e = entries[b * BUCKET + i];
+            if (e.key == key && e.work) { pn = e.pn; dn = e.dn; return true; }
+        }
+        return false;
+    }
+    void Store(uint64_t key, uint32_t pn, uint32_t dn, uint32_t work) {
+        size_t b = key % buckets;
+        lock_guard<mutex> guard(locks[b % LOCKS]);
+        MateEntry* victim = nullptr;
+        for (int i = 0; i < BUCKET; ++i) {
+            MateEntry& e = entries[b * BUCKET + i];
+            if (e.key == key) {
+                if ((e.pn == 0 || e.dn == 0) && pn != 0 && dn != 0) return;   // 已证明/反证的结论不被其它线程的旧值覆盖
+                victim = &e; work = max(work, e.work); break;
+            }
+            if (!victim || e.work < victim->work) victim = &e;
+        }
+        victim->key = key; victim->pn = pn; victim->dn = dn; victim->work = max(1u, work);
+    }
+};
+
+// 同一局面在不同剩余步数下是不同的节点
+inline uint64_t MateKey(int movesLeft) { return ComputePositionHash() ^ ((uint64_t)(movesLeft + 1) * 0x9E3779B97F4A7C15ULL); }
+
+// --- 单线程 df-pn 搜索器 (在调用线程的全局局面上走子/还原) ---
+struct MateChild {
+    Move move;
+    uint64_t key;
+    uint32_t pn0, dn0;       // 置换表未命中时的初值
+};
+struct MateSearcher {
+    MateTable& table;
+    atomic<long long>& sharedNodes;
+    long long nodeLimit;                 // 0 = 不限
+    const atomic<bool>* stop;            // 外部停止
+    const atomic<bool>* solved;          // 其它线程已解出时置位
+    long long nodes = 0, flushed = 0;
+    bool aborted = false;
+    mt19937_64 rng;
+    bool shuffleKids = false;            // 辅助线程打乱子节点顺序，证明数相同时各自先走不同的分支
+
+    MateSearcher(MateTable& t, atomic<long long>& n, long long limit, const atomic<bool>* s, const atomic<bool>* done)
+        : table(t), sharedNodes(n), nodeLimit(limit), stop(s), solved(done) {}
+
+    bool CheckAbort() {
+        if (aborted) return true;
+        if ((nodes & 1023) == 0) {
+            long long total = sharedNodes.fetch_add(nodes - flushed) + (nodes - flushed);
+            flushed = nodes;
+            if ((nodeLimit > 0 && total >= nodeLimit) || (stop && stop->load(memory_order_relaxed))
+                || (solved && solved->load(memory_order_relaxed))) aborted = true;
+        }
+        return aborted;
+    }
+    void Flush() { sharedNodes += nodes - flushed; flushed = nodes; }
+
+    // 生成子节点；终局节点返回 false 并给出 (pn, dn)
+    bool Expand(bool orNode, int movesLeft, vector<MateChild>& kids, uint32_t& pn, uint32_t& dn) {
+        kids.clear();
+        if (orNode && movesLeft == 0) { pn = DFPN_INF; dn = 0; return false; }
+        if (!orNode && movesLeft == 0 && !IsInCheck()) { pn = DFPN_INF; dn = 0; return false; }
+        vector<Move> legal; GenerateLegalMoves(legal);
+        if (!orNode) {
+            if (legal.empty()) { if (IsInCheck()) { pn = 0; dn = DFPN_INF; } else { pn = DFPN_INF; dn = 0; } return false; }
+            if (movesLeft == 0) { pn = DFPN_INF; dn = 0; return false; }
+            for (const auto& m : legal) {
+                UndoInfo undo = MakeMove(m);
+                kids.push_back({m, MateKey(movesLeft), 1, 1});
+                UnmakeMove(m, undo);
+            }
+            return true;
+        }
+        // 攻方：只保留将军着法；应将着法数作为守方节点的证明数初值，无应将即为将死
+        for (const auto& m : legal) {
+            UndoInfo undo = MakeMove(m);
+            if (IsInCheck()) {
+                vector<Move> evasions; GenerateLegalMoves(evasions);
+                MateChild c{m, MateKey(movesLeft - 1), (uint32_t)evasions.size(), 1};
+                if (evasions.empty()) { c.pn0 = 0; c.dn0 = DFPN_INF; }
+                else if (movesLeft == 1) { c.pn0 = DFPN_INF; c.dn0 = 0; }
+                kids.push_back(c);
+            }
+            UnmakeMove(m, undo);
+        }
+        if (kids.empty()) { pn = DFPN_INF; dn = 0; return false; }
+        return true;
+    }
+
+    void ChildValue(const MateChild& c, uint32_t& pn, uint32_t& dn) {
+        if (!table.Lookup(c.key, pn, dn)) { pn = c.pn0; dn = c.dn0; }
+    }
+
+    // 以 phi/delta 形式表示：OR 节点 phi = pn、delta = dn；AND 节点相反
+    void MID(bool orNode, int movesLeft, uint64_t key, uint32_t thPhi, uint32_t thDelta) {
+        nodes++;
+        if (CheckAbort()) return;
+        vector<MateChild> kids;
+        uint32_t pn, dn;
+        if (!Expand(orNode, movesLeft, kids, pn, dn)) { table.Store(key, pn, dn, 1); return; }
+        if (shuffleKids) shuffle(kids.begin(), kids.end(), rng);
+        long long startNodes = nodes;
+        while (true) {
+            uint32_t phi = DFPN_INF, delta = 0, delta2 = DFPN_INF, bestPhi = 0;
+            int best = -1;
+            for (size_t i = 0; i < kids.size(); ++i) {
+                uint32_t cpn, cdn;
+                ChildValue(kids[i], cpn, cdn);
+                uint32_t cphi = orNode ? cdn : cpn, cdelta = orNode ? cpn : cdn;   // 子节点类型相反
+                if (best < 0 || cdelta < phi) { delta2 = phi; phi = cdelta; best = (int)i; bestPhi = cphi; }
+                else if (cdelta < delta2) delta2 = cdelta;
+                delta = (uint32_t)min<uint64_t>(DFPN_INF, (uint64_t)delta + cphi);
+            }
+            if (phi >= thPhi || delta >= thDelta || aborted) {
+                table.Store(key, orNode ? phi : delta, orNode ? delta : phi, (uint32_t)min<long long>(nodes - startNodes + 1, numeric_limits<uint32_t>::max()));
+                return;
+            }
+            // 1+ε 技巧：放宽第二好兄弟的门限以减少反复切换
+            uint64_t childThPhi = min<uint64_t>(DFPN_INF, (uint64_t)thDelta + bestPhi - delta);
+            uint64_t childThDelta = min<uint64_t>(thPhi, max<uint64_t>((uint64_t)delta2 + 1, (uint64_t)delta2 + delta2 / 4));
+            const MateChild& c = kids[best];
+            UndoInfo undo = MakeMove(c.move);
+            MID(!orNode, orNode ? movesLeft - 1 : movesLeft, c.key, (uint32_t)childThPhi, (uint32_t)min<uint64_t>(childThDelta, DFPN_INF));
+            UnmakeMove(c.move, undo);
+        }
+    }
+
+    // 对当前局面求解到底 (或中止)：返回 MATE_FOUND / MATE_NONE / MATE_UNKNOWN
+    int Solve(bool orNode, int movesLeft) {
+        uint64_t key = MateKey(movesLeft);
+        MID(orNode, movesLeft, key, DFPN_INF, DFPN_INF);
+        uint32_t pn = 1, dn = 1;
+        table.Lookup(key, pn, dn);
+        if (pn == 0) return MATE_FOUND;
+        if (dn == 0) return MATE_NONE;
+        return MATE_UNKNOWN;
+    }
+};
+
+// --- 根节点：所有线程都从根局面开始 df-pn，经共享的证明数表交换子树结果；
+// 辅助线程的子节点顺序各自随机，证明数相同时走向不同的分支，任一线程证明或反证根节点即全部停止 ---
+int SolveMateLevel(const Position& pos, int moves, int threads, MateTable& table, atomic<long long>& nodes,
+                   long long nodeLimit, const atomic<bool>* stop, Move& winning) {
+    atomic<bool> finished(false);
+    auto worker = [&](int index) {
+        pos.Load();
+        bool track = trackPositionHistory;
+        trackPositionHistory = false;   // 剩余步数递减，搜索中不会重复局面
+        MateSearcher searcher(table, nodes, nodeLimit, stop, &finished);
+        searcher.rng.seed(index);
+        searcher.shuffleKids = index > 0;
+        if (searcher.Solve(true, moves) != MATE_UNKNOWN) finished = true;
+        searcher.Flush();
+        trackPositionHistory = track;
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back([&worker, t] { BindSearchThread(t); worker(t); });
+    worker(0);
+    for (auto& t : pool) t.join();
+
+    pos.Load();
+    uint32_t pn = 1, dn = 1;
+    table.Lookup(MateKey(moves), pn, dn);
+    if (dn == 0) return MATE_NONE;
+    if (pn != 0) return MATE_UNKNOWN;
+    // 根节点已证明：取一个已证明的将军着法 (表中条目被替换时重新求解该子节点)
+    bool track = trackPositionHistory;
+    trackPositionHistory = false;
+    MateSearcher searcher(table, nodes, 0, stop, nullptr);
+    vector<MateChild> roots;
+    searcher.Expand(true, moves, roots, pn, dn);
+    int status = MATE_UNKNOWN;
+    for (const auto& c : roots) {
+        searcher.ChildValue(c, pn, dn);
+        if (dn == 0) continue;
+        UndoInfo undo = MakeMove(c.move);
+        status = searcher.Solve(false, moves - 1);
+        UnmakeMove(c.move, undo);
+        if (status == MATE_FOUND) { winning = c.move; break; }
+    }
+    searcher.Flush();
+    trackPositionHistory = track;
+    return status == MATE_FOUND ? MATE_FOUND : MATE_UNKNOWN;
+}
+
+// 从已证明的局面取出双方最佳的将杀线：攻方选剩余步数内可证明的将军，守方选最晚被将死的应着
+void ExtractMateLine(const Position& pos, int moves, const Move& first, MateTable& table, atomic<long long>& nodes,
+                     const atomic<bool>* stop, vector<Move>& line) {
+    pos.Load();
+    bool track = trackPositionHistory;
+    trackPositionHistory = false;
+    MateSearcher searcher(table, nodes, 0, stop, nullptr);
+    vector<pair<Move, UndoInfo>> played;
+    Move attack = first;
+    for (int m = moves; m >= 1 && !searcher.aborted; --m) {
+        if (m < moves) {
+            attack = Move();
+            vector<MateChild> kids; uint32_t pn, dn;
+            searcher.Expand(true, m, kids, pn, dn);
+            for (const auto& c : kids) {
+                UndoInfo undo = MakeMove(c.move);
+                int status = searcher.Solve(false, m - 1);
+                UnmakeMove(c.move, undo);
+                if (status == MATE_FOUND) { attack = c.move; break; }
+            }
+            if (!attack.from.ok()) break;
+        }
+        line.push_back(attack);
+        played.push_back({attack, MakeMove(attack)});
+        vector<Move> replies; GenerateLegalMoves(replies);
+        if (replies.empty() || m == 1) break;
+        Move defence = replies[0];
+        for (const auto& r : replies) {
+            UndoInfo undo = MakeMove(r);
+            int status = searcher.Solve(true, m - 2);
+            UnmakeMove(r, undo);
+            if (status != MATE_FOUND) { defence = r; break; }
+        }
+        line.push_back(defence);
+        played.push_back({defence, MakeMove(defence)});
+    }
+    searcher.Flush();
+    for (size_t i = played.size(); i-- > 0;) UnmakeMove(played[i].first, played[i].second);
+    trackPositionHistory = track;
+}
+
+MateResult SolveMate(const Position& pos, int maxMoves, int threads, long long nodeLimit, size_t hashMB,
+                     const atomic<bool>* stop, const function<void(int, long long, int)>& onLevel) {
+    auto start = chrono::steady_clock::now();
+    MateResult result;
+    MateTable table;
+    if (!table.Allocate(hashMB ? hashMB : 64)) return result;   // MATE_UNKNOWN
+    atomic<long long> nodes(0);
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    // 逐步加深：第一个被证明的步数就是最短将杀；全部被反证即证明 maxMoves 步内无杀
+    for (int k = 1; k <= maxMoves; ++k) {
+        Move winning;
+        int status = SolveMateLevel(pos, k, threads, table, nodes, nodeLimit, stop, winning);
+        int ms = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        if (onLevel) onLevel(k, nodes.load(), ms);
+        if (status == MATE_FOUND) {
+            result.status = MATE_FOUND;
+            result.moves = k;
+            ExtractMateLine(pos, k, winning, table, nodes, stop, result.line);
+            break;
+        }
+        if (status == MATE_UNKNOWN) { result.status = MATE_UNKNOWN; break; }
+        result.status = MATE_NONE;
+    }
+    pos.Load();
+    result.nodes = nodes.load();
+    result.timeMs = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// --- mate 命令 ---
+void PrintMateUsage() {
+    cout << "Usage: mate [-fen FEN] [-moves N] [-threads T] [-nodes N] [-hash MB]\n"
+            "Proves the shortest forced mate for the side to move within N moves (default 5), or proves that none exists.\n"
+            "Only checking moves are tried for the attacker, so mates that need a quiet move are not found.\n"
+            "Uses proof-number search on all threads (default: all hardware threads)." << endl;
+}
+
+int RunMate(int argc, char* argv[]) {
+    string fen = START_FEN;
+    int moves = 5, threads = 0;
+    long long nodeLimit = 0;
+    size_t hashMB = 64;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-fen" && i + 1 < argc) fen = argv[++i];
+            else if (a == "-moves" && i + 1 < argc) moves = max(1, stoi(argv[++i]));
+            else if (a == "-threads" && i + 1 < argc) threads = max(1, stoi(argv[++i]));
+            else if (a == "-nodes" && i + 1 < argc) nodeLimit = max(1LL, stoll(argv[++i]));
+            else if (a == "-hash" && i + 1 < argc) hashMB = max(1, stoi(argv[++i]));
+            else { PrintMateUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintMateUsage(); return 2; }
+    Position pos;
+    if (!pos.SetFEN(fen)) { cout << "Error: Invalid FEN '" << fen << "'" << endl; return 2; }
+    MateResult r = SolveMate(pos, moves, threads, nodeLimit, hashMB, nullptr, [](int k, long long nodes, int ms) {
+        cout << "info depth " << k << " nodes " << nodes << " time " << ms << "ms" << endl;
+    });
+    cout << "----------------------------------" << endl;
+    if (r.status == MATE_FOUND) {
+        RootLine line;
+        line.move = r.line[0]; line.score = 0; line.pv = r.line;
+        cout << "Mate in " << r.moves << ": " << FormatLineSAN(line) << endl;
+    } else if (r.status == MATE_NONE) {
+        cout << "No mate in " << moves << " moves by a sequence of checks." << endl;
+    } else {
+        cout << "Unknown: node limit reached before the search finished." << endl;
+    }
+    cout << "Nodes: " << r.nodes << ", time: " << r.timeMs << "ms" << endl;
+    return 0;
+}
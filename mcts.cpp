@@ -0,0 +1,436 @@
+// mcts.cpp
+//Starfish --- chess engine developed by dsyoier
+//蒙特卡洛树搜索 (mcts)：PUCT 选择加虚拟损失，多个线程共享一棵树。节点统计量都是原子量，展开由节点上的状态字仲裁，
+//子节点从节点池中按块取用 (原子游标)；换根时把保留的子树复制到另一个半区。mcts 命令另含与 alpha-beta 的多线程扩展性对比。
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <iomanip>
+#include <new>
+
+using namespace std;
+
+const double VALUE_SCALE = 400.0;         // 分数 (百分之一兵) → [-1, 1]：tanh(cp / 400)
+const double PRIOR_TEMPERATURE = 100.0;   // 先验：走子后静态评估的 softmax 温度
+const double FPU_REDUCTION = 0.25;        // 未访问子节点的初始值：父节点的值减去此数
+const double VALUE_UNIT = 1 << 20;        // 价值和的定点精度
+
+// --- 节点与节点池 ---
+enum { NODE_FRESH = 0, NODE_EXPANDING = 1, NODE_EXPANDED = 2, NODE_TERMINAL = 3 };
+struct MctsNode {
+    atomic<int32_t> visits{0};
+    atomic<int32_t> virtualLoss{0};
+    atomic<int64_t> valueSum{0};     // 以走到本节点的一方为视角，定点
+    atomic<uint8_t> state{NODE_FRESH};
+    uint16_t move = 0;               // 起点 6 位 | 终点 6 位 | 升变兵种 3 位
+    float prior = 0;
+    float terminalValue = 0;         // 以本节点走子方为视角
+    uint32_t firstChild = 0;         // 子节点在池中连续存放；0 = 没有
+    uint16_t childCount = 0;
+};
+
+struct MctsPool {
+    MctsNode* nodes = nullptr;
+    size_t capacity = 0, mappedBytes = 0;
+    atomic<size_t> used{1};          // 0 号不用
+    atomic<bool> full{false};
+
+    bool Allocate(size_t bytes) {
+        nodes = (MctsNode*)AllocateLargePages(bytes, mappedBytes);
+        capacity = nodes ? bytes / sizeof(MctsNode) : 0;
+        return nodes != nullptr;
+    }
+    ~MctsPool() { FreeLargePages(nodes, mappedBytes); }
+    void Reset() { used = 1; full = false; }
+    // 取 n 个连续节点，返回第一个的下标；池满时返回 0
+    uint32_t Take(size_t n) {
+        size_t first = used.fetch_add(n, memory_order_relaxed);
+        if (first + n > capacity) { full = true; return 0; }
+        for (size_t i = first; i < first + n; ++i) new (&nodes[i]) MctsNode();
+        return (uint32_t)first;
+    }
+};
+
+uint16_t PackMove(const Move& m) {
+    return (uint16_t)(((m.from.y - 1) * 8 + (m.from.x - 1)) | (((m.to.y - 1) * 8 + (m.to.x - 1)) << 6) | ((m.promotion & PIECE_TYPE_MASK) << 12));
+}
+Move UnpackMove(uint16_t v, int side) {
+    Move m;
+    int from = v & 63, to = (v >> 6) & 63, promo = (v >> 12) & 7;
+    m.from = Pos(from % 8 + 1, from / 8 + 1);
+    m.to = Pos(to % 8 + 1, to / 8 + 1);
+    if (promo) m.promotion = promo | (side * COLOR_MASK);
+    return m;
+}
+double ValueToScore(double q) { return VALUE_SCALE * atanh(max(-0.999999, min(0.999999, q))); }
+
+// --- 搜索 ---
+struct MctsSearch::Impl {
+    MctsPool pools[2];
+    int active = 0;
+    uint32_t root = 0;
+    bool hasTree = false;
+    Position rootPosition;
+    TranspositionTable table;        // alpha-beta 叶子共用
+    MctsLimits limits;
+    const atomic<bool>* stop = nullptr;
+    atomic<bool> done{false};
+    atomic<long long> playouts{0}, nodes{0};
+    chrono::steady_clock::time_point start;
+
+    MctsNode& Node(uint32_t i) { return pools[active].nodes[i]; }
+    long long Reroot(const Position& position);
+    uint32_t SelectChild(MctsNode& node);
+    bool Expand(MctsNode& node, bool isRoot, double& value);
+    double LeafValue();
+    void Playout(vector<uint32_t>& path, vector<pair<Move, UndoInfo>>& made);
+    void Worker(int index);
+};
+
+void CopyNode(const MctsNode& src, MctsNode& dst) {
+    dst.visits.store(src.visits.load(memory_order_relaxed), memory_order_relaxed);
+    dst.valueSum.store(src.valueSum.load(memory_order_relaxed), memory_order_relaxed);
+    uint8_t state = src.state.load(memory_order_relaxed);
+    dst.state.store(state == NODE_EXPANDING ? (uint8_t)NODE_FRESH : state, memory_order_relaxed);
+    dst.move = src.move;
+    dst.prior = src.prior;
+    dst.terminalValue = src.terminalValue;
+}
+
+// 新局面等于上一次的根或在其两步之内时，按广度优先把该子树复制到另一个半区 (装不下的节点退回未展开)；返回继承的访问次数
+long long MctsSearch::Impl::Reroot(const Position& position) {
+    uint32_t found = 0;
+    if (hasTree) {
+        string fen = position.FEN();
+        if (rootPosition.FEN() == fen) found = root;
+        MctsNode& r = Node(root);
+        for (uint32_t c = r.firstChild; !found && r.state.load() == NODE_EXPANDED && c < r.firstChild + r.childCount; ++c) {
+            Position p1 = rootPosition;
+            p1.Play(UnpackMove(Node(c).move, p1.SideToMove()));
+            if (p1.FEN() == fen) { found = c; break; }
+            MctsNode& n1 = Node(c);
+            if (n1.state.load() != NODE_EXPANDED) continue;
+            for (uint32_t g = n1.firstChild; g < n1.firstChild + n1.childCount; ++g) {
+                Position p2 = p1;
+                p2.Play(UnpackMove(Node(g).move, p2.SideToMove()));
+                if (p2.FEN() == fen) { found = g; break; }
+            }
+        }
+    }
+    MctsPool& to = pools[1 - active];
+    to.Reset();
+    uint32_t newRoot = to.Take(1);
+    rootPosition = position;
+    hasTree = true;
+    if (!found) {
+        active = 1 - active;
+        root = newRoot;
+        return 0;
+    }
+    MctsPool& from = pools[active];
+    CopyNode(from.nodes[found], to.nodes[newRoot]);
+    deque<pair<uint32_t, uint32_t>> queue(1, make_pair(found, newRoot));
+    while (!queue.empty()) {
+        const MctsNode& src = from.nodes[queue.front().first];
+        MctsNode& dst = to.nodes[queue.front().second];
+        queue.pop_front();
+        if (dst.state.load(memory_order_relaxed) != NODE_EXPANDED) continue;
+        uint32_t first = to.Take(src.childCount);
+        if (!first) { dst.state.store(NODE_FRESH); continue; }
+        dst.firstChild = first;
+        dst.childCount = src.childCount;
+        for (int k = 0; k < src.childCount; ++k) {
+            CopyNode(from.nodes[src.firstChild + k], to.nodes[first + k]);
+            queue.push_back(make_pair(src.firstChild + k, first + k));
+        }
+    }
+    active = 1 - active;
+    root = newRoot;
+    // 树中以重复局面判和的终局节点成为根后要重新展开
+    if (Node(root).state.load() == NODE_TERMINAL) Node(root).state.store(NODE_FRESH);
+    return Node(root).visits.load();
+}
+
+// PUCT：Q + cpuct * P * sqrt(N) / (1 + n)；虚拟损失按每个正在途经的线程记一次负局
+uint32_t MctsSearch::Impl::SelectChild(MctsNode& node) {
+    int32_t parentVisits = node.visits.load(memory_order_relaxed) + node.virtualLoss.load(memory_order_relaxed);
+    double sqrtN = sqrt((double)max(1, parentVisits));
+    int32_t n0 = node.visits.load(memory_order_relaxed);
+    double fpu = (n0 > 0 ? -node.valueSum.load(memory_order_relaxed) / VALUE_UNIT / n0 : 0) - FPU_REDUCTION;
+    uint32_t best = node.firstChild;
+    double bestScore = -numeric_limits<double>::infinity();
+    for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; ++c) {
+        MctsNode& child = Node(c);
+        int32_t n = child.visits.load(memory_order_relaxed), vl = child.virtualLoss.load(memory_order_relaxed);
+        double q = (n + vl > 0) ? (child.valueSum.load(memory_order_relaxed) / VALUE_UNIT - vl) / (n + vl) : fpu;
+        double score = q + limits.cpuct * child.prior * sqrtN / (1 + n + vl);
+        if (score > bestScore) { bestScore = score; best = c; }
+    }
+    return best;
+}
+
+// 由取得 NODE_EXPANDING 的线程调用，局面为本节点；终局时 value 为本节点走子方视角的值并返回 true
+bool MctsSearch::Impl::Expand(MctsNode& node, bool isRoot, double& value) {
+    vector<Move> legal; GenerateLegalMoves(legal);
+    bool terminal = legal.empty() || (!isRoot && (halfmoveClock >= 100 || positionHistory[GeneratePositionKey()] >= 2 || IsInsufficientMaterial()));
+    if (terminal) {
+        value = (legal.empty() && IsInCheck()) ? -1 : 0;
+        node.terminalValue = (float)value;
+        node.state.store(NODE_TERMINAL, memory_order_release);
+        return true;
+    }
+    MctsPool& pool = pools[active];
+    uint32_t first = pool.Take(legal.size());
+    if (!first) { node.state.store(NODE_FRESH, memory_order_release); return false; }
+    vector<double> logits(legal.size());
+    bool track = trackPositionHistory;
+    trackPositionHistory = false;
+    for (size_t i = 0; i < legal.size(); ++i) {
+        int side = currentPlayer;
+        UndoInfo undo = MakeMove(legal[i]);
+        double e = CachedEvaluate(ComputePositionHash());
+        UnmakeMove(legal[i], undo);
+        logits[i] = (side == WHITE ? e : -e) / PRIOR_TEMPERATURE;
+    }
+    trackPositionHistory = track;
+    double top = *max_element(logits.begin(), logits.end()), sum = 0;
+    for (double& l : logits) { l = exp(l - top); sum += l; }
+    for (size_t i = 0; i < legal.size(); ++i) {
+        MctsNode& child = pool.nodes[first + i];
+        child.move = PackMove(legal[i]);
+        child.prior = (float)(logits[i] / sum);
+    }
+    node.firstChild = first;
+    node.childCount = (uint16_t)legal.size();
+    node.state.store(NODE_EXPANDED, memory_order_release);
+    return false;
+}
+
+// 叶子局面的值，相对走子方
+double MctsSearch::Impl::LeafValue() {
+    computedNodes = 0;
+    double cp;
+    if (limits.leafDepth < 0) {
+        double e = CachedEvaluate(ComputePositionHash());
+        cp = (currentPlayer == WHITE ? e : -e);
+    } else if (limits.leafDepth == 0) {
+        cp = QuiescenceSearch(-numeric_limits<double>::infinity(), numeric_limits<double>::infinity());
+    } else {
+        cp = SearchFixedDepth(limits.leafDepth);
+    }
+    nodes.fetch_add(computedNodes + 1, memory_order_relaxed);
+    return tanh(cp / VALUE_SCALE);
+}
+
+void MctsSearch::Impl::Playout(vector<uint32_t>& path, vector<pair<Move, UndoInfo>>& made) {
+    path.clear();
+    made.clear();
+    uint32_t idx = root;
+    path.push_back(idx);
+    double value;   // 叶子走子方视角
+    for (;;) {
+        MctsNode& node = Node(idx);
+        uint8_t st = node.state.load(memory_order_acquire);
+        if (st == NODE_TERMINAL) { value = node.terminalValue; break; }
+        if (st == NODE_EXPANDED) {
+            uint32_t c = SelectChild(node);
+            Node(c).virtualLoss.fetch_add(1, memory_order_relaxed);
+            Move m = UnpackMove(Node(c).move, currentPlayer);
+            made.push_back(make_pair(m, MakeMove(m)));
+            path.push_back(c);
+            idx = c;
+            continue;
+        }
+        // 未展开：抢到展开权的线程展开；正在被其它线程展开或池已满时直接估值
+        uint8_t fresh = NODE_FRESH;
+        if (st == NODE_FRESH && !pools[active].full.load(memory_order_relaxed)
+            && node.state.compare_exchange_strong(fresh, NODE_EXPANDING, memory_order_acq_rel)
+            && Expand(node, idx == root, value)) break;
+        value = LeafValue();
+        break;
+    }
+    for (size_t i = path.size(); i-- > 0;) {
+        MctsNode& node = Node(path[i]);
+        node.valueSum.fetch_add((int64_t)llround(-value * VALUE_UNIT), memory_order_relaxed);
+        node.visits.fetch_add(1, memory_order_relaxed);
+        if (i > 0) node.virtualLoss.fetch_sub(1, memory_order_relaxed);
+        value = -value;
+    }
+    for (size_t i = made.size(); i-- > 0;) UnmakeMove(made[i].first, made[i].second);
+}
+
+void MctsSearch::Impl::Worker(int index) {
+    BindSearchThread(index);
+    rootPosition.Load();
+    searchQuiet = true;
+    searchStopFlag = nullptr;
+    time_is_up = false;
+    search_min_depth = iterative_deepening_current_depth = 0;   // 叶子的静止搜索不检查时间
+    if (limits.leafDepth > 0) SetThreadTT(&table);
+    long long limit = (limits.playouts > 0 || limits.timeMs > 0) ? limits.playouts : 10000;
+    vector<uint32_t> path;
+    vector<pair<Move, UndoInfo>> made;
+    while (!done.load(memory_order_relaxed)) {
+        Playout(path, made);
+        long long total = playouts.fetch_add(1, memory_order_relaxed) + 1;
+        if ((limit > 0 && total >= limit) || (stop && stop->load(memory_order_relaxed))
+            || (limits.timeMs > 0 && chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() >= limits.timeMs)) done = true;
+    }
+    if (limits.leafDepth > 0) SetThreadTT(nullptr);
+}
+
+MctsSearch::MctsSearch(size_t memMB) : impl(new Impl()) {
+    size_t half = max<size_t>(1, memMB) * 1024 * 1024 / 2;
+    if (!impl->pools[0].Allocate(half) || !impl->pools[1].Allocate(half))
+        cout << "Error: Could not allocate " << memMB << " MB for the search tree." << endl;
+}
+MctsSearch::~MctsSearch() { delete impl; }
+void MctsSearch::Clear() { impl->hasTree = false; }
+
+MctsResult MctsSearch::Search(const Position& position, const MctsLimits& limits, const atomic<bool>* stop) {
+    Impl& s = *impl;
+    MctsResult result;
+    if (position.LegalMoves().empty() || !s.pools[0].nodes || !s.pools[1].nodes) return result;
+    s.start = chrono::steady_clock::now();
+    s.limits = limits;
+    s.limits.threads = max(1, limits.threads);
+    s.stop = stop;
+    s.done = false;
+    s.playouts = 0;
+    s.nodes = 0;
+    if (limits.leafDepth > 0 && !s.table.count) s.table.Allocate(ttDefaultSizeMB);
+    result.reusedVisits = s.Reroot(position);
+    vector<thread> pool;
+    for (int i = 0; i < s.limits.threads; ++i) pool.emplace_back(&Impl::Worker, &s, i);
+    for (auto& t : pool) t.join();
+    result.timeMs = (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - s.start).count();
+    result.playouts = s.playouts;
+    result.nodes = s.nodes;
+    result.treeNodes = min(s.pools[s.active].used.load(), s.pools[s.active].capacity) - 1;
+    // 主变例：逐层取访问次数最多的子节点
+    int side = position.SideToMove();
+    for (uint32_t idx = s.root; s.Node(idx).state.load() == NODE_EXPANDED && result.pv.size() < 64; side = 1 - side) {
+        MctsNode& node = s.Node(idx);
+        uint32_t best = node.firstChild;
+        for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; ++c)
+            if (s.Node(c).visits.load() > s.Node(best).visits.load()) best = c;
+        if (s.Node(best).visits.load() == 0) break;
+        if (idx == s.root) result.score = ValueToScore(s.Node(best).valueSum.load() / VALUE_UNIT / s.Node(best).visits.load());
+        result.pv.push_back(UnpackMove(s.Node(best).move, side));
+        idx = best;
+    }
+    if (!result.pv.empty()) result.best = result.pv[0];
+    return result;
+}
+
+// --- mcts 命令 ---
+const char* MCTS_SCALE_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R w KQ - 0 9",
+    "8/5pk1/6p1/3P4/5P2/6P1/r4K2/3R4 b - - 0 45",
+};
+
+void PrintMctsUsage() {
+    cout << "Usage: mcts [-fen FEN] [-threads N] [-time MS] [-playouts N] [-mem MB] [-leaf eval|qs|D] [-cpuct C] [-moves N]\n"
+            "       mcts -scale [-maxthreads N] [-time MS] [-depth D] [-mem MB] [-leaf eval|qs|D]\n"
+            "Monte-Carlo tree search: children are picked by PUCT with virtual loss; priors come from the static\n"
+            "evaluation after each move, leaves are scored by the static evaluation (eval), a quiescence search (qs,\n"
+            "default) or a fixed-depth alpha-beta search (D). The tree lives in a node pool of -mem MB (default 256).\n"
+            "-moves N plays N further moves, reusing the subtree of the move played.\n"
+            "-scale runs " << sizeof(MCTS_SCALE_POSITIONS) / sizeof(MCTS_SCALE_POSITIONS[0]) << " positions with 1, 2, 4 ... N threads (default: all hardware threads, at most 64):\n"
+            "MCTS for -time MS each (default 2000), and alpha-beta to -depth D (default 6) with all threads sharing one\n"
+            "hash table; the first thread to finish stops the others." << endl;
+}
+
+void PrintMctsResult(const MctsResult& r) {
+    cout << "info playouts " << r.playouts << " nodes " << r.nodes << " tree " << r.treeNodes << " time " << r.timeMs << "ms";
+    if (r.reusedVisits) cout << " reused " << r.reusedVisits;
+    cout << " score cp " << static_cast<int>(r.score) << " pv";
+    for (const auto& m : r.pv) cout << " " << MoveToUCI(m);
+    cout << endl;
+}
+
+int RunMctsScaling(int maxThreads, const MctsLimits& base, int depth, size_t memMB) {
+    vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+    TranspositionTable table;
+    if (!table.Allocate(ttDefaultSizeMB)) return 2;
+    cout << "Threads | MCTS playouts/s  speedup | alpha-beta nodes/s  time to depth " << depth << "  speedup" << endl;
+    double mcts1 = 0, ab1 = 0;
+    for (int threads : counts) {
+        long long playouts = 0, abNodes = 0;
+        double mctsMs = 0, abMs = 0;
+        for (const char* fen : MCTS_SCALE_POSITIONS) {
+            Position position;
+            position.SetFEN(fen);
+            MctsSearch mcts(memMB);
+            MctsLimits limits = base;
+            limits.threads = threads;
+            MctsResult r = mcts.Search(position, limits);
+            playouts += r.playouts;
+            mctsMs += max(1, r.timeMs);
+            table.Clear();
+            ThreadedSearchResult ab = SearchWithThreads(position, threads, depth, table);
+            abMs += max(1.0, ab.ms);
+            abNodes += ab.nodes;
+        }
+        double pps = playouts / (mctsMs / 1000), nps = abNodes / (abMs / 1000);
+        if (threads == 1) { mcts1 = pps; ab1 = abMs; }
+        cout << setw(7) << threads << " | " << setw(15) << (long long)pps << "  " << fixed << setprecision(2) << setw(6) << pps / mcts1 << "x | "
+             << setw(18) << (long long)nps << "  " << setw(12) << (long long)abMs << " ms  " << setw(6) << ab1 / abMs << "x"
+             << defaultfloat << setprecision(6) << endl;
+    }
+    return 0;
+}
+
+int RunMcts(int argc, char* argv[]) {
+    string fen = START_FEN;
+    MctsLimits limits;
+    size_t memMB = 256;
+    int moves = 0, depth = 6, maxThreads = min(64, (int)max(1u, thread::hardware_concurrency()));
+    bool scale = false;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-fen" && i + 1 < argc) fen = argv[++i];
+            else if (a == "-threads" && i + 1 < argc) limits.threads = max(1, stoi(argv[++i]));
+            else if (a == "-time" && i + 1 < argc) limits.timeMs = max(1, stoi(argv[++i]));
+            else if (a == "-playouts" && i + 1 < argc) limits.playouts = max(1LL, stoll(argv[++i]));
+            else if (a == "-mem" && i + 1 < argc) memMB = max(1, stoi(argv[++i]));
+            else if (a == "-cpuct" && i + 1 < argc) limits.cpuct = stod(argv[++i]);
+            else if (a == "-moves" && i + 1 < argc) moves = max(0, stoi(argv[++i]));
+            else if (a == "-depth" && i + 1 < argc) depth = max(1, stoi(argv[++i]));
+            else if (a == "-maxthreads" && i + 1 < argc) maxThreads = max(1, stoi(argv[++i]));
+            else if (a == "-scale") scale = true;
+            else if (a == "-leaf" && i + 1 < argc) {
+                string v = argv[++i];
+                limits.leafDepth = (v == "eval") ? -1 : (v == "qs") ? 0 : max(1, stoi(v));
+            }
+            else { PrintMctsUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintMctsUsage(); return 2; }
+    if (scale) {
+        if (limits.timeMs == 0 && limits.playouts == 0) limits.timeMs = 2000;
+        return RunMctsScaling(maxThreads, limits, depth, memMB);
+    }
+    Position position;
+    if (!position.SetFEN(fen)) { cout << "Error: Invalid FEN '" << fen << "'" << endl; return 2; }
+    MctsSearch mcts(memMB);
+    for (int k = 0; k <= moves; ++k) {
+        MctsResult r = mcts.Search(position, limits);
+        if (!r.best.from.ok()) { cout << "No legal moves in this position." << endl; break; }
+        PrintMctsResult(r);
+        cout << "Best move: " << MoveToUCI(r.best) << endl;
+        position.Play(r.best);
+    }
+    return 0;
+}
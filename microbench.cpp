@@ -0,0 +1,283 @@
+// microbench.cpp
+//Starfish --- chess engine developed by dsyoier
+//微基准：在固定局面集上测量核心函数的 ns/op 与 allocs/op，结果可输出为 JSON/CSV 供不同提交之间对比
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <iomanip>
+#include <functional>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// --- 堆分配计数 (库以 STARFISH_PROFILE 编译时已替换 operator new，此时不统计) ---
+#ifndef STARFISH_PROFILE
+static uint64_t benchAllocations = 0;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    benchAllocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+#define BENCH_HAS_ALLOC_COUNT 1
+#else
+static uint64_t benchAllocations = 0;
+#define BENCH_HAS_ALLOC_COUNT 0
+#endif
+
+// --- 固定局面集：开局、中局、残局，覆盖易位、吃过路兵与升变 ---
+const char* BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "2rq1rk1/pp1bppbp/2np1np1/8/3NP3/1BN1BP2/PPPQ2PP/2KR3R b - - 0 11",
+    "r1bq1rk1/ppp2ppp/2np1n2/2b1p3/2B1P3/2NP1N2/PPP2PPP/R1BQ1RK1 w - - 0 7",
+    "4r1k1/pp3ppp/2p5/8/2P1n3/1P4P1/P3PPBP/3R2K1 w - - 0 22",
+    "8/5pk1/6p1/8/3Q4/6P1/5PK1/3q4 b - - 0 40",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 30",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 50",
+    "8/P5k1/8/8/8/8/6p1/K7 w - - 0 60",
+    "r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 10",
+};
+const int BENCH_FEN_COUNT = sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]);
+const int BENCH_INNER_REPEATS = 16;   // 每恢复一次局面，重复测量的次数
+
+struct BenchPosition {
+    string fen;
+    int board[10][10];
+    int player, castling, halfmove, round;
+    Pos ep;
+    vector<Move> moves;       // 伪合法着法 (MakeMove/UnmakeMove 用)
+    vector<Move> legal;
+    vector<string> sans;      // 合法着法的 SAN (ParseAlgebraicMove 用)
+    void Capture() {
+        memcpy(board, ::board, sizeof(board));
+        player = currentPlayer; castling = castlingRights; halfmove = halfmoveClock; round = Round; ep = enPassantTarget;
+    }
+    void Restore() const {
+        memcpy(::board, board, sizeof(board));
+        currentPlayer = player; castlingRights = castling; halfmoveClock = halfmove; Round = round; enPassantTarget = ep;
+    }
+};
+vector<BenchPosition> benchCorpus;
+
+void BuildBenchCorpus() {
+    for (int i = 0; i < BENCH_FEN_COUNT; ++i) {
+        BenchPosition b;
+        b.fen = BENCH_FENS[i];
+        LoadFEN(b.fen);
+        b.Capture();
+        GenerateMoves(b.moves, false);
+        GenerateLegalMoves(b.legal);
+        for (const auto& m : b.legal) b.sans.push_back(MoveToSAN(m, b.legal));
+        benchCorpus.push_back(b);
+    }
+}
+
+// 一个基准项：pass 跑一遍局面集并返回完成的操作数
+struct BenchCase {
+    const char* name;
+    function<long long()> pass;
+};
+struct BenchResult {
+    string name;
+    double nsPerOp;
+    double allocsPerOp;
+    long long ops;
+};
+
+volatile uint64_t benchSink;   // 防止结果被优化掉
+
+vector<BenchCase> BenchCases() {
+    auto perPosition = [](function<long long(const BenchPosition&)> body) {
+        return [body]() {
+            long long ops = 0;
+            for (const auto& b : benchCorpus) {
+                b.Restore();
+                for (int r = 0; r < BENCH_INNER_REPEATS; ++r) ops += body(b);
+            }
+            return ops;
+        };
+    };
+    return {
+        {"GenerateMoves/all", perPosition([](const BenchPosition&) {
+            vector<Move> moves; GenerateMoves(moves, false);
+            benchSink += moves.size();
+            return 1LL;
+        })},
+        {"GenerateMoves/captures", perPosition([](const BenchPosition&) {
+            vector<Move> moves; GenerateMoves(moves, true);
+            benchSink += moves.size();
+            return 1LL;
+        })},
+        {"MakeUnmake", perPosition([](const BenchPosition& b) {
+            for (const auto& m : b.moves) { UndoInfo u = MakeMove(m); UnmakeMove(m, u); }
+            return (long long)b.moves.size();
+        })},
+        {"MakeUnmake/nohistory", perPosition([](const BenchPosition& b) {
+            trackPositionHistory = false;
+            for (const auto& m : b.moves) { UndoInfo u = MakeMove(m); UnmakeMove(m, u); }
+            trackPositionHistory = true;
+            return (long long)b.moves.size();
+        })},
+        {"IsSquareAttacked", perPosition([](const BenchPosition&) {
+            uint64_t hits = 0;
+            for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) hits += IsSquareAttacked(Pos(x, y), WHITE) + IsSquareAttacked(Pos(x, y), BLACK);
+            benchSink += hits;
+            return 128LL;
+        })},
+        {"GeneratePositionKey", perPosition([](const BenchPosition&) {
+            benchSink += GeneratePositionKey().size();
+            return 1LL;
+        })},
+        {"GenerateFEN", perPosition([](const BenchPosition&) {
+            benchSink += GenerateFEN().size();
+            return 1LL;
+        })},
+        {"ComputePositionHash", perPosition([](const BenchPosition&) {
+            benchSink += ComputePositionHash();
+            return 1LL;
+        })},
+        {"LoadFEN", []() {
+            for (const auto& b : benchCorpus) LoadFEN(b.fen);
+            return (long long)benchCorpus.size();
+        }},
+        {"Evaluate", perPosition([](const BenchPosition&) {
+            benchSink += (uint64_t)(long long)Evaluate();
+            return 1LL;
+        })},
+        {"ParseAlgebraicMove", perPosition([](const BenchPosition& b) {
+            for (const auto& s : b.sans) benchSink += ParseAlgebraicMove(s, b.legal).to.x;
+            return (long long)b.sans.size();
+        })},
+    };
+}
+
+// 每轮至少跑 minMs 毫秒，取 repeat 轮中最快的一轮
+BenchResult RunBenchCase(const BenchCase& c, int minMs, int repeat) {
+    BenchResult r = {c.name, 0, 0, 0};
+    c.pass();   // 预热
+    double best = -1;
+    for (int k = 0; k < repeat; ++k) {
+        long long ops = 0;
+        uint64_t allocs = benchAllocations;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            ops += c.pass();
+            elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < minMs * 1e6);
+        double ns = elapsed / max(1LL, ops);
+        if (best < 0 || ns < best) { best = ns; r.allocsPerOp = (double)(benchAllocations - allocs) / max(1LL, ops); }
+        r.ops += ops;
+    }
+    r.nsPerOp = best;
+    if (!BENCH_HAS_ALLOC_COUNT) r.allocsPerOp = -1;
+    return r;
+}
+
+void WriteBenchJson(ostream& out, const vector<BenchResult>& results, const string& label) {
+    out << "{\"label\":\"" << label << "\",\"positions\":" << benchCorpus.size() << ",\"benchmarks\":[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << fixed << setprecision(3) << "  {\"name\":\"" << r.name << "\",\"ns_per_op\":" << r.nsPerOp << ",\"allocs_per_op\":";
+        if (r.allocsPerOp < 0) out << "null"; else out << r.allocsPerOp;
+        out << ",\"ops\":" << r.ops << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}" << endl;
+}
+void WriteBenchCsv(ostream& out, const vector<BenchResult>& results) {
+    out << "name,ns_per_op,allocs_per_op,ops\n";
+    for (const auto& r : results) {
+        out << fixed << setprecision(3) << r.name << "," << r.nsPerOp << ",";
+        if (r.allocsPerOp >= 0) out << r.allocsPerOp;
+        out << "," << r.ops << "\n";
+    }
+}
+
+// 读取先前 -format json 的输出 (每个基准项占一行)，返回 名字 -> ns/op
+bool LoadBenchBaseline(const string& path, map<string, double>& baseline) {
+    ifstream in(path);
+    if (!in.is_open()) { cout << "Error: Could not open baseline '" << path << "'" << endl; return false; }
+    string line;
+    while (getline(in, line)) {
+        size_t n = line.find("\"name\":\""), v = line.find("\"ns_per_op\":");
+        if (n == string::npos || v == string::npos) continue;
+        n += 8;
+        baseline[line.substr(n, line.find('"', n) - n)] = atof(line.c_str() + v + 12);
+    }
+    return true;
+}
+
+void PrintMicrobenchUsage() {
+    cout << "Usage: starfish_microbench [-filter SUBSTR] [-time MS] [-repeat N] [-format text|json|csv] [-out FILE]\n"
+            "                           [-label TEXT] [-compare BASELINE.json]\n"
+            "Times the core engine functions over a fixed set of " << BENCH_FEN_COUNT << " positions.\n"
+            "-time is the minimum duration of each measurement round (default 200), the best of -repeat rounds (default 5) is reported.\n"
+            "-compare prints the change in ns/op against a JSON file written by an earlier run." << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string filter, format = "text", outFile, label, compareFile;
+    int minMs = 200, repeat = 5;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string a = argv[i];
+            auto next = [&]() -> string { if (i + 1 >= argc) throw invalid_argument(a); return argv[++i]; };
+            if (a == "-filter") filter = next();
+            else if (a == "-time") minMs = max(1, stoi(next()));
+            else if (a == "-repeat") repeat = max(1, stoi(next()));
+            else if (a == "-format") format = next();
+            else if (a == "-out") outFile = next();
+            else if (a == "-label") label = next();
+            else if (a == "-compare") compareFile = next();
+            else { PrintMicrobenchUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintMicrobenchUsage(); return 2; }
+    if (format != "text" && format != "json" && format != "csv") { PrintMicrobenchUsage(); return 2; }
+    map<string, double> baseline;
+    if (!compareFile.empty() && !LoadBenchBaseline(compareFile, baseline)) return 2;
+
+    BuildBenchCorpus();
+    vector<BenchResult> results;
+    for (const auto& c : BenchCases()) {
+        if (!filter.empty() && string(c.name).find(filter) == string::npos) continue;
+        results.push_back(RunBenchCase(c, minMs, repeat));
+        if (format == "text" || !outFile.empty()) {
+            const BenchResult& r = results.back();
+            cout << left << setw(24) << r.name << right << fixed << setprecision(1) << setw(12) << r.nsPerOp << " ns/op";
+            if (r.allocsPerOp >= 0) cout << setprecision(2) << setw(10) << r.allocsPerOp << " allocs/op";
+            else cout << setw(20) << "n/a";
+            if (baseline.count(r.name) && baseline[r.name] > 0)
+                cout << setprecision(1) << showpos << setw(9) << 100.0 * (r.nsPerOp / baseline[r.name] - 1) << "%" << noshowpos;
+            cout << endl;
+        }
+    }
+    if (format == "text") return 0;
+    ofstream file;
+    if (!outFile.empty()) {
+        file.open(outFile);
+        if (!file.is_open()) { cout << "Error: Could not write '" << outFile << "'" << endl; return 1; }
+    }
+    ostream& out = outFile.empty() ? cout : file;
+    if (format == "json") WriteBenchJson(out, results, label); else WriteBenchCsv(out, results);
+    return 0;
+}
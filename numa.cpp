@@ -0,0 +1,188 @@
+// numa.cpp
+//Starfish --- chess engine developed by dsyoier
+//大表的内存与搜索线程的摆放：优先使用大页 (hugetlbfs，其次透明大页)，失败时退回普通页；
+//大表由分散在各 NUMA 节点上的线程并行清零，使每页在使用它的节点上首次触碰；搜索线程按节点轮流绑定到核心。
+#include "starfish.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <functional>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+const size_t PARALLEL_ZERO_MIN_BYTES = 64 * 1024 * 1024;   // 更小的表由使用它的线程自己清零
+
+// --- 拓扑：/sys/devices/system/node/node*/cpulist，与进程允许的 CPU 取交集 ---
+struct NumaTopology {
+    vector<vector<int>> nodes;   // 每个节点可用的 CPU
+
+    static vector<int> ParseCpuList(const string& s) {
+        vector<int> cpus;
+        stringstream ss(s);
+        string part;
+        while (getline(ss, part, ',')) {
+            size_t dash = part.find('-');
+            int lo = atoi(part.c_str()), hi = (dash == string::npos) ? lo : atoi(part.c_str() + dash + 1);
+            for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+        }
+        return cpus;
+    }
+    NumaTopology() {
+#ifndef _WIN32
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            for (int c = 0; c < CPU_SETSIZE; ++c) CPU_SET(c, &allowed);
+        for (int n = 0;; ++n) {
+            ifstream in("/sys/devices/system/node/node" + to_string(n) + "/cpulist");
+            if (!in.is_open()) break;
+            string line;
+            getline(in, line);
+            vector<int> cpus;
+            for (int c : ParseCpuList(line)) if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+            if (!cpus.empty()) nodes.push_back(cpus);
+        }
+        if (nodes.empty()) {
+            nodes.emplace_back();
+            for (int c = 0; c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &allowed)) nodes.back().push_back(c);
+        }
+#else
+        nodes.emplace_back(1, 0);
+#endif
+    }
+};
+const NumaTopology& Topology() {
+    static NumaTopology topology;
+    return topology;
+}
+int NumaNodeCount() { return (int)Topology().nodes.size(); }
+
+// --- 线程绑定：auto 时只在多节点机器上绑定 ---
+int threadBindingMode = -1;   // -1 auto，0 关，1 开
+bool ThreadBindingEnabled() { return threadBindingMode < 0 ? NumaNodeCount() > 1 : threadBindingMode == 1; }
+
+bool ParseNumaOption(const string& option, const string& value) {
+    if (option != "-bind") return false;
+    threadBindingMode = (value == "on") ? 1 : (value == "off") ? 0 : -1;
+    return true;
+}
+
+// 第 index 个线程：节点 index % N，节点内按轮次取核心
+void BindThreadToCore(int index) {
+#ifndef _WIN32
+    const auto& nodes = Topology().nodes;
+    const vector<int>& cpus = nodes[index % nodes.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[(index / nodes.size()) % cpus.size()], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)index;
+#endif
+}
+void BindSearchThread(int index) {
+    if (ThreadBindingEnabled()) BindThreadToCore(index);
+}
+
+// --- 大页分配：hugetlbfs → 2 MB 对齐的匿名映射 + MADV_HUGEPAGE → 普通页；映射得到的内存已为零 ---
+void* AllocateLargePages(size_t bytes, size_t& mappedBytes) {
+#ifndef _WIN32
+    size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef MAP_HUGETLB
+    void* p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) { mappedBytes = rounded; return p; }
+#endif
+    size_t span = rounded + HUGE_PAGE_SIZE;
+    char* raw = (char*)mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    char* aligned = (char*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    if (aligned > raw) munmap(raw, aligned - raw);
+    if (raw + span > aligned + rounded) munmap(aligned + rounded, raw + span - (aligned + rounded));
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, rounded, MADV_HUGEPAGE);
+#endif
+    mappedBytes = rounded;
+    return aligned;
+#else
+    mappedBytes = bytes;
+    return calloc(1, bytes);
+#endif
+}
+
+void FreeLargePages(void* p, size_t mappedBytes) {
+    if (!p) return;
+#ifndef _WIN32
+    munmap(p, mappedBytes);
+#else
+    (void)mappedBytes;
+    free(p);
+#endif
+}
+
+// 在 /proc/self/smaps 中查看这段映射实际得到的页：KernelPageSize 为 hugetlbfs 页大小，AnonHugePages 为透明大页
+string DescribePages(const void* p, size_t bytes) {
+#ifndef _WIN32
+    ifstream smaps("/proc/self/smaps");
+    string line;
+    bool inside = false;
+    long long pageKB = 0, hugeKB = 0;
+    while (getline(smaps, line)) {
+        unsigned long long lo, hi;
+        if (sscanf(line.c_str(), "%llx-%llx ", &lo, &hi) == 2) {
+            if (inside) break;
+            inside = (uintptr_t)p >= lo && (uintptr_t)p < hi;
+            continue;
+        }
+        if (!inside) continue;
+        if (line.compare(0, 15, "KernelPageSize:") == 0) pageKB = atoll(line.c_str() + 15);
+        else if (line.compare(0, 14, "AnonHugePages:") == 0) hugeKB = atoll(line.c_str() + 14);
+    }
+    if (pageKB > 4) return to_string(pageKB) + " KB hugetlbfs pages";
+    if (hugeKB > 0) return "transparent huge pages (" + to_string(hugeKB >> 10) + " of " + to_string(bytes >> 20) + " MB)";
+    return "4 KB pages";
+#else
+    (void)p; (void)bytes;
+    return "default pages";
+#endif
+}
+
+// 大表按页块均分给各节点上的临时线程处理 (fill 负责 [begin, end) 字节)；小表由调用线程自己完成
+void ParallelByNode(size_t bytes, const function<void(size_t, size_t)>& fill) {
+    int threads = bytes >= PARALLEL_ZERO_MIN_BYTES ? (int)max(1u, thread::hardware_concurrency()) : 1;
+    if (threads <= 1) { fill(0, bytes); return; }
+    size_t slice = (bytes / threads + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        size_t begin = min(bytes, t * slice), end = min(bytes, begin + slice);
+        pool.emplace_back([&fill, t, begin, end] {
+            if (NumaNodeCount() > 1) BindThreadToCore(t);
+            fill(begin, end);
+        });
+    }
+    for (auto& th : pool) th.join();
+}
+
+// 进程内第一次分配大表时报告一次
+void ReportLargeTable(const char* what, const void* p, size_t bytes) {
+    static once_flag reported;
+    call_once(reported, [&] {
+        cout << "info string " << what << ": " << (bytes >> 20) << " MB in " << DescribePages(p, bytes)
+             << "; NUMA nodes: " << NumaNodeCount() << ", thread binding " << (ThreadBindingEnabled() ? "on" : "off") << endl;
+    });
+}
@@ -0,0 +1,356 @@
+// pgn.cpp
+//Starfish --- chess engine developed by dsyoier
+//PGN 流式读取与 pgnscan 命令
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <cctype>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <functional>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+// --- PGN 流式读取：内存映射、逐局迭代、直接由 SAN 反推起点格 ---
+bool TextSpan::equals(const char* s) const { return strlen(s) == len && memcmp(ptr, s, len) == 0; }
+TextSpan PgnGame::Tag(const char* name) const {
+    for (const auto& t : tags) if (t.first.equals(name)) return t.second;
+    return TextSpan();
+}
+string PgnGame::TagValue(const char* name) const {
+    TextSpan v = Tag(name);
+    string out;
+    for (size_t i = 0; i < v.len; ++i) { if (v.ptr[i] == '\\' && i + 1 < v.len) ++i; out += v.ptr[i]; }
+    return out;
+}
+
+bool MappedFile::Open(const string& path) {
+#ifdef _WIN32
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) return false;
+    buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    data = buffer.data(); size = buffer.size();
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return false; }
+    size = (size_t)st.st_size;
+    if (size > 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { close(fd); size = 0; return false; }
+        madvise(p, size, MADV_SEQUENTIAL);
+        data = (const char*)p;
+    }
+    close(fd);
+    return true;
+#endif
+}
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (data) munmap((void*)data, size);
+#endif
+}
+
+bool PgnReader::NextGame(PgnGame& game) {
+    game.tags.clear();
+    while (true) {
+        while (p < end && isspace((unsigned char)*p)) ++p;
+        if (p >= end) return false;
+        game.offset = p - base;
+        while (p < end && *p == '[') {
+            ++p;
+            while (p < end && *p == ' ') ++p;
+            TextSpan name; name.ptr = p;
+            while (p < end && !isspace((unsigned char)*p) && *p != '"' && *p != ']') ++p;
+            name.len = p - name.ptr;
+            while (p < end && *p != '"' && *p != ']' && *p != '\n') ++p;
+            TextSpan value;
+            if (p < end && *p == '"') {
+                value.ptr = ++p;
+                while (p < end && *p != '"' && *p != '\n') { if (*p == '\\' && p + 1 < end) ++p; ++p; }
+                value.len = p - value.ptr;
+            }
+            while (p < end && *p != '\n') ++p;
+            game.tags.push_back(make_pair(name, value));
+            while (p < end && isspace((unsigned char)*p)) ++p;
+        }
+        // 着法区一直延伸到下一个行首的 '['，注释内的换行不算
+        game.movetext.ptr = p;
+        while (p < end) {
+            char c = *p;
+            if (c == '{') { const char* close = (const char*)memchr(p, '}', end - p); p = close ? close + 1 : end; continue; }
+            if (c == ';' || (c == '%' && (p == base || p[-1] == '\n'))) { const char* nl = (const char*)memchr(p, '\n', end - p); p = nl ? nl : end; continue; }
+            if (c == '\n' && p + 1 < end && p[1] == '[') { ++p; break; }
+            ++p;
+        }
+        game.movetext.len = p - game.movetext.ptr;
+        if (!game.tags.empty() || game.movetext.len > 0) return true;
+    }
+}
+
+inline bool IsPgnDelimiter(char c) { return isspace((unsigned char)c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';' || c == '$'; }
+
+// 取主线上的下一个 SAN；跳过注释、NAG、变着、回合号，遇到结果标记或着法区结束时返回 false
+bool NextSanToken(const char*& p, const char* end, TextSpan& token) {
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (isspace((unsigned char)c)) { ++p; continue; }
+        if (c == '{') { const char* close = (const char*)memchr(p, '}', end - p); p = close ? close + 1 : end; continue; }
+        if (c == ';' || c == '%') { const char* nl = (const char*)memchr(p, '\n', end - p); p = nl ? nl : end; continue; }
+        if (c == '(') { depth++; ++p; continue; }
+        if (c == ')') { if (depth > 0) depth--; ++p; continue; }
+        if (c == '$') { ++p; while (p < end && isdigit((unsigned char)*p)) ++p; continue; }
+        const char* s = p;
+        while (p < end && !IsPgnDelimiter(*p)) ++p;
+        if (depth > 0) continue;
+        if (isdigit((unsigned char)*s) && *s != '0') {
+            if (p - s >= 3 && (s[1] == '-' || s[1] == '/')) return false;          // 1-0, 1/2-1/2
+            while (s < p && isdigit((unsigned char)*s)) ++s;                       // 回合号，可能与着法连写 ("12.e4")
+            while (s < p && *s == '.') ++s;
+            if (s == p) continue;
+        } else if (*s == '0' && p - s >= 3 && s[1] == '-' && s[2] == '1') {
+            return false;                                                          // 0-1
+        }
+        if (*s == '*') return false;
+        const char* e = p;
+        while (e > s && (e[-1] == '!' || e[-1] == '?' || e[-1] == '+' || e[-1] == '#')) --e;
+        if (e == s) continue;
+        token.ptr = s; token.len = e - s;
+        return true;
+    }
+    return false;
+}
+
+// 按 SAN 直接找起点格：从目标格沿该兵种的走法反向查找，不生成完整的着法表；
+// 每个候选只检验这一步本身 (走子后本方王是否被攻击)，被牵制的子因此自然排除；易位另查格子是否为空、是否受攻击
+bool LeavesKingSafe(const Move& m) {
+    UndoInfo undo = MakeMove(m);
+    bool ok = !IsSquareAttacked(FindKing(1 - currentPlayer), currentPlayer);
+    UnmakeMove(m, undo);
+    return ok;
+}
+
+bool ApplySanMove(const TextSpan& san, Move* applied) {
+    const char* s = san.ptr;
+    const char* e = san.ptr + san.len;
+    int color = currentPlayer;
+    int rank = (color == WHITE) ? 1 : 8;
+    if (e - s >= 3 && (*s == 'O' || *s == '0')) {
+        bool queenside = (e - s >= 5);
+        Move m{Pos(5, rank), Pos(queenside ? 3 : 7, rank)};
+        int required = queenside ? (color == WHITE ? WQ_CASTLE : BQ_CASTLE) : (color == WHITE ? WK_CASTLE : BK_CASTLE);
+        int rookFile = queenside ? 1 : 8, step = queenside ? -1 : 1;
+        if (board[5][rank] != (KING | (color * COLOR_MASK)) || board[rookFile][rank] != (ROOK | (color * COLOR_MASK)) || !(castlingRights & required)) return false;
+        for (int x = 5 + step; x != rookFile; x += step) if (board[x][rank] != EMPTY_PIECE) return false;
+        for (int x = 5; x != m.to.x + step; x += step) if (IsSquareAttacked(Pos(x, rank), 1 - color)) return false;   // 王所在、经过与到达的格子
+        MakeMove(m);
+        if (applied) *applied = m;
+        return true;
+    }
+    int pieceType = PAWN;
+    switch (*s) {
+        case 'N': pieceType = KNIGHT; ++s; break;
+        case 'B': pieceType = BISHOP; ++s; break;
+        case 'R': pieceType = ROOK; ++s; break;
+        case 'Q': pieceType = QUEEN; ++s; break;
+        case 'K': pieceType = KING; ++s; break;
+    }
+    int promotion = EMPTY_PIECE;
+    if (e - s >= 2 && strchr("NBRQ", e[-1])) {
+        promotion = charToPiece.at(e[-1]) | (color * COLOR_MASK);
+        --e;
+        if (e[-1] == '=') --e;
+    }
+    char chars[6]; int n = 0;
+    for (const char* q = s; q < e; ++q) { if (*q == 'x' || *q == '-' || *q == ':') continue; if (n == 6) return false; chars[n++] = *q; }
+    if (n < 2) return false;
+    Pos to(chars[n - 2] - 'a' + 1, chars[n - 1] - '0');
+    if (!to.ok()) return false;
+    int from_file = -1, from_rank = -1;
+    for (int i = 0; i < n - 2; ++i) {
+        if (chars[i] >= 'a' && chars[i] <= 'h') from_file = chars[i] - 'a' + 1;
+        else if (chars[i] >= '1' && chars[i] <= '8') from_rank = chars[i] - '0';
+        else return false;
+    }
+    int own = pieceType | (color * COLOR_MASK);
+    if (PieceColorOf(board[to.x][to.y]) == color) return false;
+
+    Pos candidates[10]; int count = 0;
+    auto consider = [&](Pos from) {
+        if (from.ok() && board[from.x][from.y] == own && (from_file == -1 || from.x == from_file) && (from_rank == -1 || from.y == from_rank) && count < 10)
+            candidates[count++] = from;
+    };
+    if (pieceType == PAWN) {
+        int dir = (color == WHITE) ? 1 : -1;
+        if (from_file != -1 && from_file != to.x) {   // 吃子：目标格须有对方的子，或是吃过路兵的格子
+            if (abs(from_file - to.x) == 1 && (board[to.x][to.y] != EMPTY_PIECE || to == enPassantTarget)) consider(Pos(from_file, to.y - dir));
+        }
+        else if (board[to.x][to.y] == EMPTY_PIECE) {
+            Pos one(to.x, to.y - dir);
+            if (one.ok() && board[one.x][one.y] == own) consider(one);
+            else if (one.ok() && board[one.x][one.y] == EMPTY_PIECE && to.y == ((color == WHITE) ? 4 : 5)) consider(Pos(to.x, to.y - 2 * dir));
+        }
+        if (((to.y == 8 || to.y == 1) ? 1 : 0) != (promotion != EMPTY_PIECE ? 1 : 0)) return false;
+    } else if (pieceType == KNIGHT || pieceType == KING) {
+        const Pos* deltas = (pieceType == KNIGHT) ? knight_deltas : king_deltas;
+        for (int i = 0; i < 8; ++i) consider(Pos(to.x - deltas[i].x, to.y - deltas[i].y));
+    } else {
+        const Pos* deltas = (pieceType == BISHOP) ? bishop_deltas : (pieceType == ROOK ? rook_deltas : king_deltas);
+        int dirs = (pieceType == QUEEN) ? 8 : 4;
+        for (int i = 0; i < dirs; ++i) {
+            for (int j = 1; j < 8; ++j) {
+                Pos from(to.x - deltas[i].x * j, to.y - deltas[i].y * j);
+                if (!from.ok()) break;
+                if (board[from.x][from.y] != EMPTY_PIECE) { consider(from); break; }
+            }
+        }
+    }
+    int legal = 0;
+    for (int i = 0; i < count; ++i) if (LeavesKingSafe(Move{candidates[i], to, promotion})) candidates[legal++] = candidates[i];
+    if (legal != 1) return false;
+    Move m{candidates[0], to, promotion};
+    MakeMove(m);
+    if (applied) *applied = m;
+    return true;
+}
+
+const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+void LoadPgnStartPosition(const PgnGame& game) {
+    TextSpan fen = game.Tag("FEN");
+    if (fen.ptr && fen.len > 0) LoadFEN(fen.str()); else SetBoard();
+}
+
+// 从对局起始局面 (FEN 标签或初始局面) 重放主线；visit 在每步走完之后以 SAN 与解析出的着法调用
+bool ReplayPgnGame(const PgnGame& game, const function<void(const TextSpan&, const Move&)>& visit, TextSpan* failed) {
+    LoadPgnStartPosition(game);
+    const char* p = game.movetext.ptr;
+    const char* end = p + game.movetext.len;
+    TextSpan san;
+    Move m;
+    while (NextSanToken(p, end, san)) {
+        if (!ApplySanMove(san, &m)) { if (failed) *failed = san; return false; }
+        if (visit) visit(san, m);
+    }
+    return true;
+}
+
+// 按对局边界 ("\n[Event ") 把文件切成 threads 段并行遍历
+void ForEachPgnGame(const MappedFile& file, int threads, const function<void(const PgnGame&, int)>& visit) {
+    vector<const char*> cuts(threads + 1, file.data + file.size);
+    cuts[0] = file.data;
+    for (int t = 1; t < threads; ++t) {
+        const char* p = max(cuts[t - 1], file.data + file.size * t / threads);
+        const char* limit = file.data + file.size;
+        const char* found = limit;
+        for (; p + 8 <= limit; ++p) {
+            p = (const char*)memchr(p, '\n', limit - p);
+            if (!p || p + 8 > limit) break;
+            if (memcmp(p + 1, "[Event ", 7) == 0) { found = p + 1; break; }
+        }
+        cuts[t] = found;
+    }
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            PgnReader reader(cuts[t], cuts[t + 1], file.data);
+            PgnGame game;
+            while (reader.NextGame(game)) visit(game, t);
+        });
+    }
+    for (auto& th : pool) th.join();
+}
+
+bool LoadPGN(const string& filename) {
+    MappedFile file;
+    if (!file.Open(filename)) {
+        cout << "Error: Could not open PGN file '" << filename << "'" << endl;
+        return false;
+    }
+    PgnReader reader(file.data, file.data + file.size, file.data);
+    PgnGame game;
+    if (!reader.NextGame(game)) {
+        cout << "Error: No game found in PGN file '" << filename << "'" << endl;
+        return false;
+    }
+    TextSpan failed;
+    if (!ReplayPgnGame(game, nullptr, &failed)) {
+        cout << "Error parsing move '" << failed.str() << "' in PGN file. Stopping." << endl;
+        PrintBoard();
+        return false;
+    }
+    cout << "PGN file loaded successfully." << endl;
+    return true;
+}
+
+void PrintPgnScanUsage() {
+    cout << "Usage: chess_AI_multithreads pgnscan FILE [-threads N] [-replay]\n"
+            "Iterates every game in FILE and reports throughput. -replay also plays every SAN move." << endl;
+}
+
+int RunPgnScan(int argc, char* argv[]) {
+    if (argc < 1) { PrintPgnScanUsage(); return 2; }
+    string filename = argv[0];
+    int threads = 1;
+    bool replay = false;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-threads" && i + 1 < argc) threads = max(1, stoi(argv[++i]));
+            else if (a == "-replay") replay = true;
+            else { PrintPgnScanUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintPgnScanUsage(); return 2; }
+    MappedFile file;
+    if (!file.Open(filename)) { cout << "Error: Could not open PGN file '" << filename << "'" << endl; return 1; }
+
+    vector<long long> games(threads, 0), plies(threads, 0), errors(threads, 0);
+    mutex outputMutex;
+    auto start = chrono::high_resolution_clock::now();
+    ForEachPgnGame(file, threads, [&](const PgnGame& game, int t) {
+        games[t]++;
+        if (replay) {
+            trackPositionHistory = false;
+            long long n = 0;
+            TextSpan failed;
+            if (!ReplayPgnGame(game, [&](const TextSpan&, const Move&) { n++; }, &failed)) {
+                if (errors[t]++ < 10) {
+                    lock_guard<mutex> lock(outputMutex);
+                    cout << "Error: illegal or unparsable move '" << failed.str() << "' in game at byte offset " << game.offset << endl;
+                }
+            }
+            plies[t] += n;
+        } else {
+            const char* p = game.movetext.ptr;
+            const char* end = p + game.movetext.len;
+            TextSpan san;
+            while (NextSanToken(p, end, san)) plies[t]++;
+        }
+    });
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    long long total_games = 0, total_plies = 0, total_errors = 0;
+    for (int t = 0; t < threads; ++t) { total_games += games[t]; total_plies += plies[t]; total_errors += errors[t]; }
+    cout << "Games: " << total_games << "  Plies: " << total_plies << "  Errors: " << total_errors << endl;
+    cout << "Time: " << elapsed.count() << "s  (" << (long long)(total_games / max(1e-9, elapsed.count())) << " games/s, "
+         << (long long)(file.size / max(1e-9, elapsed.count()) / 1e6) << " MB/s)" << endl;
+    return total_errors ? 1 : 0;
+}
+
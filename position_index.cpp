@@ -0,0 +1,426 @@
+// position_index.cpp
+//Starfish --- chess engine developed by dsyoier
+//局面索引 (index) 的构建、合并与查询
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <cmath>
+#include <iomanip>
+#include <functional>
+#include <cstdlib>
+#include <climits>
+
+using namespace std;
+
+// --- 局面索引 (index)：PGN 库中 局面哈希 -> (着法, 胜和负计数, 对局偏移) ---
+// 文件布局：头部 | 数据块... | 源 PGN 路径表 | 块摘要 (每块首哈希与偏移)。
+// 块内按 (哈希, 着法) 排序，哈希、对局偏移做差分后以 varint 存储；同一哈希不会跨块。
+const char INDEX_MAGIC[8] = {'S', 'F', 'P', 'O', 'S', 'I', 'D', 'X'};
+const uint32_t INDEX_VERSION = 1;
+const int INDEX_BLOCK_ENTRIES = 128;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t fileCount;
+    uint64_t entryCount;
+    uint64_t blockCount;
+    uint64_t filesOffset;
+    uint64_t summaryOffset;
+};
+struct IndexRecord { uint64_t hash; uint64_t offset; uint16_t move; uint16_t file; uint8_t result; };
+struct IndexEntry {
+    uint64_t hash = 0;
+    uint16_t move = 0;
+    uint32_t counts[4] = {0, 0, 0, 0};              // 白胜、和、黑胜、未知
+    vector<pair<uint16_t, uint64_t>> games;         // (源文件编号, 对局字节偏移)，最多 maxRefs 个
+};
+
+uint16_t EncodeIndexMove(const Move& m) {
+    int promo = (m.promotion == EMPTY_PIECE) ? 0 : (m.promotion & PIECE_TYPE_MASK) - 1;
+    return (uint16_t)(((m.from.y - 1) * 8 + (m.from.x - 1)) | (((m.to.y - 1) * 8 + (m.to.x - 1)) << 6) | (promo << 12));
+}
+Move DecodeIndexMove(uint16_t code, int color) {
+    Move m;
+    m.from = Pos((code & 63) % 8 + 1, (code & 63) / 8 + 1);
+    m.to = Pos(((code >> 6) & 63) % 8 + 1, ((code >> 6) & 63) / 8 + 1);
+    int promo = (code >> 12) & 7;
+    if (promo) m.promotion = (promo + 1) | (color * COLOR_MASK);
+    return m;
+}
+
+inline void PutVarint(string& out, uint64_t v) {
+    while (v >= 0x80) { out += (char)(v | 0x80); v >>= 7; }
+    out += (char)v;
+}
+inline uint64_t GetVarint(const unsigned char*& p) {
+    uint64_t v = 0; int shift = 0;
+    while (*p & 0x80) { v |= (uint64_t)(*p++ & 0x7F) << shift; shift += 7; }
+    return v | ((uint64_t)(*p++) << shift);
+}
+
+struct IndexWriter {
+    ofstream out;
+    string block;
+    int blockEntries = 0;
+    uint64_t blockFirst = 0, prevHash = 0, entries = 0;
+    vector<pair<uint64_t, uint64_t>> summary;
+
+    bool Open(const string& path) {
+        out.open(path, ios::binary | ios::trunc);
+        IndexHeader h = {};
+        out.write((const char*)&h, sizeof(h));
+        return out.good();
+    }
+    void FlushBlock() {
+        if (blockEntries == 0) return;
+        summary.push_back(make_pair(blockFirst, (uint64_t)out.tellp()));
+        uint32_t len = (uint32_t)block.size(), n = (uint32_t)blockEntries;
+        out.write((const char*)&len, 4); out.write((const char*)&n, 4);
+        out.write(block.data(), block.size());
+        block.clear(); blockEntries = 0;
+    }
+    void Add(const IndexEntry& e) {
+        if (blockEntries >= INDEX_BLOCK_ENTRIES && e.hash != prevHash) FlushBlock();
+        if (blockEntries == 0) { blockFirst = prevHash = e.hash; }
+        PutVarint(block, e.hash - prevHash);
+        PutVarint(block, e.move);
+        for (uint32_t c : e.counts) PutVarint(block, c);
+        PutVarint(block, e.games.size());
+        uint16_t prevFile = 0; uint64_t prevOffset = 0;
+        for (const auto& g : e.games) {
+            if (g.first != prevFile) prevOffset = 0;
+            PutVarint(block, g.first - prevFile);
+            PutVarint(block, g.second - prevOffset);
+            prevFile = g.first; prevOffset = g.second;
+        }
+        prevHash = e.hash;
+        blockEntries++; entries++;
+    }
+    bool Finish(const vector<string>& files) {
+        FlushBlock();
+        IndexHeader h = {};
+        memcpy(h.magic, INDEX_MAGIC, 8);
+        h.version = INDEX_VERSION;
+        h.fileCount = (uint32_t)files.size();
+        h.entryCount = entries;
+        h.blockCount = summary.size();
+        h.filesOffset = out.tellp();
+        for (const auto& f : files) { uint32_t len = (uint32_t)f.size(); out.write((const char*)&len, 4); out.write(f.data(), len); }
+        h.summaryOffset = out.tellp();
+        for (const auto& s : summary) { out.write((const char*)&s.first, 8); out.write((const char*)&s.second, 8); }
+        out.seekp(0);
+        out.write((const char*)&h, sizeof(h));
+        out.close();
+        return !out.fail();
+    }
+};
+
+struct PositionIndex {
+    MappedFile file;
+    IndexHeader header;
+    vector<uint64_t> blockFirst, blockOffset;   // 常驻内存的块摘要
+    vector<string> files;
+
+    bool Open(const string& path) {
+        if (!file.Open(path) || file.size < sizeof(IndexHeader)) return false;
+        memcpy(&header, file.data, sizeof(header));
+        if (memcmp(header.magic, INDEX_MAGIC, 8) != 0 || header.version != INDEX_VERSION || header.summaryOffset + header.blockCount * 16 > file.size) return false;
+        const char* p = file.data + header.filesOffset;
+        for (uint32_t i = 0; i < header.fileCount; ++i) { uint32_t len; memcpy(&len, p, 4); files.push_back(string(p + 4, len)); p += 4 + len; }
+        p = file.data + header.summaryOffset;
+        blockFirst.resize(header.blockCount); blockOffset.resize(header.blockCount);
+        for (uint64_t i = 0; i < header.blockCount; ++i) { memcpy(&blockFirst[i], p, 8); memcpy(&blockOffset[i], p + 8, 8); p += 16; }
+        return true;
+    }
+    // 解码第 b 块，对每个条目调用 visit；visit 返回 false 时提前结束
+    void DecodeBlock(size_t b, const function<bool(const IndexEntry&)>& visit) const {
+        const char* base = file.data + blockOffset[b];
+        uint32_t n; memcpy(&n, base + 4, 4);
+        const unsigned char* p = (const unsigned char*)base + 8;
+        IndexEntry e;
+        e.hash = blockFirst[b];
+        for (uint32_t i = 0; i < n; ++i) {
+            e.hash += GetVarint(p);
+            e.move = (uint16_t)GetVarint(p);
+            for (uint32_t& c : e.counts) c = (uint32_t)GetVarint(p);
+            e.games.resize(GetVarint(p));
+            uint16_t file_id = 0; uint64_t offset = 0;
+            for (auto& g : e.games) {
+                uint16_t df = (uint16_t)GetVarint(p);
+                if (df) offset = 0;
+                file_id += df; offset += GetVarint(p);
+                g = make_pair(file_id, offset);
+            }
+            if (!visit(e)) return;
+        }
+    }
+    void Lookup(uint64_t hash, vector<IndexEntry>& out) const {
+        out.clear();
+        auto it = upper_bound(blockFirst.begin(), blockFirst.end(), hash);
+        if (it == blockFirst.begin()) return;
+        DecodeBlock(it - blockFirst.begin() - 1, [&](const IndexEntry& e) {
+            if (e.hash == hash) out.push_back(e);
+            return e.hash <= hash;
+        });
+    }
+};
+
+// 把已排序的原始记录聚合成条目，并与旧索引 (可为空) 归并写出
+bool WriteMergedIndex(const string& outPath, const PositionIndex* existing, const vector<IndexRecord>& records,
+                      const vector<string>& files, size_t maxRefs) {
+    IndexWriter writer;
+    if (!writer.Open(outPath)) return false;
+    size_t r = 0;
+    auto nextNew = [&](IndexEntry& e) -> bool {
+        if (r >= records.size()) return false;
+        e.hash = records[r].hash; e.move = records[r].move;
+        fill(e.counts, e.counts + 4, 0); e.games.clear();
+        for (; r < records.size() && records[r].hash == e.hash && records[r].move == e.move; ++r) {
+            e.counts[records[r].result]++;
+            if (e.games.size() < maxRefs && (e.games.empty() || e.games.back() != make_pair(records[r].file, records[r].offset)))
+                e.games.push_back(make_pair(records[r].file, records[r].offset));
+        }
+        return true;
+    };
+    IndexEntry pending;
+    bool havePending = nextNew(pending);
+    auto emitUpTo = [&](const IndexEntry* old) {
+        while (havePending && (!old || make_pair(pending.hash, pending.move) < make_pair(old->hash, old->move))) {
+            writer.Add(pending); havePending = nextNew(pending);
+        }
+        if (!old) return;
+        if (havePending && pending.hash == old->hash && pending.move == old->move) {
+            IndexEntry merged = *old;
+            for (int k = 0; k < 4; ++k) merged.counts[k] += pending.counts[k];
+            for (const auto& g : pending.games) if (merged.games.size() < maxRefs) merged.games.push_back(g);
+            writer.Add(merged);
+            havePending = nextNew(pending);
+        } else writer.Add(*old);
+    };
+    if (existing) {
+        for (size_t b = 0; b < existing->blockFirst.size(); ++b)
+            existing->DecodeBlock(b, [&](const IndexEntry& e) { emitUpTo(&e); return true; });
+    }
+    emitUpTo(nullptr);
+    return writer.Finish(files);
+}
+
+// 每个线程攒满一批 (上限的 1/(2*threads)) 就并入 records；records 达到上限的一半时调用 spill 写出，
+// 因此单个大 PGN 文件也不会超过 -memory
+bool CollectIndexRecords(const string& path, uint16_t fileId, int threads, int maxPly, size_t maxRecords, vector<IndexRecord>& records,
+                         const function<bool()>& spill, long long& games, long long& errors) {
+    MappedFile file;
+    if (!file.Open(path)) { cout << "Error: Could not open PGN file '" << path << "'" << endl; return false; }
+    vector<vector<IndexRecord>> partial(threads);
+    vector<long long> gameCount(threads, 0), errorCount(threads, 0);
+    const size_t batch = max<size_t>(1, maxRecords / (2 * threads));
+    mutex lock;
+    atomic<bool> failed(false);
+    auto flush = [&](int t) {
+        lock_guard<mutex> guard(lock);
+        records.insert(records.end(), partial[t].begin(), partial[t].end());
+        partial[t].clear();
+        if (!failed && records.size() >= maxRecords / 2 && !spill()) failed = true;
+    };
+    ForEachPgnGame(file, threads, [&](const PgnGame& game, int t) {
+        if (failed) return;
+        trackPositionHistory = false;
+        TextSpan res = game.Tag("Result");
+        uint8_t result = res.equals("1-0") ? 0 : res.equals("1/2-1/2") ? 1 : res.equals("0-1") ? 2 : 3;
+        LoadPgnStartPosition(game);
+        const char* p = game.movetext.ptr;
+        const char* end = p + game.movetext.len;
+        TextSpan san;
+        Move m;
+        gameCount[t]++;
+        for (int ply = 0; (maxPly == 0 || ply < maxPly) && NextSanToken(p, end, san); ++ply) {
+            uint64_t hash = ComputePositionHash();
+            if (!ApplySanMove(san, &m)) { errorCount[t]++; break; }
+            partial[t].push_back({hash, game.offset, EncodeIndexMove(m), fileId, result});
+        }
+        if (partial[t].size() >= batch) flush(t);
+    });
+    for (int t = 0; t < threads; ++t) {
+        records.insert(records.end(), partial[t].begin(), partial[t].end());
+        games += gameCount[t]; errors += errorCount[t];
+    }
+    return !failed;
+}
+
+void PrintIndexUsage() {
+    cout << "Usage: chess_AI_multithreads index build INDEX PGN... [-threads N] [-maxply N] [-maxrefs N] [-memory MB]\n"
+            "       chess_AI_multithreads index add INDEX PGN... [same options]\n"
+            "       chess_AI_multithreads index query INDEX [-fen FEN] [-moves \"e4 e5 ...\"] [-games N]\n"
+            "build replaces INDEX, add merges new PGN files into it. Positions are keyed by Zobrist hash." << endl;
+}
+
+string AbsolutePath(const string& path) {
+#ifdef _WIN32
+    return path;
+#else
+    char buf[4096];
+    return realpath(path.c_str(), buf) ? string(buf) : path;
+#endif
+}
+
+int RunIndexBuild(bool merge, int argc, char* argv[]) {
+    if (argc < 2) { PrintIndexUsage(); return 2; }
+    string indexPath = argv[0];
+    vector<string> pgnFiles;
+    int threads = max(1u, thread::hardware_concurrency());
+    int maxPly = 0;
+    size_t maxRefs = 100, memoryMb = 1024;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string a = argv[i];
+            auto next = [&]() -> string { if (i + 1 >= argc) throw invalid_argument(a); return argv[++i]; };
+            if (a == "-threads") threads = max(1, stoi(next()));
+            else if (a == "-maxply") maxPly = stoi(next());
+            else if (a == "-maxrefs") maxRefs = stoul(next());
+            else if (a == "-memory") memoryMb = max(1ul, stoul(next()));
+            else if (!a.empty() && a[0] == '-') { PrintIndexUsage(); return 2; }
+            else pgnFiles.push_back(a);
+        }
+    } catch (const std::exception&) { PrintIndexUsage(); return 2; }
+    if (pgnFiles.empty()) { PrintIndexUsage(); return 2; }
+
+    auto start = chrono::high_resolution_clock::now();
+    vector<string> files;
+    string current;                       // 已写出的中间/旧索引
+    if (merge) {
+        PositionIndex old;
+        if (!old.Open(indexPath)) { cout << "Error: '" << indexPath << "' is not a readable position index." << endl; return 1; }
+        files = old.files;
+        current = indexPath;
+    }
+    const string tmpPath[2] = {indexPath + ".tmp0", indexPath + ".tmp1"};
+    int nextTmp = 0;
+    vector<IndexRecord> records;
+    long long games = 0, errors = 0, positions = 0;
+    // 记录数超过内存上限时，排序后与已有部分归并成中间文件
+    auto spill = [&](bool final) -> bool {
+        sort(records.begin(), records.end(), [](const IndexRecord& a, const IndexRecord& b) {
+            if (a.hash != b.hash) return a.hash < b.hash;
+            if (a.move != b.move) return a.move < b.move;
+            if (a.file != b.file) return a.file < b.file;
+            return a.offset < b.offset;
+        });
+        string target = final ? indexPath + ".tmp" : tmpPath[nextTmp];
+        bool ok;
+        {
+            PositionIndex old;
+            bool haveOld = !current.empty() && old.Open(current);
+            ok = WriteMergedIndex(target, haveOld ? &old : nullptr, records, files, maxRefs);
+        }
+        if (!ok) { cout << "Error: Could not write '" << target << "'" << endl; return false; }
+        if (!current.empty() && current != indexPath) remove(current.c_str());
+        positions += records.size();
+        records.clear();
+        current = target;
+        nextTmp ^= 1;
+        return true;
+    };
+    const size_t maxRecords = memoryMb * 1024 * 1024 / sizeof(IndexRecord);
+    for (const auto& path : pgnFiles) {
+        if (files.size() >= 65535) { cout << "Error: Too many source files in one index." << endl; return 1; }
+        files.push_back(AbsolutePath(path));
+        if (!CollectIndexRecords(path, (uint16_t)(files.size() - 1), threads, maxPly, maxRecords, records, [&] { return spill(false); }, games, errors)) return 1;
+    }
+    if (!spill(true)) return 1;
+    if (rename(current.c_str(), indexPath.c_str()) != 0) { cout << "Error: Could not replace '" << indexPath << "'" << endl; return 1; }
+
+    PositionIndex result;
+    result.Open(indexPath);
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    cout << "Indexed " << games << " games (" << errors << " with errors), " << positions << " positions in " << elapsed.count() << "s" << endl;
+    cout << "Index '" << indexPath << "': " << result.header.entryCount << " entries in " << result.header.blockCount << " blocks, "
+         << result.files.size() << " source files, " << result.file.size << " bytes" << endl;
+    return 0;
+}
+
+int RunIndexQuery(int argc, char* argv[]) {
+    if (argc < 1) { PrintIndexUsage(); return 2; }
+    string fen = START_FEN, moves;
+    size_t showGames = 5;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "-fen" && i + 1 < argc) fen = argv[++i];
+        else if (a == "-moves" && i + 1 < argc) moves = argv[++i];
+        else if (a == "-games" && i + 1 < argc) showGames = atoi(argv[++i]);
+        else { PrintIndexUsage(); return 2; }
+    }
+    PositionIndex index;
+    if (!index.Open(argv[0])) { cout << "Error: '" << argv[0] << "' is not a readable position index." << endl; return 1; }
+    LoadFEN(fen);
+    stringstream ms(moves);
+    string san;
+    while (ms >> san) {
+        TextSpan span; span.ptr = san.data(); span.len = san.size();
+        const char* p = span.ptr;
+        if (!NextSanToken(p, span.ptr + span.len, span)) continue;
+        if (!ApplySanMove(span)) { cout << "Error: Illegal move '" << san << "'" << endl; return 1; }
+    }
+    uint64_t hash = ComputePositionHash();
+    vector<IndexEntry> entries;
+    auto start = chrono::high_resolution_clock::now();
+    index.Lookup(hash, entries);
+    chrono::duration<double, micro> elapsed = chrono::high_resolution_clock::now() - start;
+
+    cout << "Position: " << GenerateFEN() << "  (hash " << hex << hash << dec << ")" << endl;
+    sort(entries.begin(), entries.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.counts[0] + a.counts[1] + a.counts[2] + a.counts[3] > b.counts[0] + b.counts[1] + b.counts[2] + b.counts[3];
+    });
+    vector<Move> legal_moves; GenerateLegalMoves(legal_moves);
+    cout << left << setw(9) << "Move" << right << setw(9) << "Games" << setw(9) << "White" << setw(9) << "Draw" << setw(9) << "Black" << setw(9) << "Score" << endl;
+    for (const auto& e : entries) {
+        Move m = DecodeIndexMove(e.move, currentPlayer);
+        bool legal = find(legal_moves.begin(), legal_moves.end(), m) != legal_moves.end();
+        uint32_t decided = e.counts[0] + e.counts[1] + e.counts[2];
+        double score = decided ? (e.counts[0] + 0.5 * e.counts[1]) / decided : 0.5;
+        if (currentPlayer == BLACK) score = 1 - score;
+        cout << left << setw(9) << (legal ? MoveToSAN(m, legal_moves) : MoveToUCI(m) + "?") << right
+             << setw(9) << e.counts[0] + e.counts[1] + e.counts[2] + e.counts[3] << setw(9) << e.counts[0] << setw(9) << e.counts[1]
+             << setw(9) << e.counts[2] << setw(8) << fixed << setprecision(1) << score * 100 << "%" << defaultfloat << endl;
+    }
+    cout << "Lookup: " << entries.size() << " moves in " << elapsed.count() << " us" << endl;
+
+    size_t shown = 0;
+    for (const auto& e : entries) {
+        for (const auto& g : e.games) {
+            if (shown++ >= showGames) break;
+            const string& path = index.files[g.first];
+            string label;
+            MappedFile pgn;
+            if (pgn.Open(path) && g.second < pgn.size) {
+                PgnReader reader(pgn.data + g.second, pgn.data + pgn.size, pgn.data);
+                PgnGame game;
+                if (reader.NextGame(game)) label = game.TagValue("White") + " - " + game.TagValue("Black") + " " + game.TagValue("Result");
+            }
+            cout << "  " << path << ":" << g.second << "  " << label << endl;
+        }
+    }
+    return entries.empty() ? 1 : 0;
+}
+
+int RunIndex(int argc, char* argv[]) {
+    string sub = (argc > 0) ? argv[0] : "";
+    if (sub == "build") return RunIndexBuild(false, argc - 1, argv + 1);
+    if (sub == "add") return RunIndexBuild(true, argc - 1, argv + 1);
+    if (sub == "query") return RunIndexQuery(argc - 1, argv + 1);
+    PrintIndexUsage();
+    return 2;
+}
@@ -0,0 +1,193 @@
+// scalebench.cpp
+//Starfish --- chess engine developed by dsyoier
+//多线程搜索 (多个线程共用一张置换表搜索同一局面) 与 scalebench 命令：在 1, 2, 4 … N 个线程下重复搜索固定局面，
+//统计到达各深度的用时、NPS、置换表命中率以及与单线程最佳着法的一致率，打印加速比与效率表和 CSV
+#include "starfish.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+// --- 多线程搜索：各线程独立迭代加深，只经由置换表协作；任一线程完成某一深度即记下该深度的用时 ---
+ThreadedSearchResult SearchWithThreads(const Position& position, int threads, int depth, TranspositionTable& table) {
+    ThreadedSearchResult result;
+    result.depthMs.assign(depth + 1, 0);
+    atomic<bool> stop(false);
+    atomic<long long> nodes(0), probes(0), hits(0);
+    mutex lock;
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int i = 0; i < threads; ++i) {
+        pool.emplace_back([&, i] {
+            BindSearchThread(i);
+            position.Load();
+            SetThreadTT(&table);
+            searchQuiet = true;
+            searchMultiPV = 1;
+            searchMaxDepth = depth;
+            searchTimeLimitMs = numeric_limits<int>::max();
+            searchNodeLimit = 0;
+            searchStopFlag = &stop;
+#ifdef STARFISH_STATS
+            ResetGameStats();
+#endif
+            searchInfoCallback = [&](const SearchInfo& info) {
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                lock_guard<mutex> guard(lock);
+                double& slot = result.depthMs[info.depth];
+                if (slot == 0 || ms < slot) slot = ms;
+            };
+            SearchBestMove(depth);
+            if (!stop.exchange(true)) {
+                result.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                result.best = searchBestMove;
+                result.score = searchBestScore;
+            }
+            nodes += computedNodes;
+#ifdef STARFISH_STATS
+            long long threadProbes, threadHits;
+            GameHashStats(threadProbes, threadHits);
+            probes += threadProbes;
+            hits += threadHits;
+#endif
+            searchInfoCallback = nullptr;
+            searchStopFlag = nullptr;
+            SetThreadTT(nullptr);
+        });
+    }
+    for (auto& t : pool) t.join();
+    result.nodes = nodes;
+    result.ttProbes = probes;
+    result.ttHits = hits;
+    return result;
+}
+
+// --- scalebench 命令 ---
+struct ScaleRow {
+    int threads = 0;
+    vector<double> depthMs;       // 各局面重复平均后求和
+    vector<double> finalMs;       // 每次重复的全部局面总用时 (看波动)
+    long long nodes = 0, probes = 0, hits = 0;
+    double ms = 0;
+    int agree = 0, searches = 0;
+    double Nps() const { return nodes / max(1e-3, ms / 1000); }
+};
+
+void PrintScaleBenchUsage() {
+    cout << "Usage: scalebench [-threads N] [-depth D] [-positions K] [-repeat R] [-csv FILE]\n"
+            "Searches the first K bench positions (default 8) to depth D (default 6) with 1, 2, 4 ... N threads\n"
+            "(default: all hardware threads) sharing one hash table of -hash MB. Each configuration is repeated\n"
+            "R times (default 3) and averaged. Prints time to each depth, speedup and efficiency against one thread,\n"
+            "NPS, hash hit rate (builds with -DSTARFISH_STATS only) and how often the best move agrees with the single-thread result, then the same\n"
+            "figures as CSV (to FILE, or to standard output)." << endl;
+}
+
+int RunScaleBench(int argc, char* argv[]) {
+    int maxThreads = max(1, (int)thread::hardware_concurrency()), depth = 6, positions = 8, repeat = 3;
+    string csvPath;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-threads" && i + 1 < argc) maxThreads = max(1, stoi(argv[++i]));
+            else if (a == "-depth" && i + 1 < argc) depth = max(2, stoi(argv[++i]));
+            else if (a == "-positions" && i + 1 < argc) positions = max(1, min(BENCH_POSITION_COUNT, stoi(argv[++i])));
+            else if (a == "-repeat" && i + 1 < argc) repeat = max(1, stoi(argv[++i]));
+            else if (a == "-csv" && i + 1 < argc) csvPath = argv[++i];
+            else { PrintScaleBenchUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintScaleBenchUsage(); return 2; }
+    depth &= ~1;   // 迭代加深以 2 为步长
+    vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+    TranspositionTable table;
+    if (!table.Allocate(ttDefaultSizeMB)) return 1;
+
+    vector<Move> reference(positions);
+    vector<ScaleRow> rows;
+    for (int threads : counts) {
+        ScaleRow row;
+        row.threads = threads;
+        row.depthMs.assign(depth + 1, 0);
+        for (int r = 0; r < repeat; ++r) {
+            double repeatMs = 0;
+            for (int p = 0; p < positions; ++p) {
+                Position position;
+                position.SetFEN(BENCH_POSITIONS[p]);
+                table.Clear();
+                ThreadedSearchResult res = SearchWithThreads(position, threads, depth, table);
+                for (int d = 2; d <= depth; d += 2) row.depthMs[d] += res.depthMs[d] / repeat;
+                row.ms += res.ms;
+                row.nodes += res.nodes;
+                row.probes += res.ttProbes;
+                row.hits += res.ttHits;
+                repeatMs += res.ms;
+                if (rows.empty() && r == 0) reference[p] = res.best;
+                row.agree += (res.best == reference[p]);
+                row.searches++;
+            }
+            row.finalMs.push_back(repeatMs);
+        }
+        rows.push_back(row);
+        cout << "info string " << threads << " thread" << (threads > 1 ? "s" : "") << " done" << endl;
+    }
+
+    const ScaleRow& base = rows[0];
+    auto spread = [](const vector<double>& v) {
+        double mean = 0, var = 0;
+        for (double x : v) mean += x / v.size();
+        for (double x : v) var += (x - mean) * (x - mean) / v.size();
+        return mean > 0 ? 100 * sqrt(var) / mean : 0.0;
+    };
+    cout << "----------------------------------" << endl;
+    cout << positions << " positions, depth " << depth << ", " << repeat << " repeats, hash " << ttDefaultSizeMB << " MB" << endl;
+    cout << "Threads |";
+    for (int d = 2; d <= depth; d += 2) cout << setw(9) << ("d" + to_string(d) + " ms");
+    cout << " | speedup  effic. | spread |        NPS  NPS x | hash hits | agree" << endl;
+    cout << fixed;
+    for (const auto& row : rows) {
+        double speedup = base.depthMs[depth] / max(1e-3, row.depthMs[depth]);
+        string hitRate = "n/a";   // 探测计数只在 -DSTARFISH_STATS 构建中统计
+        if (row.probes) { stringstream ss; ss << fixed << setprecision(1) << 100.0 * row.hits / row.probes << "%"; hitRate = ss.str(); }
+        cout << setw(7) << row.threads << " |";
+        for (int d = 2; d <= depth; d += 2) cout << setw(9) << setprecision(0) << row.depthMs[d];
+        cout << " | " << setw(6) << setprecision(2) << speedup << "x " << setw(6) << setprecision(1) << 100 * speedup / row.threads << "%"
+             << " | " << setw(5) << spread(row.finalMs) << "%"
+             << " | " << setw(10) << setprecision(0) << row.Nps() << " " << setw(4) << setprecision(2) << row.Nps() / base.Nps() << "x"
+             << " | " << setw(9) << hitRate
+             << " | " << setw(4) << setprecision(0) << 100.0 * row.agree / row.searches << "%" << endl;
+    }
+    cout << defaultfloat << setprecision(6);
+
+    ofstream csvFile;
+    if (!csvPath.empty()) {
+        csvFile.open(csvPath);
+        if (!csvFile.is_open()) { cout << "Error: Could not open CSV file '" << csvPath << "'" << endl; return 2; }
+    } else {
+        cout << "----------------------------------" << endl;
+    }
+    ostream& csv = csvPath.empty() ? cout : csvFile;
+    csv << "threads,depth,time_ms,speedup,efficiency,nps,nps_speedup,hash_hit_rate,best_move_agreement" << endl;
+    for (const auto& row : rows) {
+        for (int d = 2; d <= depth; d += 2) {
+            double speedup = base.depthMs[d] / max(1e-3, row.depthMs[d]);
+            csv << row.threads << "," << d << "," << row.depthMs[d] << "," << speedup << "," << speedup / row.threads << ","
+                << (long long)row.Nps() << "," << row.Nps() / base.Nps() << ",";
+            if (row.probes) csv << (double)row.hits / row.probes;
+            csv << ","
+                << (double)row.agree / row.searches << endl;
+        }
+    }
+    return 0;
+}
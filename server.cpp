@@ -0,0 +1,526 @@
+// server.cpp
+//Starfish --- chess engine developed by dsyoier
+//多会话引擎服务 (server)：一个进程经 TCP 或 Unix 套接字承载大量对局会话，会话的搜索请求按优先级排队，
+//由固定数量的 Engine 工作者执行；开局库、残局库与置换表在全部会话间共享。
+#include "starfish.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <iomanip>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+using namespace std;
+
+// --- 协议：每行一条命令，会话以整数 ID 区分；会话属于创建它的连接，连接断开时一并关闭 ---
+// 客户端 → 服务：new [time MS] [nodes N] [priority P] | position S startpos|fen FEN [moves M...] | move S M...
+//               budget S [time MS] [nodes N] [priority P] | go S [movetime MS] [nodes N] [depth D] [priority P]
+//               stop S | close S | stats | quit | shutdown
+// 服务 → 客户端：session S | ok | bestmove S MOVE [ponder M] (score cp X nodes N time T wait W | book) | stats ... | error MESSAGE
+const int SERVER_DEFAULT_PORT = 7800;
+const size_t SERVER_LINE_MAX = 64 * 1024;      // 超过此长度仍无换行的连接被断开
+const size_t LATENCY_SAMPLES = 4096;          // 延迟百分位取最近这么多次搜索
+
+#ifndef _WIN32
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+struct ServerOptions {
+    string host = "127.0.0.1";
+    int port = SERVER_DEFAULT_PORT;
+    string unixPath;          // 非空时改为监听 Unix 套接字
+    int workers = 0;          // 0 = 硬件线程数
+    int maxTimeMs = 5000;     // 每次搜索的时间上限，也是会话的默认预算
+    long long maxNodes = 0;   // 每次搜索的节点上限，0 = 不限
+    int maxSessions = 10000;
+};
+struct ServerSession {
+    int conn = -1;
+    Position position;
+    int timeMs = 0;           // 每次搜索的预算，0 = 服务上限
+    long long nodes = 0;
+    int priority = 0;         // 越大越先
+    bool queued = false;
+    int engine = -1;          // 正在执行它的工作者，-1 = 没有
+    long long searches = 0, nodesUsed = 0;
+};
+struct ServerJob {
+    int session;
+    int priority;
+    long long seq;
+    SearchLimits limits;
+    chrono::steady_clock::time_point received;
+};
+struct ServerJobOrder {
+    bool operator()(const ServerJob& a, const ServerJob& b) const {
+        return a.priority != b.priority ? a.priority < b.priority : a.seq > b.seq;   // 同优先级先来先服务
+    }
+};
+struct ServerConnection {
+    int fd = -1;
+    string in, out;
+    vector<int> sessions;
+    bool closing = false;     // 发完 out 后关闭
+};
+struct ServerSlot {           // 一个工作者当前执行的搜索
+    int session = -1;
+    chrono::steady_clock::time_point received, started;
+};
+
+int OpenTcpListener(const string& host, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1
+        || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 256) != 0) { close(fd); return -1; }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int OpenUnixListener(const string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    unlink(path.c_str());
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 256) != 0) { close(fd); return -1; }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+double Percentile(vector<double> samples, double q) {
+    if (samples.empty()) return 0;
+    size_t k = min(samples.size() - 1, (size_t)(q * samples.size()));
+    nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+class EngineServer {
+public:
+    EngineServer(const ServerOptions& o, int listenFd) : opt(o), listener(listenFd) {}
+    ~EngineServer() {
+        for (auto& e : engines) e->Stop();
+        engines.clear();   // 先结束工作线程，之后不会再有完成通知
+        for (auto& c : conns) close(c.second.fd);
+        close(wake[0]);
+        close(wake[1]);
+    }
+
+    bool Start() {
+        if (pipe(wake) != 0) return false;
+        fcntl(wake[0], F_SETFL, fcntl(wake[0], F_GETFL) | O_NONBLOCK);
+        if (!table.Allocate(ttDefaultSizeMB)) return false;
+        for (int i = 0; i < opt.workers; ++i) engines.emplace_back(new Engine(0, &table));
+        slots.assign(opt.workers, ServerSlot());
+        startTime = chrono::steady_clock::now();
+        return true;
+    }
+
+    void Run() {
+        while (!shutdown) {
+            vector<pollfd> fds;
+            fds.push_back({listener, POLLIN, 0});
+            fds.push_back({wake[0], POLLIN, 0});
+            vector<int> ids;
+            for (auto& c : conns) {
+                fds.push_back({c.second.fd, (short)(POLLIN | (c.second.out.empty() ? 0 : POLLOUT)), 0});
+                ids.push_back(c.first);
+            }
+            if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) break;
+            if (fds[1].revents & POLLIN) Collect();
+            char chunk[65536];
+            for (size_t i = 0; i < ids.size(); ++i) {
+                auto it = conns.find(ids[i]);
+                if (it == conns.end()) continue;
+                ServerConnection& c = it->second;
+                short ev = fds[i + 2].revents;
+                bool dead = false;
+                if (ev & POLLOUT) {
+                    ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+                    if (n > 0) c.out.erase(0, n);
+                    else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) dead = true;
+                }
+                if (!dead && (ev & (POLLIN | POLLHUP | POLLERR))) {
+                    ssize_t n = recv(c.fd, chunk, sizeof(chunk), 0);
+                    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) dead = true;
+                    else if (n > 0) c.in.append(chunk, n);
+                    size_t eol;
+                    while (!dead && !c.closing && (eol = c.in.find('\n')) != string::npos) {
+                        string line = c.in.substr(0, eol);
+                        c.in.erase(0, eol + 1);
+                        if (!line.empty() && line.back() == '\r') line.pop_back();
+                        Handle(ids[i], line);
+                    }
+                    if (c.in.size() > SERVER_LINE_MAX) dead = true;
+                }
+                if (dead || (c.closing && c.out.empty())) CloseConnection(ids[i]);
+            }
+            if (fds[0].revents & POLLIN) Accept();
+            Dispatch();
+        }
+        for (auto& c : conns) {   // 关闭前尽量送出已排队的回复
+            fcntl(c.second.fd, F_SETFL, fcntl(c.second.fd, F_GETFL) & ~O_NONBLOCK);
+            send(c.second.fd, c.second.out.data(), c.second.out.size(), MSG_NOSIGNAL);
+        }
+    }
+
+    string Stats() const {
+        double uptime = max(1e-3, chrono::duration<double>(chrono::steady_clock::now() - startTime).count());
+        int running = 0;
+        for (const auto& s : slots) running += s.session >= 0;
+        ostringstream os;
+        os << fixed << setprecision(1);
+        os << "stats sessions " << sessions.size() << " connections " << conns.size() << " workers " << engines.size()
+           << " running " << running << " queue " << queue.size() << " searches " << completed << " book " << bookMoves
+           << " latency_ms p50 " << Percentile(latency, 0.5) << " p90 " << Percentile(latency, 0.9) << " p99 " << Percentile(latency, 0.99)
+           << " wait_ms p50 " << Percentile(waits, 0.5) << " p99 " << Percentile(waits, 0.99)
+           << setprecision(0) << " nps " << totalNodes / uptime << " worker_nps " << totalNodes / max(1e-3, busySeconds)
+           << setprecision(1) << " utilization " << 100 * busySeconds / (uptime * engines.size()) << "%";
+        return os.str();
+    }
+
+private:
+    const ServerOptions& opt;
+    int listener;
+    int wake[2] = {-1, -1};   // 工作者完成搜索时写一个字节唤醒 poll
+    bool shutdown = false;
+    unordered_map<int, ServerConnection> conns;
+    unordered_map<int, ServerSession> sessions;
+    priority_queue<ServerJob, vector<ServerJob>, ServerJobOrder> queue;
+    int nextConn = 0, nextSession = 1;
+    long long nextSeq = 0;
+    chrono::steady_clock::time_point startTime;
+    // 统计
+    long long completed = 0, bookMoves = 0, totalNodes = 0;
+    double busySeconds = 0;
+    vector<double> latency, waits;   // 环形，各 LATENCY_SAMPLES 个
+    size_t sampleCursor = 0;
+    // 工作者
+    TranspositionTable table;
+    mutex doneLock;
+    vector<pair<int, SearchResult>> done;   // 工作者线程写入，主线程取走
+    vector<ServerSlot> slots;
+    vector<unique_ptr<Engine>> engines;     // 最后析构
+
+    void Reply(int conn, const string& line) {
+        auto it = conns.find(conn);
+        if (it != conns.end()) it->second.out += line + "\n";
+    }
+
+    void Accept() {
+        for (;;) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) return;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            conns[nextConn++].fd = fd;
+        }
+    }
+
+    void CloseConnection(int id) {
+        auto it = conns.find(id);
+        if (it == conns.end()) return;
+        for (int s : it->second.sessions) CloseSession(s);
+        close(it->second.fd);
+        conns.erase(it);
+    }
+
+    // 正在搜索的会话先停止；它的结果到达时会话已不存在，结果被丢弃
+    void CloseSession(int id) {
+        auto it = sessions.find(id);
+        if (it == sessions.end()) return;
+        if (it->second.engine >= 0) engines[it->second.engine]->Stop();
+        sessions.erase(it);
+    }
+
+    // 取出 conn 所拥有的会话；不存在时回复错误并返回 nullptr
+    ServerSession* Find(int conn, istringstream& args) {
+        int id;
+        if (!(args >> id)) { Reply(conn, "error missing session id"); return nullptr; }
+        auto it = sessions.find(id);
+        if (it == sessions.end() || it->second.conn != conn) { Reply(conn, "error unknown session " + to_string(id)); return nullptr; }
+        return &it->second;
+    }
+
+    // 读取 time / nodes / priority 形式的键值对，未知键返回 false
+    bool ReadBudget(istringstream& args, int& timeMs, long long& nodes, int& priority, int* depth = nullptr) {
+        string key;
+        while (args >> key) {
+            long long value;
+            if (!(args >> value)) return false;
+            if (key == "time" || key == "movetime") timeMs = (int)max(0LL, min<long long>(value, numeric_limits<int>::max()));
+            else if (key == "nodes") nodes = max(0LL, value);
+            else if (key == "priority") priority = (int)value;
+            else if (key == "depth" && depth) *depth = (int)max(1LL, min(64LL, value));
+            else return false;
+        }
+        return true;
+    }
+
+    void Handle(int conn, const string& line) {
+        istringstream args(line);
+        string cmd;
+        if (!(args >> cmd)) return;
+        if (cmd == "new") {
+            if ((int)sessions.size() >= opt.maxSessions) { Reply(conn, "error too many sessions"); return; }
+            ServerSession s;
+            s.conn = conn;
+            if (!ReadBudget(args, s.timeMs, s.nodes, s.priority)) { Reply(conn, "error bad budget"); return; }
+            int id = nextSession++;
+            sessions[id] = s;
+            conns[conn].sessions.push_back(id);
+            Reply(conn, "session " + to_string(id));
+        } else if (cmd == "position") {
+            ServerSession* s = Find(conn, args);
+            if (!s) return;
+            string kind, word, fen;
+            args >> kind;
+            Position p;
+            if (kind == "fen") {
+                while (args >> word && word != "moves") fen += (fen.empty() ? "" : " ") + word;
+                if (!p.SetFEN(fen)) { Reply(conn, "error bad fen"); return; }
+            } else if (kind != "startpos") { Reply(conn, "error expected startpos or fen"); return; }
+            else if (args >> word && word != "moves") { Reply(conn, "error expected moves"); return; }
+            while (args >> word) if (!p.Play(word)) { Reply(conn, "error illegal move " + word); return; }
+            s->position = p;
+            Reply(conn, "ok");
+        } else if (cmd == "move") {
+            ServerSession* s = Find(conn, args);
+            if (!s) return;
+            Position p = s->position;
+            string word;
+            while (args >> word) if (!p.Play(word)) { Reply(conn, "error illegal move " + word); return; }
+            s->position = p;
+            Reply(conn, "ok");
+        } else if (cmd == "budget") {
+            ServerSession* s = Find(conn, args);
+            if (!s) return;
+            ServerSession b = *s;
+            if (!ReadBudget(args, b.timeMs, b.nodes, b.priority)) { Reply(conn, "error bad budget"); return; }
+            *s = b;
+            Reply(conn, "ok");
+        } else if (cmd == "go") {
+            Go(conn, args);
+        } else if (cmd == "stop") {
+            int id;
+            if (!(args >> id) || !sessions.count(id) || sessions[id].conn != conn) { Reply(conn, "error unknown session"); return; }
+            ServerSession& s = sessions[id];
+            if (s.engine >= 0) engines[s.engine]->Stop();
+            else if (s.queued) {   // 尚未开始的搜索直接撤销，队列中的任务在派发时跳过
+                s.queued = false;
+                Reply(conn, "bestmove " + to_string(id) + " (none)");
+            }
+        } else if (cmd == "close") {
+            int id;
+            if (!(args >> id) || !sessions.count(id) || sessions[id].conn != conn) { Reply(conn, "error unknown session"); return; }
+            CloseSession(id);
+            auto& owned = conns[conn].sessions;
+            owned.erase(remove(owned.begin(), owned.end(), id), owned.end());
+            Reply(conn, "ok");
+        } else if (cmd == "stats") {
+            Reply(conn, Stats());
+        } else if (cmd == "quit") {
+            conns[conn].closing = true;
+        } else if (cmd == "shutdown") {
+            Reply(conn, "ok");
+            shutdown = true;
+        } else {
+            Reply(conn, "error unknown command " + cmd);
+        }
+    }
+
+    void Go(int conn, istringstream& args) {
+        int id;
+        if (!(args >> id)) { Reply(conn, "error missing session id"); return; }
+        auto it = sessions.find(id);
+        if (it == sessions.end() || it->second.conn != conn) { Reply(conn, "error unknown session " + to_string(id)); return; }
+        ServerSession& s = it->second;
+        if (s.queued || s.engine >= 0) { Reply(conn, "error session " + to_string(id) + " is already searching"); return; }
+        int timeMs = s.timeMs, priority = s.priority, depth = 0;
+        long long nodes = s.nodes;
+        if (!ReadBudget(args, timeMs, nodes, priority, &depth)) { Reply(conn, "error bad go arguments"); return; }
+        string prefix = "bestmove " + to_string(id) + " ";
+        vector<Move> legal = s.position.LegalMoves();
+        if (legal.empty()) { Reply(conn, prefix + "(none)"); return; }
+        // 开局库在主线程直接作答，不占用工作者
+        auto book = openingBook.find(s.position.FEN());
+        if (book != openingBook.end()) {
+            Move m = parse_uci_move(book->second);
+            if (find(legal.begin(), legal.end(), m) != legal.end()) {
+                bookMoves++;
+                Reply(conn, prefix + MoveToUCI(m) + " book");
+                return;
+            }
+        }
+        ServerJob job;
+        job.session = id;
+        job.priority = priority;
+        job.seq = nextSeq++;
+        job.limits.timeMs = timeMs > 0 ? (opt.maxTimeMs > 0 ? min(timeMs, opt.maxTimeMs) : timeMs) : opt.maxTimeMs;
+        job.limits.nodes = nodes > 0 ? (opt.maxNodes > 0 ? min(nodes, opt.maxNodes) : nodes) : opt.maxNodes;
+        job.limits.depth = depth;
+        job.limits.minDepth = 2;
+        job.received = chrono::steady_clock::now();
+        if (!job.limits.timeMs && !job.limits.nodes && !depth) job.limits.depth = 8;   // 没有任何上限时避免无限搜索
+        queue.push(job);
+        s.queued = true;
+    }
+
+    void Dispatch() {
+        for (size_t e = 0; e < engines.size() && !queue.empty(); ++e) {
+            if (slots[e].session >= 0) continue;
+            while (!queue.empty()) {
+                ServerJob job = queue.top();
+                queue.pop();
+                auto it = sessions.find(job.session);
+                if (it == sessions.end() || !it->second.queued) continue;   // 已关闭或已撤销
+                it->second.queued = false;
+                it->second.engine = (int)e;
+                slots[e].session = job.session;
+                slots[e].received = job.received;
+                slots[e].started = chrono::steady_clock::now();
+                engines[e]->SetPosition(it->second.position);
+                int index = (int)e;
+                engines[e]->Go(job.limits, nullptr, [this, index](const SearchResult& r) {
+                    {
+                        lock_guard<mutex> guard(doneLock);
+                        done.emplace_back(index, r);
+                    }
+                    char byte = 1;
+                    if (write(wake[1], &byte, 1) < 0) {}
+                });
+                break;
+            }
+        }
+    }
+
+    void Record(double latencyMs, double waitMs) {
+        if (latency.size() < LATENCY_SAMPLES) { latency.push_back(latencyMs); waits.push_back(waitMs); }
+        else { latency[sampleCursor] = latencyMs; waits[sampleCursor] = waitMs; }
+        sampleCursor = (sampleCursor + 1) % LATENCY_SAMPLES;
+    }
+
+    void Collect() {
+        char drain[256];
+        while (read(wake[0], drain, sizeof(drain)) > 0) {}
+        vector<pair<int, SearchResult>> finished;
+        {
+            lock_guard<mutex> guard(doneLock);
+            finished.swap(done);
+        }
+        auto now = chrono::steady_clock::now();
+        for (const auto& f : finished) {
+            ServerSlot& slot = slots[f.first];
+            const SearchResult& r = f.second;
+            double waitMs = chrono::duration<double, milli>(slot.started - slot.received).count();
+            double latencyMs = chrono::duration<double, milli>(now - slot.received).count();
+            completed++;
+            totalNodes += r.nodes;
+            busySeconds += chrono::duration<double>(now - slot.started).count();
+            Record(latencyMs, waitMs);
+            auto it = sessions.find(slot.session);
+            slot.session = -1;
+            if (it == sessions.end()) continue;
+            ServerSession& s = it->second;
+            s.engine = -1;
+            s.searches++;
+            s.nodesUsed += r.nodes;
+            ostringstream os;
+            os << "bestmove " << it->first << " ";
+            if (!r.best.from.ok()) os << "(none)";
+            else {
+                os << MoveToUCI(r.best);
+                if (r.ponder.from.ok()) os << " ponder " << MoveToUCI(r.ponder);
+            }
+            os << " score cp " << static_cast<int>(r.score) << " nodes " << r.nodes << " time " << r.timeMs << " wait " << (long long)waitMs;
+            Reply(s.conn, os.str());
+        }
+    }
+};
+#endif
+
+void PrintServerUsage() {
+    cout << "Usage: server [-port P] [-host ADDR] [-unix PATH] [-workers N] [-maxtime MS] [-maxnodes N] [-sessions N]\n"
+            "Serves many games from one process over a line protocol on 127.0.0.1:" << SERVER_DEFAULT_PORT << " (or a Unix socket).\n"
+            "Searches from all sessions are queued by priority and run on N single-threaded workers (default: all\n"
+            "hardware threads) that share one hash table of -hash MB, the opening book and the -tbpath tablebases.\n"
+            "-maxtime caps every search (default 5000 ms) and is the default budget; -maxnodes caps nodes likewise.\n"
+            "Commands (S is a session id; sessions close with their connection):\n"
+            "  new [time MS] [nodes N] [priority P]         -> session S\n"
+            "  position S startpos|fen FEN [moves M...]     -> ok\n"
+            "  move S M...                                  -> ok\n"
+            "  budget S [time MS] [nodes N] [priority P]    -> ok\n"
+            "  go S [movetime MS] [nodes N] [depth D] [priority P]\n"
+            "                                               -> bestmove S MOVE [ponder M] score cp X nodes N time T wait W\n"
+            "  stop S | close S | stats | quit | shutdown" << endl;
+}
+
+int RunServer(int argc, char* argv[]) {
+    ServerOptions opt;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-port" && i + 1 < argc) opt.port = stoi(argv[++i]);
+            else if (a == "-host" && i + 1 < argc) opt.host = argv[++i];
+            else if (a == "-unix" && i + 1 < argc) opt.unixPath = argv[++i];
+            else if (a == "-workers" && i + 1 < argc) opt.workers = max(1, stoi(argv[++i]));
+            else if (a == "-maxtime" && i + 1 < argc) opt.maxTimeMs = max(0, stoi(argv[++i]));
+            else if (a == "-maxnodes" && i + 1 < argc) opt.maxNodes = max(0LL, stoll(argv[++i]));
+            else if (a == "-sessions" && i + 1 < argc) opt.maxSessions = max(1, stoi(argv[++i]));
+            else { PrintServerUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintServerUsage(); return 2; }
+#ifdef _WIN32
+    cout << "Error: The engine server is not supported on this platform." << endl;
+    return 2;
+#else
+    if (opt.workers <= 0) opt.workers = max(1, (int)thread::hardware_concurrency());
+    int listener = opt.unixPath.empty() ? OpenTcpListener(opt.host, opt.port) : OpenUnixListener(opt.unixPath);
+    string where = opt.unixPath.empty() ? opt.host + ":" + to_string(opt.port) : opt.unixPath;
+    if (listener < 0) { cout << "Error: Could not listen on " << where << endl; return 2; }
+    string summary;
+    {
+        EngineServer server(opt, listener);
+        if (!server.Start()) { cout << "Error: Could not start the worker pool." << endl; close(listener); return 2; }
+        cout << "info string Server listening on " << where << ", " << opt.workers << " workers, hash " << ttDefaultSizeMB
+             << " MB, " << openingBook.size() << " book positions" << endl;
+        server.Run();
+        summary = server.Stats();
+    }
+    close(listener);
+    if (!opt.unixPath.empty()) unlink(opt.unixPath.c_str());
+    cout << "info string Server stopped: " << summary.substr(6) << endl;
+    return 0;
+#endif
+}
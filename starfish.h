@@ -0,0 +1,516 @@
+// starfish.h
+//Starfish --- chess engine developed by dsyoier
+//引擎核心库的公共声明：棋盘表示、走子生成、评估、搜索，以及 PGN 读取与命令行工具入口。
+//所有局面/搜索状态都是 thread_local，每个线程可以独立下一盘棋。
+#ifndef STARFISH_H
+#define STARFISH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+// --- 核心定义与数据结构 ---
+const int WHITE = 0;
+const int BLACK = 1;
+const int NONE = 2;
+const int EMPTY_PIECE = 0;
+const int PAWN = 1, KNIGHT = 2, BISHOP = 3, ROOK = 4, QUEEN = 5, KING = 6;
+const int PIECE_TYPE_MASK = 0b0111;
+const int COLOR_MASK = 0b1000;
+const int W_PAWN = PAWN, W_KNIGHT = KNIGHT, W_BISHOP = BISHOP, W_ROOK = ROOK, W_QUEEN = QUEEN, W_KING = KING;
+const int B_PAWN = PAWN | COLOR_MASK, B_KNIGHT = KNIGHT | COLOR_MASK, B_BISHOP = BISHOP | COLOR_MASK, B_ROOK = ROOK | COLOR_MASK, B_QUEEN = QUEEN | COLOR_MASK, B_KING = KING | COLOR_MASK;
+const int WK_CASTLE = 1, WQ_CASTLE = 2, BK_CASTLE = 4, BQ_CASTLE = 8;
+struct Pos {
+    int x, y;
+    Pos(int xx = 0, int yy = 0) : x(xx), y(yy) {}
+    bool ok() const { return x >= 1 && x <= 8 && y >= 1 && y <= 8; }
+    bool operator==(const Pos& other) const { return x == other.x && y == other.y; }
+};
+struct Move {
+    Pos from, to;
+    int promotion = EMPTY_PIECE;
+    bool operator==(const Move& other) const {
+        return from == other.from && to == other.to && promotion == other.promotion;
+    }
+};
+struct UndoInfo {
+    int capturedPiece;
+    Pos enPassantTarget;
+    int castlingRights;
+    int halfmoveClock;
+};
+inline int PieceColorOf(int piece) {
+    if (piece == EMPTY_PIECE) return NONE;
+    return ( (piece & COLOR_MASK) ? BLACK : WHITE );
+}
+
+// --- 全局游戏状态 (每线程一份) ---
+extern thread_local int board[10][10];
+extern thread_local int currentPlayer;
+extern thread_local Pos enPassantTarget;
+extern thread_local int castlingRights;
+extern thread_local int Round;
+extern thread_local int halfmoveClock;
+extern thread_local std::map<std::string, int> positionHistory;
+extern thread_local bool trackPositionHistory;
+extern const std::map<int, char> pieceChar;
+extern const std::map<char, int> charToPiece;
+extern Pos knight_deltas[8], bishop_deltas[4], rook_deltas[4], king_deltas[8];
+extern std::map<std::string, std::string> openingBook;
+extern const char* START_FEN;
+
+// --- 评估参数 (每线程一份，可被参数文件覆盖) ---
+extern thread_local int pieceValue[7];
+extern thread_local int pawn_pst_mg[64], pawn_pst_eg[64], knight_pst_mg[64], knight_pst_eg[64];
+extern thread_local int bishop_pst_mg[64], bishop_pst_eg[64], rook_pst_mg[64], rook_pst_eg[64];
+extern thread_local int queen_pst_mg[64], queen_pst_eg[64], king_pst_mg[64], king_pst_eg[64];
+extern thread_local double DOUBLED_PAWN_PENALTY, ISOLATED_PAWN_PENALTY, PASSED_PAWN_BONUS[8], BISHOP_PAIR_BONUS;
+extern thread_local double ROOK_ON_SEMI_OPEN_FILE_BONUS, ROOK_ON_OPEN_FILE_BONUS, PAWN_SHIELD_PENALTY;
+
+// --- 搜索状态 ---
+struct RootLine {
+    Move move;
+    double score;             // 相对于走子方
+    std::vector<Move> pv;
+};
+struct SearchInfo {           // 一轮迭代完成后的一条主变例
+    int depth = 0;
+    int multipv = 1;          // 名次，从 1 开始
+    double score = 0;         // 相对于走子方
+    long long nodes = 0;
+    int timeMs = 0;
+    int hashfull = 0;
+    std::vector<Move> pv;
+};
+extern thread_local Move searchBestMove;
+extern thread_local double searchBestScore;
+extern thread_local long long computedNodes;
+extern thread_local std::chrono::time_point<std::chrono::high_resolution_clock> searchStartTime;
+extern thread_local int searchTimeLimitMs;
+extern thread_local long long searchNodeLimit;
+extern thread_local int searchMaxDepth;
+extern thread_local bool searchQuiet;
+extern thread_local int searchMultiPV;
+extern thread_local std::vector<RootLine> searchLines;
+extern thread_local const std::atomic<bool>* searchStopFlag;
+extern thread_local std::function<void(const SearchInfo&)> searchInfoCallback;
+extern thread_local bool time_is_up;
+extern thread_local int search_min_depth;
+extern thread_local int iterative_deepening_current_depth;
+
+// --- 局面与走子 ---
+std::string GeneratePositionKey();
+std::string GenerateFEN();
+uint64_t ComputePositionHash();
+void LoadOpeningBook();
+void ResetPositionHistory();
+void SetBoard();
+void LoadFEN(const std::string& fen);
+bool IsSquareAttacked(Pos p, int attackerCamp);
+void GenerateMoves(std::vector<Move>& moves, bool capturesOnly = false);
+UndoInfo MakeMove(const Move& move);
+void UnmakeMove(const Move& move, const UndoInfo& undo);
+Pos FindKing(int color);
+void GenerateLegalMoves(std::vector<Move>& legal_moves);
+bool IsInCheck();
+bool IsInsufficientMaterial();
+
+// --- Zobrist 键 (固定种子) ---
+extern uint64_t zobristPiece[16][64];
+extern uint64_t zobristCastling[16];
+extern uint64_t zobristEnPassant[9];
+extern uint64_t zobristSide;
+
+// --- 置换表：进程私有内存、POSIX 共享内存或内存映射文件；无锁，每个条目自带校验 ---
+enum TTBound { TT_NONE = 0, TT_UPPER = 1, TT_LOWER = 2, TT_EXACT = 3 };
+struct TTData {
+    Move move;            // 无着法时 from 为 (0,0)
+    double score;         // 将杀分已换算为相对本节点
+    int depth;
+    int bound;
+};
+struct TTEntry { std::atomic<uint64_t> check, score, meta; };   // check = key ^ score ^ meta，读到撕裂的条目时校验失败
+struct TTExport { uint64_t key, score, meta; };                  // 与条目相同的编码，meta 不含代 (分布式搜索共享条目用)
+struct TTFileHeader;
+struct TranspositionTable {
+    TTEntry* entries = nullptr;
+    uint64_t count = 0;
+    uint8_t generation = 0;
+    TTFileHeader* header = nullptr;   // 共享/文件模式下映射区起始处的头部
+    size_t mappedBytes = 0;
+    size_t ownedBytes = 0;            // 私有模式下大页映射的长度
+    int fd = -1;
+    bool ownsMemory = false;
+    std::string source;               // 共享内存名或文件路径
+    std::vector<TTExport>* exportLog = nullptr;   // 非空时记录深度不低于 exportMinDepth 的写入
+    int exportMinDepth = 0;
+
+    TranspositionTable() {}
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+    ~TranspositionTable() { Detach(); }
+    bool Allocate(size_t mb);
+    bool AttachShared(const std::string& name, size_t mb);
+    bool AttachFile(const std::string& path, size_t mb);
+    void Detach();
+    void Clear();
+    void NewSearch() { generation++; }
+    bool Probe(uint64_t key, TTData& out) const;
+    void Store(uint64_t key, const Move& move, double score, int depth, int bound);
+    void Import(const TTExport& x);   // 本代中已有同等或更深的条目时保留本地的
+    int Hashfull() const;
+private:
+    bool AttachMapped(const std::string& what, size_t mb);
+};
+extern size_t ttDefaultSizeMB;
+TranspositionTable& ThreadTT();                  // 未设置时按 ttDefaultSizeMB 惰性分配本线程私有表
+void SetThreadTT(TranspositionTable* table);     // nullptr 恢复为私有表
+bool ParseHashOption(const std::string& option, const std::string& value);   // -hash MB / -hashshm NAME / -hashfile PATH
+bool AttachMainThreadTT(TranspositionTable& table);                          // 按 -hashshm / -hashfile 挂接共享表
+
+// --- 大页与 NUMA (numa.cpp)：大表优先用大页并按节点并行首次触碰，搜索线程按节点轮流绑核 ---
+void* AllocateLargePages(size_t bytes, size_t& mappedBytes);   // 内容为零；失败返回 nullptr
+void FreeLargePages(void* p, size_t mappedBytes);
+void ParallelByNode(size_t bytes, const std::function<void(size_t, size_t)>& fill);   // 小于 64 MB 时在调用线程上完成
+void ReportLargeTable(const char* what, const void* p, size_t bytes);                  // 进程内只报告第一次：实际得到的页大小
+int NumaNodeCount();
+bool ParseNumaOption(const std::string& option, const std::string& value);            // -bind on|off|auto (auto：多节点时绑定)
+void BindSearchThread(int index);
+
+// --- 残局知识 (endgame.cpp)：KPK 位库与按子力签名登记的专用评估/缩放函数 ---
+typedef double (*EndgameEvalFn)(int strongSide);    // 白方视角的完整评估，取代常规评估
+typedef double (*EndgameScaleFn)(int strongSide);   // 乘在常规评估上的系数 (0..1)
+struct EndgameEntry {
+    uint64_t key = 0;
+    EndgameEvalFn evaluate = nullptr;
+    EndgameScaleFn scale = nullptr;
+    int strong = WHITE;
+};
+uint64_t MaterialKey(const int counts[16]);              // counts 以棋子编码为下标
+const EndgameEntry* ProbeEndgame(uint64_t materialKey);  // 未登记的子力签名返回 nullptr
+bool ProbeKPK(int strongSide, int sideToMove, Pos strongKing, Pos pawn, Pos weakKing);   // true = 强方必胜
+
+// --- DTM 残局库 (tablebase.cpp)：tbgen 生成，-tbpath 目录载入后只读，可被任意线程探查 ---
+struct TBProbe {
+    int wdl = 0;              // 相对于走子方：1 胜，0 和，-1 负
+    int plies = 0;            // 距将杀的半步数
+};
+const double TB_WIN_SCORE = 1e8;                   // 低于将杀分的区间，减去距根与距将杀的半步数
+extern int tablebaseMaxPieces;                     // 已载入表的最大子数，0 表示没有载入任何表
+bool LoadTablebases(const std::string& dir);
+bool ProbeTablebase(TBProbe& out);                 // 读调用线程的全局局面；有易位权、过路兵格或没有对应的表时返回 false
+
+// --- 评估与搜索 ---
+double GetPSTValue(int piece, int x, int y);
+double EvaluatePositional();
+double Evaluate();
+double CachedEvaluate(uint64_t hash);              // hash 为 ComputePositionHash()；命中每线程评估缓存时不重新评估
+void ClearEvalCache();
+struct EvalCacheEntry { uint64_t key; double score; };
+void SwapEvalCache(std::unique_ptr<EvalCacheEntry[]>& other);   // 与本线程的评估缓存互换 (参数不同的多组评估各留一张)
+extern thread_local bool evalCacheEnabled;
+extern thread_local long long evalCacheProbes, evalCacheHits;
+double LazyEvaluate(uint64_t hash, double lo, double hi);   // 白方视角；结果 >= hi 或 <= lo 时可能只是同侧的界，否则精确
+extern thread_local bool lazyEvalEnabled;
+extern thread_local long long lazyEvalCalls, lazyEvalExits[2];   // 在子力层、兵型层之后提前结束的次数
+double QuiescenceSearch(double alpha, double beta);
+void SearchBestMove(int min_depth);
+// 分布式搜索的工作单元：在调用线程的全局局面上搜索根着法 m 的子树，深度与窗口同 SearchBestMove 的根着法循环
+// (first 为 false 时先以零窗口证明不优于 alpha)；不受时间与节点上限影响，pv 以 m 开头
+double SearchRootMove(const Move& m, int depth, double alpha, double beta, bool first, std::vector<Move>& pv);
+double SearchFixedDepth(int depth);                // 调用线程全局局面上的一次固定深度全窗口搜索 (不迭代加深、不受上限影响)，相对走子方
+
+// --- 着法文本与界面 ---
+Move parse_uci_move(const std::string& uci_str);
+void PrintBoard();
+Move ParseAlgebraicMove(const std::string& san_str, const std::vector<Move>& legal_moves);
+std::string MoveToUCI(const Move& m);
+std::string MoveToSAN(const Move& m, const std::vector<Move>& legal_moves);
+std::string FormatLineSAN(const RootLine& line);
+
+// --- 评估参数表 ---
+struct EvalParamRef { const char* name; int* ivals; double* dvals; int count; };
+typedef std::vector<double> ParamSet;
+std::vector<EvalParamRef> EvalParamRefs();
+ParamSet CaptureEvalParams();
+void ApplyEvalParams(const ParamSet& p);
+bool LoadEvalParamFile(const std::string& filename, const ParamSet& base, ParamSet& out);
+
+// --- 搜索统计与性能剖析 (编译开关见 CMakeLists.txt) ---
+#ifdef STARFISH_STATS
+extern std::ostream* statsJson;
+void ResetGameStats();
+void ReportGameStats(const std::string& game);
+void GameHashStats(long long& probes, long long& hits);   // 本线程自 ResetGameStats 以来的置换表探测与命中次数
+#endif
+#ifdef STARFISH_PROFILE
+void ResetProfile();
+void PrintProfile(long long nodes);
+#endif
+
+// --- 搜索树跟踪 (trace.cpp)：searchTrace 非空时每个节点退出时写一条记录，成批流式写入文件；trace 命令录制与查询 ---
+enum TraceNodeType : uint8_t { TRACE_PV, TRACE_NONPV, TRACE_QS };
+enum TraceReason : uint8_t {
+    TRACE_EXACT, TRACE_FAIL_LOW, TRACE_BETA_CUTOFF, TRACE_HASH_CUTOFF, TRACE_REPETITION, TRACE_TABLEBASE,
+    TRACE_CHECKMATE, TRACE_STALEMATE, TRACE_STAND_PAT, TRACE_QS_CUTOFF, TRACE_QS_DONE, TRACE_ABORTED
+};
+struct TraceRecord {                 // 40 字节，按节点退出的顺序 (后序) 写出
+    double alpha, beta, score;       // 进入时的窗口与返回值，均相对于本节点的行棋方
+    uint32_t id, parent;             // 节点按进入顺序从 1 编号；根着法节点的 parent 为 0
+    uint16_t move;                   // 走到本节点的着法：from | to << 6 | 升变子类型 << 12，格子 a1 = 0
+    uint8_t ply, depth, iteration, type, reason, searched;   // searched：已搜索的子节点数，截断时即截断着法的序号
+};
+class SearchTrace {
+public:
+    int maxPly = 255;                // 只记录 ply 不超过此值的节点
+    int onlyIteration = 0;           // 非 0 时只记录这一轮迭代
+    uint16_t onlyRootMove = 0;       // 非 0 时只记录这个根着法的子树
+    long long written = 0;
+
+    SearchTrace() {}
+    SearchTrace(const SearchTrace&) = delete;
+    SearchTrace& operator=(const SearchTrace&) = delete;
+    ~SearchTrace() { Close(); }
+    bool Open(const std::string& path, const std::string& fen);
+    void Close();
+    static uint16_t Pack(const Move& m) {
+        return (uint16_t)(((m.from.y - 1) * 8 + m.from.x - 1) | (((m.to.y - 1) * 8 + m.to.x - 1) << 6) | ((m.promotion & PIECE_TYPE_MASK) << 12));
+    }
+    void SetMove(const Move& m) { nextMove = Pack(m); }   // 父节点在递归之前设置
+    void Enter(int type, int depth, double alpha, double beta);
+    void Drop() { top--; }                                // 撤销 Enter 而不记录 (转入同一层的静态搜索)
+    void Leave(int reason, double score, int searched);
+private:
+    struct Frame { double alpha, beta; uint32_t id; uint16_t move; uint8_t depth, type; bool record; };
+    Frame stack[1024];
+    int top = 0;
+    uint32_t nextId = 0;
+    uint16_t nextMove = 0;
+    std::vector<TraceRecord> buffer;
+    FILE* file = nullptr;
+    void Flush();
+};
+extern thread_local SearchTrace* searchTrace;
+inline double Traced(double score, int reason, int searched = 0) {
+    if (searchTrace) searchTrace->Leave(reason, score, searched);
+    return score;
+}
+
+// --- 可嵌入接口：局面与引擎对象 (C 接口见 starfish_c.h) ---
+// Position 是自包含的值对象，不读写任何线程的全局局面；Engine 在自己的工作线程上搜索，
+// 因为全部搜索状态都是 thread_local，同一进程内的多个 Engine 互不干扰。
+class Position {
+public:
+    Position();                                        // 初始局面
+    bool SetFEN(const std::string& fen);               // FEN 不合法时返回 false，局面不变
+    bool Play(const std::string& uciMove);             // 着法不合法时返回 false，局面不变
+    bool Play(const Move& move);
+    std::string FEN() const;
+    std::vector<Move> LegalMoves() const;
+    int SideToMove() const { return side; }
+    void Load() const;                                 // 载入调用线程的全局局面 (含重复局面历史)
+    void Capture();                                    // 从调用线程的全局局面读取
+private:
+    bool Parse(const std::string& fen);
+    int squares[10][10];
+    int side, castling, halfmove, fullmove;
+    Pos ep;
+    std::map<std::string, int> history;                // 为空表示只有当前局面出现过一次
+};
+struct SearchLimits {
+    int depth = 0;            // 最大深度，0 = 不限 (直到 Stop 或其它上限)
+    int minDepth = 2;         // 完成此深度之前不检查时间与节点上限
+    int timeMs = 0;           // 0 = 不限
+    long long nodes = 0;      // 0 = 不限
+    int multiPV = 1;
+    int mate = 0;             // >0 时改为求 mate 步内的最短强制杀 (df-pn)；无解时 best 为空
+};
+struct SearchResult {
+    Move best;                // 无合法着法时 from 为 (0,0)
+    Move ponder;              // 主变例第二步，可能为空
+    double score = 0;         // 相对于走子方
+    long long nodes = 0;
+    int timeMs = 0;
+    std::vector<RootLine> lines;
+};
+typedef std::function<void(const SearchInfo&)> InfoCallback;
+typedef std::function<void(const SearchResult&)> BestMoveCallback;
+class Engine {
+public:
+    explicit Engine(size_t hashMB = 0, TranspositionTable* sharedTable = nullptr);   // 0 = ttDefaultSizeMB；sharedTable 非空时不另建置换表
+    ~Engine();                                         // 停止搜索并结束工作线程
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+    void SetPosition(const Position& position);
+    Position GetPosition() const;
+    // 异步搜索：回调在工作线程上执行，回调内不要调用本对象的方法。正在进行的搜索会先被停止。
+    void Go(const SearchLimits& limits, InfoCallback onInfo = nullptr, BestMoveCallback onBestMove = nullptr);
+    void Stop();
+    void Wait();                                       // 等待已提交的搜索与任务全部完成
+    SearchResult Search(const SearchLimits& limits, InfoCallback onInfo = nullptr);   // 同步搜索
+    SearchResult LastResult() const;
+    void Run(const std::function<void()>& task);       // 在工作线程上同步执行 (访问该线程的评估参数、统计等)
+private:
+    struct Impl;
+    Impl* impl;
+};
+
+// --- 将杀求解 (df-pn，见 mate.cpp) ---
+enum MateStatus { MATE_UNKNOWN = 0, MATE_FOUND = 1, MATE_NONE = 2 };
+struct MateResult {
+    int status = MATE_UNKNOWN;   // MATE_NONE 表示已证明 maxMoves 步内没有每步都将军的强制杀
+    int moves = 0;               // 最短将杀步数
+    std::vector<Move> line;      // 双方最佳应对下的完整将杀线
+    long long nodes = 0;
+    int timeMs = 0;
+};
+// threads <= 0 使用全部硬件线程；nodeLimit 0 = 不限；onLevel(步数, 累计节点, 毫秒) 在每一步数求解完成后调用
+MateResult SolveMate(const Position& pos, int maxMoves, int threads, long long nodeLimit, size_t hashMB,
+                     const std::atomic<bool>* stop = nullptr, const std::function<void(int, long long, int)>& onLevel = nullptr);
+
+// --- 蒙特卡洛树搜索 (mcts.cpp)：PUCT 选择加虚拟损失，多个线程无锁地共享一棵树 ---
+// 节点取自固定上限的节点池 (分两个半区)；新局面能由上一次的根在两步之内到达时，保留的子树复制到另一个半区继续使用。
+struct MctsLimits {
+    int threads = 1;
+    int timeMs = 0;              // 0 = 不限
+    long long playouts = 0;      // 0 = 不限；两者都为 0 时做 10000 次
+    int leafDepth = 0;           // 叶子估值：-1 静态评估，0 静止搜索，>0 该深度的 alpha-beta
+    double cpuct = 1.5;
+};
+struct MctsResult {
+    Move best;                   // 无合法着法时 from 为 (0,0)
+    double score = 0;            // 最佳着法的平均值换算回的分数，相对于走子方
+    long long playouts = 0;
+    long long nodes = 0;         // 叶子估值所搜索的节点
+    long long reusedVisits = 0;  // 换根后从上一棵树继承的访问次数
+    size_t treeNodes = 0;
+    int timeMs = 0;
+    std::vector<Move> pv;        // 沿访问次数最多的子节点
+};
+class MctsSearch {
+public:
+    explicit MctsSearch(size_t memMB = 256);
+    ~MctsSearch();
+    MctsSearch(const MctsSearch&) = delete;
+    MctsSearch& operator=(const MctsSearch&) = delete;
+    MctsResult Search(const Position& position, const MctsLimits& limits, const std::atomic<bool>* stop = nullptr);
+    void Clear();
+private:
+    struct Impl;
+    Impl* impl;
+};
+
+// --- 多线程搜索 (scalebench.cpp)：N 个线程共用一张置换表各自迭代加深同一局面，首个搜完 depth 的线程停止其余线程 ---
+struct ThreadedSearchResult {
+    Move best;                        // 首个完成者的结果
+    double score = 0;                 // 相对于走子方
+    double ms = 0;                    // 首个完成者的用时
+    std::vector<double> depthMs;      // 下标为深度：任一线程最早完成该深度迭代的用时，未完成为 0
+    long long nodes = 0;              // 全部线程之和
+    long long ttProbes = 0, ttHits = 0;   // 只在 -DSTARFISH_STATS 构建中统计，否则为 0
+};
+ThreadedSearchResult SearchWithThreads(const Position& position, int threads, int depth, TranspositionTable& table);
+extern const char* BENCH_POSITIONS[];   // bench.cpp 的固定局面集
+extern const int BENCH_POSITION_COUNT;
+
+// --- 训练数据 (gensfen.cpp)：自对弈局面打包成 32 字节定长记录，文件可按块压缩；SfenReader 流式读取多个文件并可打乱 ---
+struct PackedSfen {
+    uint64_t occupied;        // 占用格的位图，格子 a1 = bit 0
+    uint8_t pieces[16];       // 按格子顺序每个占用格 4 位 (先低半字节)：子类型 | 黑方 8
+    uint16_t state;           // 走子方 1 位 | 易位权 4 位 | 吃过路兵的列 4 位 (0 = 无) | 五十步计数 7 位
+    int16_t score;            // 固定节点搜索的分数，相对于走子方，截断到 ±SFEN_SCORE_LIMIT
+    uint16_t ply;             // 从初始局面起的半回合数 (由 FEN 的回合数换算)
+    int8_t result;            // 终局结果，相对于走子方：1 胜、0 和、-1 负
+    uint8_t flags;            // SFEN_* 标志
+};
+static_assert(sizeof(PackedSfen) == 32, "PackedSfen must stay 32 bytes");
+const int SFEN_SCORE_LIMIT = 32000;
+const uint8_t SFEN_GAME_END = 1, SFEN_IN_CHECK = 2, SFEN_NOISY = 4;   // 本局最后一条；走子方被将军；最佳着法是吃子或升变
+bool PackSfen(PackedSfen& out);                  // 打包调用线程的全局局面 (分数、结果与标志由调用者填写)；超过 32 个棋子时返回 false
+std::string SfenToFEN(const PackedSfen& s);
+bool IsSfenFile(const std::string& path);
+bool LoadMatchOpenings(const std::string& source, int bookDepth, std::vector<std::string>& openings);   // match.cpp：开局库 ("book") 或 EPD 文件
+class SfenReader {
+public:
+    SfenReader();
+    ~SfenReader();
+    SfenReader(const SfenReader&) = delete;
+    SfenReader& operator=(const SfenReader&) = delete;
+    // shuffle > 0 时维护这么多条记录的缓冲区，每次从随机选中的文件读入一块，再随机取出一条；同一种子下顺序固定
+    bool Open(const std::vector<std::string>& paths, size_t shuffle = 0, uint64_t seed = 1);
+    bool Next(PackedSfen& s);
+private:
+    struct Impl;
+    Impl* impl;
+};
+
+// --- 前端共用的人机对弈界面 (sharedTable 为 -hashshm / -hashfile 挂接的表，可为空) ---
+int RunInteractive(TranspositionTable* sharedTable);
+
+// --- PGN 流式读取 ---
+struct TextSpan {
+    const char* ptr = nullptr;
+    size_t len = 0;
+    std::string str() const { return std::string(ptr, len); }
+    bool equals(const char* s) const;
+};
+struct PgnGame {
+    std::vector<std::pair<TextSpan, TextSpan>> tags;   // 标签值保留原始转义 (\" 与 \\)
+    TextSpan movetext;
+    size_t offset = 0;                                 // 本局在文件中的字节偏移
+    TextSpan Tag(const char* name) const;
+    std::string TagValue(const char* name) const;
+};
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool Open(const std::string& path);
+    ~MappedFile();
+};
+struct PgnReader {
+    const char* p;
+    const char* end;
+    const char* base;
+    PgnReader(const char* begin, const char* finish, const char* file_base) : p(begin), end(finish), base(file_base) {}
+    bool NextGame(PgnGame& game);
+};
+bool NextSanToken(const char*& p, const char* end, TextSpan& token);
+bool ApplySanMove(const TextSpan& san, Move* applied = nullptr);
+void LoadPgnStartPosition(const PgnGame& game);
+bool ReplayPgnGame(const PgnGame& game, const std::function<void(const TextSpan&, const Move&)>& visit, TextSpan* failed = nullptr);
+void ForEachPgnGame(const MappedFile& file, int threads, const std::function<void(const PgnGame&, int)>& visit);
+bool LoadPGN(const std::string& filename);
+
+// --- 命令行工具 (argv 不含命令名本身) ---
+int RunMatch(int argc, char* argv[]);
+int RunTune(int argc, char* argv[]);
+int RunPgnScan(int argc, char* argv[]);
+int RunIndex(int argc, char* argv[]);
+int RunProfile(int argc, char* argv[]);
+int RunBench(int argc, char* argv[]);
+int RunAnalyze(int argc, char* argv[]);
+int RunMate(int argc, char* argv[]);
+int RunTbGen(int argc, char* argv[]);
+int RunCluster(int argc, char* argv[]);
+int RunMcts(int argc, char* argv[]);
+int RunScaleBench(int argc, char* argv[]);
+int RunServer(int argc, char* argv[]);
+int RunTrace(int argc, char* argv[]);
+int RunGenSfen(int argc, char* argv[]);
+
+#endif
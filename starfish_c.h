@@ -0,0 +1,60 @@
+/* starfish_c.h
+ * Starfish --- chess engine developed by dsyoier
+ * C 接口：在宿主进程内创建任意多个相互独立的引擎实例。
+ * 每个实例有自己的工作线程与置换表；回调在该工作线程上执行，回调内不要调用同一实例的函数。
+ */
+#ifndef STARFISH_C_H
+#define STARFISH_C_H
+
+#if defined(_WIN32)
+#define SF_API
+#else
+#define SF_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sf_engine sf_engine;
+
+typedef struct sf_limits {
+    int depth;          /* 最大深度，0 = 不限 */
+    int time_ms;        /* 0 = 不限 */
+    long long nodes;    /* 0 = 不限 */
+    int multipv;        /* <= 1 表示单主变例 */
+    int mate;           /* > 0 时求 mate 步内的最短强制杀 (证明数搜索)；无解时 bestmove 为 "(none)" */
+} sf_limits;
+
+typedef struct sf_info {
+    int depth;
+    int multipv;        /* 名次，从 1 开始 */
+    int score_cp;       /* 相对于走子方；mate 非 0 时无意义 */
+    int mate;           /* 正数为 N 步内将死对方，负数为 N 步内被将死，0 为非将杀分 */
+    long long nodes;
+    int time_ms;
+    int hashfull;       /* 千分比 */
+    const char* pv;     /* 空格分隔的 UCI 着法，仅在回调期间有效 */
+} sf_info;
+
+typedef void (*sf_info_callback)(const sf_info* info, void* user);
+/* bestmove 为 UCI 着法，无合法着法时为 "(none)"；ponder 可能为空串 */
+typedef void (*sf_bestmove_callback)(const char* bestmove, const char* ponder, void* user);
+
+/* hash_mb <= 0 时使用默认大小；失败返回 NULL */
+SF_API sf_engine* sf_engine_new(int hash_mb);
+SF_API void sf_engine_free(sf_engine* engine);
+/* fen 为 NULL 或 "startpos" 表示初始局面；moves 为 NULL 或空格分隔的 UCI 着法。
+ * 返回 0 成功，-1 FEN 不合法，-2 着法不合法；失败时局面不变 */
+SF_API int sf_engine_set_position(sf_engine* engine, const char* fen, const char* moves);
+/* 异步开始搜索 (正在进行的搜索会先被停止)；limits 可为 NULL 表示无限搜索直到 sf_engine_stop */
+SF_API int sf_engine_go(sf_engine* engine, const sf_limits* limits, sf_info_callback on_info, sf_bestmove_callback on_bestmove, void* user);
+SF_API void sf_engine_stop(sf_engine* engine);
+/* 阻塞直到搜索结束且 bestmove 回调已返回 */
+SF_API void sf_engine_wait(sf_engine* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,750 @@
+// tablebase.cpp
+//Starfish --- chess engine developed by dsyoier
+//DTM 残局库 (最多 5 子)：tbgen 命令用多线程逆推分析生成，引擎以 -tbpath 目录载入后在搜索中探查。
+//局面按对称性约化后的完美下标编号 (无兵表 8 重对称、有兵表左右对称)，每个条目 1 或 2 字节；
+//文件按块做游程压缩并整体内存映射，探查时只解码一个块。易位与吃过路兵不在表内：有易位权或过路兵格的局面不探查。
+#include "starfish.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+const int TB_MAX_PIECES = 5;
+const uint64_t TB_NO_INDEX = ~0ULL;
+int tablebaseMaxPieces = 0;
+
+// --- 方格与对称变换：方格 = 列 + 8 * 行 (0..63，a1 = 0) ---
+const int TB_KNIGHT_STEPS[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+const int TB_DIRS[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};   // 前 4 个直线，后 4 个斜线
+
+inline int TBSquare(int f, int r) { return (f < 0 || f > 7 || r < 0 || r > 7) ? -1 : f + 8 * r; }
+inline int TBDistance(int a, int b) { return max(abs((a & 7) - (b & 7)), abs((a >> 3) - (b >> 3))); }
+inline bool OnDiagonal(int s) { return (s & 7) == (s >> 3); }
+// t 的位：1 左右翻转，2 上下翻转，4 沿 a1-h8 对角线翻转
+inline int TransformSquare(int s, int t) {
+    if (t & 1) s ^= 7;
+    if (t & 2) s ^= 56;
+    if (t & 4) s = ((s & 7) << 3) | (s >> 3);
+    return s;
+}
+
+// 两王的规范位置：无兵时白王在 a1-d1-d4 三角内、白王在对角线上时黑王不在对角线上方 (共 462 对)；有兵时白王在 a-d 线
+struct KingPairs {
+    int index[2][64][64];
+    vector<pair<int, int>> pairs[2];
+    static bool Canonical(int pawns, int wk, int bk) {
+        if (pawns) return (wk & 7) <= 3;
+        int f = wk & 7, r = wk >> 3;
+        if (f > 3 || r > f) return false;
+        return r != f || (bk >> 3) <= (bk & 7);
+    }
+    KingPairs() {
+        for (int pawns = 0; pawns < 2; ++pawns)
+            for (int wk = 0; wk < 64; ++wk) for (int bk = 0; bk < 64; ++bk) {
+                index[pawns][wk][bk] = -1;
+                if (TBDistance(wk, bk) <= 1 || !Canonical(pawns, wk, bk)) continue;
+                index[pawns][wk][bk] = (int)pairs[pawns].size();
+                pairs[pawns].push_back(make_pair(wk, bk));
+            }
+    }
+} kingPairs;
+
+// --- 子力签名：如 "KRPvKR"，每方按 K Q R B N P 排列，子力价值大的一方在前 ---
+const char* TB_LETTERS = "PNBRQK";
+const int TB_VALUES[7] = {0, 1, 3, 3, 5, 9, 0};
+
+string SideSignature(const int counts[16], int color) {
+    string s = "K";
+    for (int t = QUEEN; t >= PAWN; --t) s += string(counts[t | (color * COLOR_MASK)], TB_LETTERS[t - 1]);
+    return s;
+}
+int SideValue(const int counts[16], int color) {
+    int v = 0;
+    for (int t = PAWN; t <= QUEEN; ++t) v += counts[t | (color * COLOR_MASK)] * TB_VALUES[t];
+    return v;
+}
+// flipped 为真表示表中的白方对应实际的黑方
+string CanonicalSignature(const int counts[16], bool* flipped = nullptr) {
+    string w = SideSignature(counts, WHITE), b = SideSignature(counts, BLACK);
+    bool flip = make_pair(SideValue(counts, BLACK), b) > make_pair(SideValue(counts, WHITE), w);
+    if (flipped) *flipped = flip;
+    return flip ? b + "v" + w : w + "v" + b;
+}
+bool ParseSignature(const string& sig, int counts[16]) {
+    fill(counts, counts + 16, 0);
+    size_t split = sig.find('v');
+    if (split == string::npos || split == 0 || sig[0] != 'K' || split + 1 >= sig.size() || sig[split + 1] != 'K') return false;
+    int total = 0;
+    for (size_t i = 0; i < sig.size(); ++i) {
+        if (i == split) continue;
+        const char* p = strchr(TB_LETTERS, sig[i]);
+        if (!p || !*p) return false;
+        int type = (int)(p - TB_LETTERS) + 1;
+        if (type == KING && i != 0 && i != split + 1) return false;
+        counts[type | ((i > split) ? COLOR_MASK : 0)]++;
+        total++;
+    }
+    return total <= TB_MAX_PIECES;
+}
+
+// --- 下标布局：两王合占一个规范对编号，其余每子 64 格 (兵 48 格)；同种子各占一个槽位 ---
+struct TBLayout {
+    string name;
+    vector<int> pieces;            // 槽位顺序：白王、黑王、白方其余、黑方其余
+    int pawns = 0;
+    uint64_t entries = 0;          // 每个走子方的条目数
+    vector<uint64_t> stride;
+
+    bool Init(const string& signature) {
+        int counts[16];
+        if (!ParseSignature(signature, counts) || CanonicalSignature(counts) != signature) return false;
+        name = signature;
+        pieces.assign(1, W_KING);
+        pieces.push_back(B_KING);
+        size_t split = signature.find('v');
+        for (size_t i = 1; i < signature.size(); ++i) {
+            if (i == split || i == split + 1) continue;
+            int type = (int)(strchr(TB_LETTERS, signature[i]) - TB_LETTERS) + 1;
+            pieces.push_back(type | (i > split ? COLOR_MASK : 0));
+            if (type == PAWN) pawns = 1;
+        }
+        stride.assign(pieces.size(), 1);
+        for (size_t i = pieces.size(); i-- > 2;) stride[i - 1] = stride[i] * SlotSize(i);
+        stride[0] = stride[1];
+        entries = stride[0] * kingPairs.pairs[pawns].size();
+        return true;
+    }
+    uint64_t SlotSize(size_t i) const { return (pieces[i] & PIECE_TYPE_MASK) == PAWN ? 48 : 64; }
+    uint64_t EncodeWith(const int* sq, int t) const {
+        int kk = kingPairs.index[pawns][TransformSquare(sq[0], t)][TransformSquare(sq[1], t)];
+        if (kk < 0) return TB_NO_INDEX;
+        uint64_t idx = (uint64_t)kk * stride[0];
+        for (size_t i = 2; i < pieces.size(); ++i) {
+            int s = TransformSquare(sq[i], t);
+            if ((pieces[i] & PIECE_TYPE_MASK) == PAWN) {
+                if (s < 8 || s >= 56) return TB_NO_INDEX;
+                s -= 8;
+            }
+            idx += s * stride[i];
+        }
+        return idx;
+    }
+    // 两王都在对角线上时有两个变换可用，取下标小的一个，使同一局面的所有对称像得到同一个下标
+    uint64_t Encode(const int* sq) const {
+        for (int t = 0; t < (pawns ? 2 : 8); ++t) {
+            int wk = TransformSquare(sq[0], t), bk = TransformSquare(sq[1], t);
+            if (!KingPairs::Canonical(pawns, wk, bk)) continue;
+            uint64_t idx = EncodeWith(sq, t);
+            if (!pawns && OnDiagonal(wk) && OnDiagonal(bk)) idx = min(idx, EncodeWith(sq, t | 4));
+            return idx;
+        }
+        return TB_NO_INDEX;
+    }
+    // 棋子重叠时返回 false
+    bool Decode(uint64_t idx, int* sq) const {
+        const pair<int, int>& kk = kingPairs.pairs[pawns][idx / stride[0]];
+        sq[0] = kk.first; sq[1] = kk.second;
+        uint64_t occupied = (1ULL << sq[0]) | (1ULL << sq[1]);
+        idx %= stride[0];
+        for (size_t i = 2; i < pieces.size(); ++i) {
+            sq[i] = (int)(idx / stride[i]);
+            idx %= stride[i];
+            if ((pieces[i] & PIECE_TYPE_MASK) == PAWN) sq[i] += 8;
+            if (occupied & (1ULL << sq[i])) return false;
+            occupied |= 1ULL << sq[i];
+        }
+        return true;
+    }
+};
+
+// --- 简化的走子：board 为 64 格的棋子编码，不含易位与吃过路兵 ---
+bool TBAttacked(const int* board, int s, int by) {
+    int f = s & 7, r = s >> 3;
+    for (int df = -1; df <= 1; df += 2) {
+        int a = TBSquare(f + df, r - (by == WHITE ? 1 : -1));
+        if (a >= 0 && board[a] == (PAWN | (by * COLOR_MASK))) return true;
+    }
+    for (int i = 0; i < 8; ++i) {
+        int a = TBSquare(f + TB_KNIGHT_STEPS[i][0], r + TB_KNIGHT_STEPS[i][1]);
+        if (a >= 0 && board[a] == (KNIGHT | (by * COLOR_MASK))) return true;
+        a = TBSquare(f + TB_DIRS[i][0], r + TB_DIRS[i][1]);
+        if (a >= 0 && board[a] == (KING | (by * COLOR_MASK))) return true;
+    }
+    for (int d = 0; d < 8; ++d) {
+        for (int k = 1;; ++k) {
+            int a = TBSquare(f + TB_DIRS[d][0] * k, r + TB_DIRS[d][1] * k);
+            if (a < 0) break;
+            int p = board[a];
+            if (p == EMPTY_PIECE) continue;
+            int type = p & PIECE_TYPE_MASK;
+            if (PieceColorOf(p) == by && (type == QUEEN || type == (d < 4 ? ROOK : BISHOP))) return true;
+            break;
+        }
+    }
+    return false;
+}
+
+// 伪合法着法的目标格 (吃子或空格)
+template <class F> void ForEachTarget(const int* board, int from, int code, F visit) {
+    int color = PieceColorOf(code), type = code & PIECE_TYPE_MASK, f = from & 7, r = from >> 3;
+    auto enemy = [&](int s) { return board[s] != EMPTY_PIECE && PieceColorOf(board[s]) != color; };
+    if (type == PAWN) {
+        int dir = (color == WHITE) ? 1 : -1;
+        int s = TBSquare(f, r + dir);
+        if (board[s] == EMPTY_PIECE) {
+            visit(s);
+            if (r == (color == WHITE ? 1 : 6) && board[s + 8 * dir] == EMPTY_PIECE) visit(s + 8 * dir);
+        }
+        for (int df = -1; df <= 1; df += 2) {
+            s = TBSquare(f + df, r + dir);
+            if (s >= 0 && enemy(s)) visit(s);
+        }
+        return;
+    }
+    if (type == KNIGHT || type == KING) {
+        const int (*steps)[2] = (type == KNIGHT) ? TB_KNIGHT_STEPS : TB_DIRS;
+        for (int i = 0; i < 8; ++i) {
+            int s = TBSquare(f + steps[i][0], r + steps[i][1]);
+            if (s >= 0 && (board[s] == EMPTY_PIECE || enemy(s))) visit(s);
+        }
+        return;
+    }
+    for (int d = (type == BISHOP ? 4 : 0); d < (type == ROOK ? 4 : 8); ++d) {
+        for (int k = 1;; ++k) {
+            int s = TBSquare(f + TB_DIRS[d][0] * k, r + TB_DIRS[d][1] * k);
+            if (s < 0) break;
+            if (board[s] != EMPTY_PIECE) { if (enemy(s)) visit(s); break; }
+            visit(s);
+        }
+    }
+}
+
+// 逆着法：停在 to 的子可能来自的空格 (不含吃子与升变，这两种着法离开本表)
+template <class F> void ForEachOrigin(const int* board, int to, int code, F visit) {
+    int color = PieceColorOf(code), type = code & PIECE_TYPE_MASK, f = to & 7, r = to >> 3;
+    if (type == PAWN) {
+        int dir = (color == WHITE) ? 1 : -1;
+        int s = TBSquare(f, r - dir);
+        if ((s >> 3) < 1 || (s >> 3) > 6 || board[s] != EMPTY_PIECE) return;
+        visit(s);
+        if (r == (color == WHITE ? 3 : 4) && board[s - 8 * dir] == EMPTY_PIECE) visit(s - 8 * dir);
+        return;
+    }
+    if (type == KNIGHT || type == KING) {
+        const int (*steps)[2] = (type == KNIGHT) ? TB_KNIGHT_STEPS : TB_DIRS;
+        for (int i = 0; i < 8; ++i) {
+            int s = TBSquare(f + steps[i][0], r + steps[i][1]);
+            if (s >= 0 && board[s] == EMPTY_PIECE) visit(s);
+        }
+        return;
+    }
+    for (int d = (type == BISHOP ? 4 : 0); d < (type == ROOK ? 4 : 8); ++d) {
+        for (int k = 1;; ++k) {
+            int s = TBSquare(f + TB_DIRS[d][0] * k, r + TB_DIRS[d][1] * k);
+            if (s < 0 || board[s] != EMPTY_PIECE) break;
+            visit(s);
+        }
+    }
+}
+
+// --- 文件格式：64 字节头部 | 块偏移 (blocks + 1 个 uint64) | 压缩块 ---
+// 条目值：0 为和棋，否则为 (距将杀半步数 + 1)；半步数为奇数表示走子方胜，偶数表示走子方被将死。
+// 块内游程编码：控制字节 c < 128 时后接 c + 1 个原样值；否则后接一个值，重复 c - 126 次。
+const char TB_MAGIC[8] = {'S', 'F', 'T', 'B', 'D', 'T', 'M', '1'};
+const uint32_t TB_FORMAT_VERSION = 1;
+const uint32_t TB_BLOCK_SIZE = 1024;
+struct TBFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryWidth;       // 1 或 2 字节
+    char signature[16];
+    uint64_t entries;          // 每个走子方的条目数；白方走在前
+    uint64_t blocks;
+    uint32_t blockSize;
+    uint32_t maxPlies;         // 最长的将杀距离 (半步)
+    char pad[8];
+};
+static_assert(sizeof(TBFileHeader) == 64, "Tablebase file header must stay 64 bytes");
+
+struct TBFile {
+    MappedFile file;
+    TBLayout layout;
+    const TBFileHeader* header = nullptr;
+    const uint64_t* offsets = nullptr;
+    const uint8_t* data = nullptr;
+
+    bool Open(const string& path) {
+        if (!file.Open(path) || file.size < sizeof(TBFileHeader)) return false;
+        header = (const TBFileHeader*)file.data;
+        if (memcmp(header->magic, TB_MAGIC, 8) != 0 || header->version != TB_FORMAT_VERSION) return false;
+        if (header->entryWidth < 1 || header->entryWidth > 2 || header->blockSize == 0) return false;
+        string sig(header->signature, strnlen(header->signature, sizeof(header->signature)));
+        if (!layout.Init(sig) || layout.entries != header->entries) return false;
+        if (header->blocks != (2 * header->entries + header->blockSize - 1) / header->blockSize) return false;
+        size_t dataStart = sizeof(TBFileHeader) + (header->blocks + 1) * 8;
+        if (file.size < dataStart) return false;
+        offsets = (const uint64_t*)(file.data + sizeof(TBFileHeader));
+        data = (const uint8_t*)file.data + dataStart;
+        return offsets[header->blocks] == file.size - dataStart;
+    }
+    int Read(const uint8_t* p) const { return header->entryWidth == 1 ? p[0] : (p[0] | (p[1] << 8)); }
+    int Value(int stm, uint64_t idx) const {
+        uint64_t entry = stm * header->entries + idx;
+        uint64_t block = entry / header->blockSize;
+        uint64_t skip = entry % header->blockSize;
+        const uint8_t* p = data + offsets[block];
+        int width = header->entryWidth;
+        while (true) {
+            int c = *p++;
+            if (c < 128) {
+                if (skip <= (uint64_t)c) return Read(p + skip * width);
+                skip -= c + 1;
+                p += (c + 1) * width;
+            } else {
+                if (skip < (uint64_t)(c - 126)) return Read(p);
+                skip -= c - 126;
+                p += width;
+            }
+        }
+    }
+};
+
+// --- 已载入的表：按实际子力键查找，另存颜色互换的键；载入后只读，可被任意线程探查 ---
+struct TBRef { const TBFile* table; bool flip; };
+vector<unique_ptr<TBFile>> tablebaseFiles;
+unordered_map<uint64_t, TBRef> tablebaseIndex;
+
+uint64_t LayoutMaterialKey(const TBLayout& layout) {
+    int counts[16] = {0};
+    for (int p : layout.pieces) counts[p]++;
+    return MaterialKey(counts);
+}
+
+void RegisterTablebase(unique_ptr<TBFile> table) {
+    tablebaseIndex[LayoutMaterialKey(table->layout)] = TBRef{table.get(), false};
+    int swapped[16] = {0};
+    for (int p : table->layout.pieces) swapped[p ^ COLOR_MASK]++;
+    uint64_t key = MaterialKey(swapped);
+    if (!tablebaseIndex.count(key)) tablebaseIndex[key] = TBRef{table.get(), true};
+    tablebaseMaxPieces = max(tablebaseMaxPieces, (int)table->layout.pieces.size());
+    tablebaseFiles.push_back(move(table));
+}
+
+// 返回条目值 (见文件格式)；只有两王时为和棋
+bool ProbeTablebasePieces(const int* codes, const int* squares, int n, int stm, int& value) {
+    if (n == 2) { value = 0; return true; }
+    if (n > TB_MAX_PIECES) return false;
+    int counts[16] = {0};
+    for (int i = 0; i < n; ++i) counts[codes[i]]++;
+    auto it = tablebaseIndex.find(MaterialKey(counts));
+    if (it == tablebaseIndex.end()) return false;
+    const TBFile& table = *it->second.table;
+    bool flip = it->second.flip;
+    int sq[TB_MAX_PIECES];
+    bool used[TB_MAX_PIECES] = {false};
+    for (int i = 0; i < n; ++i) {
+        int code = flip ? (codes[i] ^ COLOR_MASK) : codes[i];
+        for (int j = 0; j < n; ++j) {
+            if (used[j] || table.layout.pieces[j] != code) continue;
+            used[j] = true;
+            sq[j] = flip ? (squares[i] ^ 56) : squares[i];
+            break;
+        }
+    }
+    uint64_t idx = table.layout.Encode(sq);
+    if (idx == TB_NO_INDEX) return false;
+    value = table.Value(flip ? 1 - stm : stm, idx);
+    return true;
+}
+
+bool ProbeTablebase(TBProbe& out) {
+    if (castlingRights || enPassantTarget.ok()) return false;
+    int codes[TB_MAX_PIECES], squares[TB_MAX_PIECES], n = 0;
+    for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) {
+        if (board[x][y] == EMPTY_PIECE) continue;
+        if (n == tablebaseMaxPieces) return false;
+        codes[n] = board[x][y];
+        squares[n++] = (x - 1) + 8 * (y - 1);
+    }
+    int value;
+    if (!ProbeTablebasePieces(codes, squares, n, currentPlayer, value)) return false;
+    out.plies = value ? value - 1 : 0;
+    out.wdl = value == 0 ? 0 : (out.plies % 2 ? 1 : -1);
+    return true;
+}
+
+bool LoadTablebaseFile(const string& path) {
+    unique_ptr<TBFile> table(new TBFile());
+    if (!table->Open(path)) return false;
+    RegisterTablebase(move(table));
+    return true;
+}
+
+bool LoadTablebases(const string& dir) {
+#ifdef _WIN32
+    (void)dir;
+    cout << "Error: Loading tablebases is not supported on this platform." << endl;
+    return false;
+#else
+    DIR* d = opendir(dir.c_str());
+    if (!d) { cout << "Error: Could not open tablebase directory '" << dir << "'" << endl; return false; }
+    int loaded = 0;
+    while (dirent* e = readdir(d)) {
+        string name = e->d_name;
+        if (name.size() <= 5 || name.compare(name.size() - 5, 5, ".sftb") != 0) continue;
+        if (LoadTablebaseFile(dir + "/" + name)) loaded++;
+        else cout << "info string Skipping invalid tablebase file '" << name << "'" << endl;
+    }
+    closedir(d);
+    cout << "info string Loaded " << loaded << " tablebases (up to " << tablebaseMaxPieces << " pieces) from '" << dir << "'" << endl;
+    return true;
+#endif
+}
+
+// --- 逆推生成 ---
+// res：0 未定，1 非法，2 和棋，3 + n 为 n 半步内分出胜负 (奇数胜、偶数负)。
+// 每一轮扫描处理恰好 n 半步的局面：负局面使前驱 (对方走) 成为 n + 1 步胜；胜局面使前驱的未定子节点数减一，
+// 减到 0 且没有不输的出表着法时成为 n + 1 步负。出表着法 (吃子、升变) 的结果在初始化时从子表读出，记在 pending 中。
+const uint16_t RES_UNKNOWN = 0, RES_INVALID = 1, RES_DRAW = 2, RES_PLY0 = 3;
+const uint16_t PENDING_WIN = 0x8000, PENDING_DRAW = 0x4000, PENDING_PLY = 0x3FFF;
+const uint64_t TB_CHUNK = 1 << 14;
+const size_t TB_BYTES_PER_ENTRY = 2 * (sizeof(atomic<uint16_t>) + sizeof(atomic<uint8_t>) + sizeof(uint16_t));
+
+template <class F> void ParallelFor(uint64_t n, int threads, F fn) {
+    atomic<uint64_t> next(0);
+    auto worker = [&] { for (uint64_t b; (b = next.fetch_add(TB_CHUNK)) < n;) fn(b, min(n, b + TB_CHUNK)); };
+    vector<thread> pool;
+    for (int i = 1; i < threads; ++i) pool.emplace_back([&worker, i] { BindSearchThread(i); worker(); });
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+inline void AtomicMax(atomic<int>& a, int v) {
+    for (int cur = a.load(); v > cur && !a.compare_exchange_weak(cur, v);) {}
+}
+
+struct TBGenerator {
+    const TBLayout& layout;
+    int threads;
+    uint64_t n;
+    unique_ptr<atomic<uint16_t>[]> res[2];
+    unique_ptr<atomic<uint8_t>[]> cnt[2];
+    unique_ptr<uint16_t[]> pending[2];
+    atomic<int> maxPending{0};
+    atomic<bool> missing{false};
+
+    TBGenerator(const TBLayout& l, int t) : layout(l), threads(t), n(l.entries) {
+        for (int s = 0; s < 2; ++s) {
+            res[s].reset(new atomic<uint16_t>[n]());
+            cnt[s].reset(new atomic<uint8_t>[n]());
+            pending[s].reset(new uint16_t[n]());
+        }
+    }
+    int Pieces() const { return (int)layout.pieces.size(); }
+    void Place(const int* sq, int* board) const {
+        fill(board, board + 64, EMPTY_PIECE);
+        for (int i = 0; i < Pieces(); ++i) board[sq[i]] = layout.pieces[i];
+    }
+
+    void InitEntry(int stm, uint64_t idx, vector<uint64_t>& children, int& localMax) {
+        int sq[TB_MAX_PIECES], board[64];
+        if (!layout.Decode(idx, sq) || layout.Encode(sq) != idx) { res[stm][idx] = RES_INVALID; return; }
+        Place(sq, board);
+        if (TBAttacked(board, sq[1 - stm], stm)) { res[stm][idx] = RES_INVALID; return; }
+        children.clear();
+        int legal = 0, winPly = 0, lossPly = 0;
+        bool drawExit = false;
+        for (int i = 0; i < Pieces(); ++i) {
+            int code = layout.pieces[i];
+            if (PieceColorOf(code) != stm) continue;
+            int from = sq[i];
+            ForEachTarget(board, from, code, [&](int to) {
+                int captured = board[to];
+                board[to] = code; board[from] = EMPTY_PIECE;
+                bool ok = !TBAttacked(board, i == stm ? to : sq[stm], 1 - stm);
+                board[from] = code; board[to] = captured;
+                if (!ok) return;
+                legal++;
+                bool promotion = (code & PIECE_TYPE_MASK) == PAWN && ((to >> 3) == 0 || (to >> 3) == 7);
+                if (captured == EMPTY_PIECE && !promotion) {
+                    int child[TB_MAX_PIECES];
+                    copy(sq, sq + Pieces(), child);
+                    child[i] = to;
+                    children.push_back(layout.Encode(child));
+                    return;
+                }
+                // 出表着法：在子表中查对方走的结果
+                for (int promo = (promotion ? QUEEN : 0); promo >= (promotion ? KNIGHT : 0); --promo) {
+                    int codes[TB_MAX_PIECES], squares[TB_MAX_PIECES], m = 0;
+                    for (int j = 0; j < Pieces(); ++j) {
+                        if (captured != EMPTY_PIECE && sq[j] == to) continue;
+                        codes[m] = (j == i && promo) ? (promo | (stm * COLOR_MASK)) : layout.pieces[j];
+                        squares[m++] = (j == i) ? to : sq[j];
+                    }
+                    int v;
+                    if (!ProbeTablebasePieces(codes, squares, m, 1 - stm, v)) { missing = true; continue; }
+                    if (v == 0) drawExit = true;
+                    else if ((v - 1) % 2 == 0) winPly = winPly ? min(winPly, v) : v;   // 对方 v - 1 半步后被将死
+                    else lossPly = max(lossPly, v);
+                }
+            });
+        }
+        if (legal == 0) { res[stm][idx] = TBAttacked(board, sq[stm], 1 - stm) ? RES_PLY0 : RES_DRAW; return; }
+        sort(children.begin(), children.end());
+        cnt[stm][idx] = (uint8_t)(unique(children.begin(), children.end()) - children.begin());
+        uint16_t p = winPly ? (PENDING_WIN | winPly) : ((drawExit ? PENDING_DRAW : 0) | lossPly);
+        pending[stm][idx] = p;
+        localMax = max(localMax, (int)(p & PENDING_PLY));
+    }
+
+    // 本轮恰好 ply 半步的局面：先落实 pending 中到期的结果，再更新前驱
+    bool ScanEntry(int stm, uint64_t idx, int ply, vector<uint64_t>& preds) {
+        uint16_t r = res[stm][idx].load(memory_order_relaxed);
+        if (r == RES_UNKNOWN) {
+            uint16_t p = pending[stm][idx];
+            bool due = (p & PENDING_PLY) == ply && ((p & PENDING_WIN) || (!(p & PENDING_DRAW) && cnt[stm][idx].load(memory_order_relaxed) == 0));
+            if (!due) return false;
+            res[stm][idx].store(r = RES_PLY0 + ply, memory_order_relaxed);
+        }
+        if (r != RES_PLY0 + ply) return false;
+        int sq[TB_MAX_PIECES], board[64];
+        layout.Decode(idx, sq);
+        Place(sq, board);
+        int prev = 1 - stm;
+        preds.clear();
+        for (int i = 0; i < Pieces(); ++i) {
+            int code = layout.pieces[i];
+            if (PieceColorOf(code) != prev) continue;
+            int to = sq[i];
+            board[to] = EMPTY_PIECE;
+            ForEachOrigin(board, to, code, [&](int from) {
+                int p[TB_MAX_PIECES];
+                copy(sq, sq + Pieces(), p);
+                p[i] = from;
+                uint64_t pidx = layout.Encode(p);
+                if (pidx != TB_NO_INDEX) preds.push_back(pidx);
+            });
+            board[to] = code;
+        }
+        sort(preds.begin(), preds.end());
+        preds.erase(unique(preds.begin(), preds.end()), preds.end());
+        for (uint64_t pidx : preds) {
+            if (res[prev][pidx].load(memory_order_relaxed) != RES_UNKNOWN) continue;
+            uint16_t expected = RES_UNKNOWN;
+            if (ply % 2 == 0) { res[prev][pidx].compare_exchange_strong(expected, RES_PLY0 + ply + 1); continue; }
+            uint16_t p = pending[prev][pidx];
+            if (p & (PENDING_WIN | PENDING_DRAW)) { cnt[prev][pidx].fetch_sub(1, memory_order_relaxed); continue; }
+            if (cnt[prev][pidx].fetch_sub(1, memory_order_relaxed) == 1 && (p & PENDING_PLY) <= ply + 1)
+                res[prev][pidx].compare_exchange_strong(expected, RES_PLY0 + ply + 1);
+        }
+        return true;
+    }
+
+    bool Run(int& maxPly) {
+        ParallelFor(2 * n, threads, [&](uint64_t b, uint64_t e) {
+            vector<uint64_t> children;
+            int localMax = 0;
+            for (uint64_t i = b; i < e; ++i) InitEntry((int)(i / n), i % n, children, localMax);
+            AtomicMax(maxPending, localMax);
+        });
+        if (missing) return false;
+        maxPly = 0;
+        for (int ply = 0;; ++ply) {
+            atomic<uint64_t> found(0);
+            ParallelFor(2 * n, threads, [&](uint64_t b, uint64_t e) {
+                vector<uint64_t> preds;
+                uint64_t local = 0;
+                for (uint64_t i = b; i < e; ++i) local += ScanEntry((int)(i / n), i % n, ply, preds);
+                found += local;
+            });
+            if (found) maxPly = ply;
+            else if (ply >= maxPending) break;
+        }
+        return true;
+    }
+    // 文件中的条目值；非法局面返回 -1
+    int FinalValue(int stm, uint64_t idx) const {
+        uint16_t r = res[stm][idx].load(memory_order_relaxed);
+        if (r == RES_INVALID) return -1;
+        return r >= RES_PLY0 ? r - RES_PLY0 + 1 : 0;
+    }
+};
+
+// 非法局面取前一个值以延长游程 (它们永远不会被探查)
+bool WriteTablebase(const TBGenerator& g, const string& path, int maxPly, size_t& bytes) {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    TBFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TB_MAGIC, 8);
+    h.version = TB_FORMAT_VERSION;
+    h.entryWidth = (maxPly + 1 <= 255) ? 1 : 2;
+    strncpy(h.signature, g.layout.name.c_str(), sizeof(h.signature) - 1);
+    h.entries = g.n;
+    h.blockSize = TB_BLOCK_SIZE;
+    h.blocks = (2 * g.n + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE;
+    h.maxPlies = maxPly;
+    vector<uint64_t> offsets(h.blocks + 1, 0);
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)offsets.data(), offsets.size() * 8);
+    vector<int> values;
+    vector<uint8_t> packed;
+    int last = 0;
+    auto put = [&](int v) { packed.push_back(v & 0xFF); if (h.entryWidth == 2) packed.push_back(v >> 8); };
+    for (uint64_t b = 0; b < h.blocks; ++b) {
+        values.clear();
+        for (uint64_t e = b * TB_BLOCK_SIZE; e < min(2 * g.n, (b + 1) * TB_BLOCK_SIZE); ++e) {
+            int v = g.FinalValue((int)(e / g.n), e % g.n);
+            values.push_back(last = (v < 0 ? last : v));
+        }
+        packed.clear();
+        for (size_t i = 0; i < values.size();) {
+            size_t j = i;
+            while (j < values.size() && values[j] == values[i] && j - i < 129) ++j;
+            if (j - i >= 2) { packed.push_back((uint8_t)(128 + (j - i) - 2)); put(values[i]); i = j; continue; }
+            j = i + 1;
+            while (j < values.size() && j - i < 128 && !(j + 1 < values.size() && values[j] == values[j + 1])) ++j;
+            packed.push_back((uint8_t)(j - i - 1));
+            for (size_t k = i; k < j; ++k) put(values[k]);
+            i = j;
+        }
+        out.write((const char*)packed.data(), packed.size());
+        offsets[b + 1] = offsets[b] + packed.size();
+    }
+    out.seekp(sizeof(h));
+    out.write((const char*)offsets.data(), offsets.size() * 8);
+    bytes = sizeof(h) + offsets.size() * 8 + offsets.back();
+    return out.good();
+}
+
+// --- tbgen 命令 ---
+void PrintTbGenUsage() {
+    cout << "Usage: tbgen [-dir DIR] [-threads T] [-mem MB] [-all N] [SIGNATURE ...]\n"
+            "Generates DTM tablebases such as KQvK or KRPvKR (at most " << TB_MAX_PIECES << " pieces) by retrograde analysis.\n"
+            "Tables needed for captures and promotions are generated first; files already present in DIR are reused.\n"
+            "  -all N     generate every material combination with up to N pieces\n"
+            "  -mem MB    refuse tables whose working set exceeds MB (default 1024)\n"
+            "Engines load the files with the global option -tbpath DIR." << endl;
+}
+
+string TablebasePath(const string& dir, const string& sig) { return dir + "/" + sig + ".sftb"; }
+
+// 吃掉任意一个非王子或任意一个兵升变后得到的子表
+vector<string> TablebaseDependencies(const TBLayout& layout) {
+    set<string> deps;
+    int counts[16] = {0};
+    for (int p : layout.pieces) counts[p]++;
+    for (int p = 0; p < 16; ++p) {
+        if (!counts[p] || (p & PIECE_TYPE_MASK) == KING) continue;
+        counts[p]--;
+        if (layout.pieces.size() > 3) deps.insert(CanonicalSignature(counts));
+        if ((p & PIECE_TYPE_MASK) == PAWN)
+            for (int t = KNIGHT; t <= QUEEN; ++t) { counts[t | (p & COLOR_MASK)]++; deps.insert(CanonicalSignature(counts)); counts[t | (p & COLOR_MASK)]--; }
+        counts[p]++;
+    }
+    return vector<string>(deps.begin(), deps.end());
+}
+
+bool GenerateTablebase(const string& sig, const string& dir, int threads, size_t memMB, set<string>& done) {
+    if (done.count(sig)) return true;
+    TBLayout layout;
+    layout.Init(sig);
+    for (const string& dep : TablebaseDependencies(layout))
+        if (!GenerateTablebase(dep, dir, threads, memMB, done)) return false;
+    done.insert(sig);
+    string path = TablebasePath(dir, sig);
+    if (tablebaseIndex.count(LayoutMaterialKey(layout))) return true;   // 已由 -tbpath 载入
+    if (LoadTablebaseFile(path)) { cout << sig << ": using existing " << path << endl; return true; }
+    double needMB = (double)layout.entries * TB_BYTES_PER_ENTRY / (1024 * 1024);
+    if (needMB > memMB) {
+        cout << "Error: " << sig << " needs " << (size_t)needMB + 1 << " MB of working memory, above the -mem cap of " << memMB << " MB." << endl;
+        return false;
+    }
+    auto start = chrono::steady_clock::now();
+    int maxPly = 0;
+    size_t bytes = 0;
+    {
+        TBGenerator g(layout, threads);
+        if (!g.Run(maxPly)) { cout << "Error: " << sig << " depends on a tablebase that could not be loaded." << endl; return false; }
+        if (!WriteTablebase(g, path, maxPly, bytes)) { cout << "Error: Could not write '" << path << "'" << endl; return false; }
+    }
+    if (!LoadTablebaseFile(path)) { cout << "Error: Could not read back '" << path << "'" << endl; return false; }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << sig << ": " << layout.entries << " positions per side, "
+         << (maxPly ? "longest mate " + to_string(maxPly) + " plies, " : string("no mates, "))
+         << (maxPly + 1 <= 255 ? 1 : 2) << "-byte entries, " << bytes / 1024 + 1 << " KB, " << secs << " s" << endl;
+    return true;
+}
+
+// 每方其余子的所有组合 (每种 0..3 个)，总子数 <= pieces
+void EnumerateSignatures(int pieces, int type, int counts[16], int total, set<pair<int, string>>& out) {
+    if (type == 10) {
+        if (total > 2) out.insert(make_pair(total, CanonicalSignature(counts)));
+        return;
+    }
+    int code = (type % 5 + 1) | (type >= 5 ? COLOR_MASK : 0);
+    for (int k = 0; total + k <= pieces; ++k) {
+        counts[code] = k;
+        EnumerateSignatures(pieces, type + 1, counts, total + k, out);
+    }
+    counts[code] = 0;
+}
+
+int RunTbGen(int argc, char* argv[]) {
+    string dir = ".";
+    int threads = max(1u, thread::hardware_concurrency());
+    size_t memMB = 1024;
+    int all = 0;
+    vector<string> targets;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-dir" && i + 1 < argc) dir = argv[++i];
+            else if (a == "-threads" && i + 1 < argc) threads = max(1, stoi(argv[++i]));
+            else if (a == "-mem" && i + 1 < argc) memMB = max(1, stoi(argv[++i]));
+            else if (a == "-all" && i + 1 < argc) all = min(TB_MAX_PIECES, max(3, stoi(argv[++i])));
+            else if (a[0] != '-') targets.push_back(a);
+            else { PrintTbGenUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintTbGenUsage(); return 2; }
+    if (all) {
+        set<pair<int, string>> sigs;
+        int counts[16] = {0};
+        EnumerateSignatures(all, 0, counts, 2, sigs);
+        for (const auto& s : sigs) targets.push_back(s.second);
+    }
+    if (targets.empty()) { PrintTbGenUsage(); return 2; }
+    for (string& t : targets) {
+        int counts[16];
+        if (!ParseSignature(t, counts)) { cout << "Error: Invalid material signature '" << t << "'" << endl; return 2; }
+        t = CanonicalSignature(counts);
+        if (t == "KvK") { cout << "Error: KvK is always a draw and has no table." << endl; return 2; }
+    }
+#ifndef _WIN32
+    mkdir(dir.c_str(), 0755);
+#endif
+    auto start = chrono::steady_clock::now();
+    set<string> done;
+    for (const string& t : targets)
+        if (!GenerateTablebase(t, dir, threads, memMB, done)) return 1;
+    cout << "----------------------------------" << endl;
+    cout << "Tablebases in '" << dir << "': " << done.size() << ", total time "
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+    return 0;
+}
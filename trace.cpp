@@ -0,0 +1,291 @@
+// trace.cpp
+//Starfish --- chess engine developed by dsyoier
+//搜索树跟踪：SearchTrace 把每个节点的着法、窗口、深度、返回值、节点类型与结束原因写成定长二进制记录，
+//缓冲后成批写入文件；trace 命令录制跟踪，并离线查询 (统计、某个根着法为何被驳倒、某个节点的子节点)
+#include "starfish.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <sstream>
+#include <map>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+thread_local SearchTrace* searchTrace = nullptr;
+
+// --- 文件格式：8 字节标识，4 字节 FEN 长度与 FEN，之后是连续的 TraceRecord (本机字节序) ---
+const char TRACE_MAGIC[8] = {'S', 'F', 'T', 'R', 'A', 'C', 'E', '1'};
+const size_t TRACE_BUFFER_RECORDS = 1 << 16;   // 攒满这么多条 (2.5 MB) 写一次
+const char* TRACE_TYPE_NAMES[] = {"pv", "nonpv", "qs"};
+const char* TRACE_REASON_NAMES[] = {"exact", "fail-low", "beta-cutoff", "hash-cutoff", "repetition", "tablebase",
+                                    "checkmate", "stalemate", "stand-pat", "qs-cutoff", "qs-done", "aborted"};
+const int TRACE_REASON_COUNT = sizeof(TRACE_REASON_NAMES) / sizeof(TRACE_REASON_NAMES[0]);
+
+bool SearchTrace::Open(const string& path, const string& fen) {
+    Close();
+    file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    uint32_t length = (uint32_t)fen.size();
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), file);
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(fen.data(), 1, length, file);
+    buffer.reserve(TRACE_BUFFER_RECORDS);
+    top = 0;
+    nextId = 0;
+    written = 0;
+    return true;
+}
+
+void SearchTrace::Close() {
+    if (!file) return;
+    Flush();
+    fclose(file);
+    file = nullptr;
+}
+
+void SearchTrace::Flush() {
+    if (file && !buffer.empty()) fwrite(buffer.data(), sizeof(TraceRecord), buffer.size(), file);
+    buffer.clear();
+}
+
+// 是否记录由父节点继承：根着法节点看 onlyRootMove，其下的节点跟随父节点，再叠加 ply 与迭代的限制
+void SearchTrace::Enter(int type, int depth, double alpha, double beta) {
+    Frame& f = stack[top];
+    int ply = top + 1;
+    bool parent = top == 0 ? (!onlyRootMove || nextMove == onlyRootMove) : stack[top - 1].record;
+    f.record = parent && ply <= maxPly && (!onlyIteration || iterative_deepening_current_depth == onlyIteration);
+    f.id = ++nextId;
+    f.alpha = alpha;
+    f.beta = beta;
+    f.move = nextMove;
+    f.depth = (uint8_t)depth;
+    f.type = (uint8_t)type;
+    top++;
+}
+
+void SearchTrace::Leave(int reason, double score, int searched) {
+    const Frame& f = stack[--top];
+    if (!f.record) return;
+    TraceRecord r;
+    r.alpha = f.alpha;
+    r.beta = f.beta;
+    r.score = score;
+    r.id = f.id;
+    r.parent = top ? stack[top - 1].id : 0;
+    r.move = f.move;
+    r.ply = (uint8_t)(top + 1);
+    r.depth = f.depth;
+    r.iteration = (uint8_t)iterative_deepening_current_depth;
+    r.type = f.type;
+    r.reason = (uint8_t)reason;
+    r.searched = (uint8_t)min(searched, 255);
+    buffer.push_back(r);
+    written++;
+    if (buffer.size() >= TRACE_BUFFER_RECORDS) Flush();
+}
+
+// --- 读取与查询 ---
+struct TraceFile {
+    string fen;
+    vector<TraceRecord> records;
+    unordered_map<uint32_t, vector<size_t>> children;   // 按搜索顺序
+
+    bool Load(const string& path) {
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) { cout << "Error: Could not open trace file '" << path << "'" << endl; return false; }
+        char magic[8];
+        uint32_t length = 0;
+        if (!in.read(magic, sizeof(magic)) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || !in.read((char*)&length, sizeof(length)) || length > 4096) {
+            cout << "Error: '" << path << "' is not a search trace." << endl;
+            return false;
+        }
+        fen.resize(length);
+        in.read(&fen[0], length);
+        TraceRecord r;
+        while (in.read((char*)&r, sizeof(r))) records.push_back(r);
+        for (size_t i = 0; i < records.size(); ++i) children[records[i].parent].push_back(i);
+        return true;
+    }
+    const vector<size_t>& Children(uint32_t id) const {
+        static const vector<size_t> none;
+        auto it = children.find(id);
+        return it == children.end() ? none : it->second;
+    }
+};
+
+string TraceMoveText(uint16_t packed) {
+    if (!packed) return "-";
+    Move m;
+    m.from = Pos((packed & 63) % 8 + 1, (packed & 63) / 8 + 1);
+    m.to = Pos(((packed >> 6) & 63) % 8 + 1, ((packed >> 6) & 63) / 8 + 1);
+    m.promotion = (packed >> 12) & 7;
+    return MoveToUCI(m);
+}
+
+string TraceWindowText(double v) {
+    if (v == numeric_limits<double>::infinity()) return "+inf";
+    if (v == -numeric_limits<double>::infinity()) return "-inf";
+    ostringstream os;
+    os << fixed << setprecision(fabs(v) >= 1e6 ? 0 : 3) << v + 0.0;   // + 0.0 把 -0 变成 0
+    return os.str();
+}
+
+void PrintTraceRecord(const TraceRecord& r, int indent) {
+    cout << string(indent * 2, ' ') << "#" << r.id << " ply " << (int)r.ply << " " << setw(6) << left << TraceMoveText(r.move) << right
+         << " " << setw(5) << TRACE_TYPE_NAMES[r.type] << " d" << (int)r.depth << " (" << TraceWindowText(r.alpha) << ", " << TraceWindowText(r.beta)
+         << ") -> " << TraceWindowText(r.score) << " " << TRACE_REASON_NAMES[r.reason];
+    if (r.searched) cout << " after " << (int)r.searched << (r.searched == 1 ? " move" : " moves");
+    cout << endl;
+}
+
+// 某节点被驳倒 (或得到当前分数) 的原因：截断时是最后搜索的子节点，否则是对本方最好的子节点
+size_t DecisiveChild(const TraceFile& t, size_t index) {
+    const vector<size_t>& kids = t.Children(t.records[index].id);
+    if (kids.empty()) return SIZE_MAX;
+    int reason = t.records[index].reason;
+    if (reason == TRACE_BETA_CUTOFF || reason == TRACE_QS_CUTOFF) return kids.back();
+    size_t best = kids[0];
+    for (size_t k : kids) if (-t.records[k].score > -t.records[best].score) best = k;
+    return best;
+}
+
+int LastIteration(const TraceFile& t) {
+    int last = 0;
+    for (const auto& r : t.records) last = max(last, (int)r.iteration);
+    return last;
+}
+
+void PrintTraceStats(const TraceFile& t) {
+    cout << "Position   : " << t.fen << endl;
+    cout << "Records    : " << t.records.size() << endl;
+    map<int, vector<long long>> byIteration;
+    for (const auto& r : t.records) {
+        auto& counts = byIteration[r.iteration];
+        if (counts.empty()) counts.assign(3 + TRACE_REASON_COUNT, 0);
+        counts[r.type]++;
+        counts[3 + r.reason]++;
+    }
+    for (const auto& it : byIteration) {
+        const auto& c = it.second;
+        cout << "Iteration " << setw(2) << it.first << ": pv " << c[TRACE_PV] << ", nonpv " << c[TRACE_NONPV] << ", qs " << c[TRACE_QS] << " |";
+        for (int k = 0; k < TRACE_REASON_COUNT; ++k) if (c[3 + k]) cout << " " << TRACE_REASON_NAMES[k] << " " << c[3 + k];
+        cout << endl;
+    }
+    int last = LastIteration(t);
+    cout << "Root moves at iteration " << last << " (scores from the root side):" << endl;
+    for (size_t k : t.Children(0)) {
+        const TraceRecord& r = t.records[k];
+        if (r.iteration != last) continue;
+        cout << "  " << setw(6) << left << TraceMoveText(r.move) << right << " " << setw(5) << TRACE_TYPE_NAMES[r.type]
+             << " window (" << TraceWindowText(-r.beta) << ", " << TraceWindowText(-r.alpha) << ") -> " << TraceWindowText(-r.score) << endl;
+    }
+}
+
+// 根着法 move 在 iteration 轮中的每次搜索 (零窗口与可能的重搜)，以及最后一次搜索中决定其分数的应着线
+int PrintTraceWhy(const TraceFile& t, const string& move, int iteration) {
+    if (!iteration) iteration = LastIteration(t);
+    vector<size_t> searches;
+    for (size_t k : t.Children(0)) if (t.records[k].iteration == iteration && TraceMoveText(t.records[k].move) == move) searches.push_back(k);
+    if (searches.empty()) { cout << "Move " << move << " was not recorded at iteration " << iteration << "." << endl; return 1; }
+    cout << "Root move " << move << " at iteration " << iteration << " (scores from the side to move at each node):" << endl;
+    for (size_t k : searches) PrintTraceRecord(t.records[k], 1);
+    size_t node = searches.back();
+    cout << "Deciding line:" << endl;
+    for (int indent = 1; node != SIZE_MAX; ++indent) {
+        PrintTraceRecord(t.records[node], indent);
+        node = DecisiveChild(t, node);
+    }
+    return 0;
+}
+
+int PrintTraceNode(const TraceFile& t, uint32_t id) {
+    for (const auto& r : t.records) {
+        if (r.id != id) continue;
+        PrintTraceRecord(r, 0);
+        for (size_t k : t.Children(id)) PrintTraceRecord(t.records[k], 1);
+        return 0;
+    }
+    cout << "Node #" << id << " is not in the trace." << endl;
+    return 1;
+}
+
+void PrintTraceUsage() {
+    cout << "Usage: trace record -out FILE [-fen FEN] [-depth N] [-maxply P] [-iteration D] [-move UCI]\n"
+            "       trace stats FILE\n"
+            "       trace why FILE -move UCI [-iteration D]\n"
+            "       trace node FILE -id N\n"
+            "record searches the position to depth N (default 6) and writes one 40-byte record per node: ply, move,\n"
+            "window, depth, score, node type and why the node ended (cutoff, hash cutoff, stand pat, ...).\n"
+            "-maxply, -iteration and -move restrict the recording to shallow plies, one iteration or one root move.\n"
+            "why shows every search of a root move in an iteration (default: the last) and the line that decided\n"
+            "its score; node shows one node and its children." << endl;
+}
+
+int RunTrace(int argc, char* argv[]) {
+    if (argc < 1) { PrintTraceUsage(); return 2; }
+    string mode = argv[0], path, fen = START_FEN, move;
+    int depth = 6, maxPly = 255, iteration = 0;
+    long long id = -1;
+    int first = 1;
+    if (mode != "record") {
+        if (argc < 2) { PrintTraceUsage(); return 2; }
+        path = argv[1];
+        first = 2;
+    }
+    try {
+        for (int i = first; i < argc; ++i) {
+            string a = argv[i];
+            if (a == "-out" && i + 1 < argc) path = argv[++i];
+            else if (a == "-fen" && i + 1 < argc) fen = argv[++i];
+            else if (a == "-depth" && i + 1 < argc) depth = max(2, stoi(argv[++i]));
+            else if (a == "-maxply" && i + 1 < argc) maxPly = max(1, stoi(argv[++i]));
+            else if (a == "-iteration" && i + 1 < argc) iteration = max(0, stoi(argv[++i]));
+            else if (a == "-move" && i + 1 < argc) move = argv[++i];
+            else if (a == "-id" && i + 1 < argc) id = stoll(argv[++i]);
+            else { PrintTraceUsage(); return 2; }
+        }
+    } catch (const std::exception&) { PrintTraceUsage(); return 2; }
+
+    if (mode == "record") {
+        if (path.empty()) { PrintTraceUsage(); return 2; }
+        Position position;
+        if (!position.SetFEN(fen)) { cout << "Error: Invalid FEN '" << fen << "'" << endl; return 2; }
+        position.Load();
+        SearchTrace trace;
+        trace.maxPly = maxPly;
+        trace.onlyIteration = iteration;
+        if (!move.empty()) {
+            vector<Move> legal; GenerateLegalMoves(legal);
+            Move m = parse_uci_move(move);
+            if (find(legal.begin(), legal.end(), m) == legal.end()) { cout << "Error: Illegal move '" << move << "'" << endl; return 2; }
+            trace.onlyRootMove = SearchTrace::Pack(m);
+        }
+        if (!trace.Open(path, GenerateFEN())) { cout << "Error: Could not create trace file '" << path << "'" << endl; return 2; }
+        searchQuiet = true;
+        searchMultiPV = 1;
+        searchMaxDepth = depth;
+        searchTimeLimitMs = numeric_limits<int>::max();
+        searchTrace = &trace;
+        SearchBestMove(depth);
+        searchTrace = nullptr;
+        trace.Close();
+        cout << "Best move       : " << MoveToUCI(searchBestMove) << " (score cp " << static_cast<int>(currentPlayer == WHITE ? searchBestScore : -searchBestScore) << ")" << endl;
+        cout << "Nodes searched  : " << computedNodes << endl;
+        cout << "Nodes recorded  : " << trace.written << " (" << trace.written * sizeof(TraceRecord) / 1024 << " KB) in " << path << endl;
+        return 0;
+    }
+    TraceFile t;
+    if (!t.Load(path)) return 2;
+    if (mode == "stats") { PrintTraceStats(t); return 0; }
+    if (mode == "why" && !move.empty()) return PrintTraceWhy(t, move, iteration);
+    if (mode == "node" && id >= 0) return PrintTraceNode(t, (uint32_t)id);
+    PrintTraceUsage();
+    return 2;
+}
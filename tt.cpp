@@ -0,0 +1,286 @@
+// tt.cpp
+//Starfish --- chess engine developed by dsyoier
+//置换表：私有内存或跨进程共享 (POSIX 共享内存 / 内存映射文件)，带版本头与校验和
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#endif
+
+using namespace std;
+
+// --- 映射文件布局：64 字节头部 | 条目数组 ---
+// 多个进程可同时映射同一张表，各自持有共享 flock；最后一个离开的进程取得独占锁后
+// 计算整表校验和并标记 sealed，下一次首个打开者据此检查内容是否完整。
+const char TT_MAGIC[8] = {'S', 'F', 'T', 'T', 'A', 'B', 'L', 'E'};
+const uint32_t TT_FORMAT_VERSION = 1;
+struct TTFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint64_t entryCount;
+    uint64_t buildId;          // Zobrist 键、评估参数与条目格式的指纹
+    uint64_t headerChecksum;   // 以上字段的校验
+    uint64_t dataChecksum;     // sealed 时有效
+    uint32_t sealed;
+    uint32_t reserved;
+    char pad[8];
+};
+static_assert(sizeof(TTFileHeader) == 64, "TT file header must stay 64 bytes");
+
+size_t ttDefaultSizeMB = 16;
+thread_local TranspositionTable* threadTT = nullptr;
+thread_local unique_ptr<TranspositionTable> privateTT;
+
+TranspositionTable& ThreadTT() {
+    if (threadTT) return *threadTT;
+    if (!privateTT) { privateTT.reset(new TranspositionTable()); privateTT->Allocate(ttDefaultSizeMB); }
+    return *privateTT;
+}
+void SetThreadTT(TranspositionTable* table) { threadTT = table; }
+
+string ttSharedName, ttFilePath;
+bool ParseHashOption(const string& option, const string& value) {
+    if (option == "-hash") ttDefaultSizeMB = max(1, atoi(value.c_str()));
+    else if (option == "-hashshm") ttSharedName = value;
+    else if (option == "-hashfile") ttFilePath = value;
+    else return false;
+    return true;
+}
+bool AttachMainThreadTT(TranspositionTable& table) {
+    if (ttSharedName.empty() && ttFilePath.empty()) return true;
+    bool ok = !ttSharedName.empty() ? table.AttachShared(ttSharedName, ttDefaultSizeMB) : table.AttachFile(ttFilePath, ttDefaultSizeMB);
+    if (ok) SetThreadTT(&table);
+    return ok;
+}
+
+inline uint64_t MixChecksum(uint64_t h, uint64_t v) { return (h ^ v) * 0x100000001B3ULL; }
+
+uint64_t TTBuildId() {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    h = MixChecksum(h, TT_FORMAT_VERSION);
+    h = MixChecksum(h, sizeof(TTEntry));
+    for (const auto& row : zobristPiece) for (uint64_t v : row) h = MixChecksum(h, v);
+    for (uint64_t v : zobristCastling) h = MixChecksum(h, v);
+    for (uint64_t v : zobristEnPassant) h = MixChecksum(h, v);
+    h = MixChecksum(h, zobristSide);
+    for (double v : CaptureEvalParams()) { uint64_t bits; memcpy(&bits, &v, 8); h = MixChecksum(h, bits); }
+    return h;
+}
+uint64_t TTHeaderChecksum(const TTFileHeader& h) {
+    uint64_t c = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; ++i) c = MixChecksum(c, (unsigned char)h.magic[i]);
+    c = MixChecksum(c, h.version);
+    c = MixChecksum(c, h.entrySize);
+    c = MixChecksum(c, h.entryCount);
+    c = MixChecksum(c, h.buildId);
+    return c;
+}
+uint64_t TTDataChecksum(const TTEntry* entries, uint64_t count) {
+    uint64_t c = 0xCBF29CE484222325ULL;
+    for (uint64_t i = 0; i < count; ++i) {
+        c = MixChecksum(c, entries[i].check.load(memory_order_relaxed));
+        c = MixChecksum(c, entries[i].score.load(memory_order_relaxed));
+        c = MixChecksum(c, entries[i].meta.load(memory_order_relaxed));
+    }
+    return c;
+}
+
+bool TranspositionTable::Allocate(size_t mb) {
+    Detach();
+    count = max<uint64_t>(1, (uint64_t)mb * 1024 * 1024 / sizeof(TTEntry));
+    entries = (TTEntry*)AllocateLargePages(count * sizeof(TTEntry), ownedBytes);
+    if (!entries) { count = 0; cout << "Error: Could not allocate " << mb << " MB for the hash table." << endl; return false; }
+    ownsMemory = true;
+    // 映射来的页尚未分配物理内存：由各节点上的线程构造条目，使每页落在使用它的节点上
+    TTEntry* base = entries;
+    ParallelByNode(count * sizeof(TTEntry), [base](size_t begin, size_t end) {
+        for (size_t i = (begin + sizeof(TTEntry) - 1) / sizeof(TTEntry); i < (end + sizeof(TTEntry) - 1) / sizeof(TTEntry); ++i) new (&base[i]) TTEntry();
+    });
+    ReportLargeTable("Hash table", entries, ownedBytes);
+    return true;
+}
+
+bool TranspositionTable::AttachShared(const string& name, size_t mb) {
+#ifdef _WIN32
+    (void)name; (void)mb;
+    cout << "Error: Shared-memory hash tables are not supported on this platform." << endl;
+    return false;
+#else
+    Detach();
+    source = (name.empty() || name[0] != '/') ? "/" + name : name;
+    fd = shm_open(source.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) { cout << "Error: Could not open shared memory '" << source << "'" << endl; return false; }
+    return AttachMapped("shared memory", mb);
+#endif
+}
+
+bool TranspositionTable::AttachFile(const string& path, size_t mb) {
+#ifdef _WIN32
+    (void)path; (void)mb;
+    cout << "Error: File-backed hash tables are not supported on this platform." << endl;
+    return false;
+#else
+    Detach();
+    source = path;
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) { cout << "Error: Could not open hash file '" << path << "'" << endl; return false; }
+    return AttachMapped("hash file", mb);
+#endif
+}
+
+#ifndef _WIN32
+bool TranspositionTable::AttachMapped(const string& what, size_t mb) {
+    auto fail = [&](const string& msg) {
+        cout << "Error: " << what << " '" << source << "' " << msg << endl;
+        if (header) munmap(header, mappedBytes);   // 拒绝的表不封存、不写回
+        header = nullptr; entries = nullptr;
+        Detach();
+        return false;
+    };
+    // 拿到独占锁说明没有其它进程在用：由本进程初始化或完整校验；否则等待初始化者完成后只校验头部
+    bool alone = flock(fd, LOCK_EX | LOCK_NB) == 0;
+    if (!alone && flock(fd, LOCK_SH) != 0) return fail("could not be locked.");
+    struct stat st;
+    if (fstat(fd, &st) != 0) return fail("could not be inspected.");
+    uint64_t buildId = TTBuildId();
+    bool fresh = st.st_size == 0;
+    if (fresh) {
+        if (!alone) return fail("is being created by another process.");
+        uint64_t n = max<uint64_t>(1, (uint64_t)mb * 1024 * 1024 / sizeof(TTEntry));
+        if (ftruncate(fd, sizeof(TTFileHeader) + n * sizeof(TTEntry)) != 0) return fail("could not be resized.");
+        st.st_size = sizeof(TTFileHeader) + n * sizeof(TTEntry);
+    }
+    if ((size_t)st.st_size < sizeof(TTFileHeader)) return fail("is too small to be a hash table.");
+    mappedBytes = st.st_size;
+    void* p = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) { mappedBytes = 0; return fail("could not be mapped."); }
+    header = (TTFileHeader*)p;
+    entries = (TTEntry*)((char*)p + sizeof(TTFileHeader));
+    if (fresh) {
+        memcpy(header->magic, TT_MAGIC, 8);
+        header->version = TT_FORMAT_VERSION;
+        header->entrySize = sizeof(TTEntry);
+        header->entryCount = (mappedBytes - sizeof(TTFileHeader)) / sizeof(TTEntry);
+        header->buildId = buildId;
+        header->headerChecksum = TTHeaderChecksum(*header);
+    }
+    if (memcmp(header->magic, TT_MAGIC, 8) != 0 || header->headerChecksum != TTHeaderChecksum(*header))
+        return fail("is not a Starfish hash table or its header is corrupt.");
+    if (header->version != TT_FORMAT_VERSION || header->entrySize != sizeof(TTEntry))
+        return fail("uses hash table format " + to_string(header->version) + " (this build uses " + to_string(TT_FORMAT_VERSION) + ").");
+    if (header->buildId != buildId)
+        return fail("was written by an incompatible build (different hash keys or evaluation parameters).");
+    if (sizeof(TTFileHeader) + header->entryCount * sizeof(TTEntry) > mappedBytes) return fail("is truncated.");
+    count = header->entryCount;
+    if (alone && !fresh) {
+        if (header->sealed && header->dataChecksum != TTDataChecksum(entries, count)) return fail("failed its checksum; delete it to start over.");
+        if (!header->sealed) cout << "info string " << what << " '" << source << "' was not closed cleanly; entries are verified individually." << endl;
+    }
+    header->sealed = 0;
+    if (alone) flock(fd, LOCK_SH);
+    if ((uint64_t)mb * 1024 * 1024 / sizeof(TTEntry) != count && !fresh)
+        cout << "info string Using existing " << what << " '" << source << "' of " << (count * sizeof(TTEntry) >> 20) << " MB." << endl;
+    return true;
+}
+#endif
+
+void TranspositionTable::Detach() {
+    if (ownsMemory) FreeLargePages(entries, ownedBytes);
+#ifndef _WIN32
+    if (header) {
+        // 最后一个离开的进程封存整表校验和
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            header->dataChecksum = TTDataChecksum(entries, count);
+            header->sealed = 1;
+        }
+        msync(header, mappedBytes, MS_SYNC);
+        munmap(header, mappedBytes);
+    }
+    if (fd >= 0) { flock(fd, LOCK_UN); close(fd); }
+#endif
+    entries = nullptr; header = nullptr; count = 0; mappedBytes = 0; ownedBytes = 0; fd = -1; ownsMemory = false;
+}
+
+void TranspositionTable::Clear() {
+    TTEntry* base = entries;
+    ParallelByNode(count * sizeof(TTEntry), [base](size_t begin, size_t end) {
+        for (size_t i = (begin + sizeof(TTEntry) - 1) / sizeof(TTEntry); i < (end + sizeof(TTEntry) - 1) / sizeof(TTEntry); ++i) {
+            base[i].check.store(0, memory_order_relaxed);
+            base[i].score.store(0, memory_order_relaxed);
+            base[i].meta.store(0, memory_order_relaxed);
+        }
+    });
+    generation = 0;
+}
+
+// meta: 着法 (起点 6 位、终点 6 位、升变兵种 3 位、有效 1 位) | 深度 << 16 | 界 << 24 | 代 << 32
+bool TranspositionTable::Probe(uint64_t key, TTData& out) const {
+    if (!count) return false;
+    const TTEntry& e = entries[key % count];
+    uint64_t score = e.score.load(memory_order_relaxed);
+    uint64_t meta = e.meta.load(memory_order_relaxed);
+    if ((e.check.load(memory_order_relaxed) ^ score ^ meta) != key || meta == 0) return false;
+    memcpy(&out.score, &score, 8);
+    out.depth = (meta >> 16) & 0xFF;
+    out.bound = (meta >> 24) & 3;
+    out.move = Move();
+    if (meta & 0x8000) {
+        int from = meta & 63, to = (meta >> 6) & 63, promo = (meta >> 12) & 7;
+        out.move.from = Pos(from % 8 + 1, from / 8 + 1);
+        out.move.to = Pos(to % 8 + 1, to / 8 + 1);
+        if (promo) out.move.promotion = promo | (currentPlayer * COLOR_MASK);
+    }
+    return true;
+}
+
+void TranspositionTable::Store(uint64_t key, const Move& move, double score, int depth, int bound) {
+    if (!count) return;
+    TTEntry& e = entries[key % count];
+    uint64_t oldMeta = e.meta.load(memory_order_relaxed);
+    bool sameKey = (e.check.load(memory_order_relaxed) ^ e.score.load(memory_order_relaxed) ^ oldMeta) == key;
+    // 同代且更深的其它局面保留；同一局面总是更新
+    if (!sameKey && oldMeta && ((oldMeta >> 32) & 0xFF) == generation && (int)((oldMeta >> 16) & 0xFF) > depth) return;
+    uint64_t meta = (uint64_t)min(depth, 255) << 16 | (uint64_t)bound << 24 | (uint64_t)generation << 32;
+    if (move.from.ok()) {
+        meta |= 0x8000 | ((move.from.y - 1) * 8 + (move.from.x - 1)) | (((move.to.y - 1) * 8 + (move.to.x - 1)) << 6)
+              | ((move.promotion & PIECE_TYPE_MASK) << 12);
+    } else if (sameKey && (oldMeta & 0x8000)) {
+        meta |= oldMeta & 0xFFFF;   // 保留旧的最佳着法
+    }
+    uint64_t bits; memcpy(&bits, &score, 8);
+    if (exportLog && depth >= exportMinDepth) exportLog->push_back({key, bits, meta & 0xFFFFFFFFULL});
+    e.score.store(bits, memory_order_relaxed);
+    e.meta.store(meta, memory_order_relaxed);
+    e.check.store(key ^ bits ^ meta, memory_order_relaxed);
+}
+
+void TranspositionTable::Import(const TTExport& x) {
+    if (!count || !x.meta) return;
+    TTEntry& e = entries[x.key % count];
+    uint64_t oldMeta = e.meta.load(memory_order_relaxed);
+    if (oldMeta && ((oldMeta >> 32) & 0xFF) == generation && ((oldMeta >> 16) & 0xFF) >= ((x.meta >> 16) & 0xFF)) return;
+    uint64_t meta = (x.meta & 0xFFFFFFFFULL) | (uint64_t)generation << 32;
+    e.score.store(x.score, memory_order_relaxed);
+    e.meta.store(meta, memory_order_relaxed);
+    e.check.store(x.key ^ x.score ^ meta, memory_order_relaxed);
+}
+
+int TranspositionTable::Hashfull() const {
+    uint64_t n = min<uint64_t>(1000, count), used = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t meta = entries[i].meta.load(memory_order_relaxed);
+        if (meta && ((meta >> 32) & 0xFF) == generation) used++;
+    }
+    return n ? (int)(used * 1000 / n) : 0;
+}
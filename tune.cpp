@@ -0,0 +1,391 @@
+// tune.cpp
+//Starfish --- chess engine developed by dsyoier
+//Texel 调参 (tune)
+#include "starfish.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <cmath>
+#include <iomanip>
+#include <functional>
+#include <cstdlib>
+
+using namespace std;
+
+// --- Texel 调参 (tune)：在带结果标注的静止局面上拟合评估参数 ---
+// Evaluate() 对全部评估参数是线性的：每个局面预先算出各参数的整数系数，
+// 损失函数只需对稀疏系数做点积。子力位置表的 mg/eg 两项共用一个系数，按阶段权重拆分。
+struct TuneTerm { uint16_t index; int16_t coeff; };
+struct TunePosition { float result; float phase; uint32_t begin; };
+struct TuneData {
+    vector<TunePosition> positions;
+    vector<TuneTerm> terms;
+    vector<char> isPstMg;          // 参数下标是否为某张 *_pst_mg 表中的一格
+};
+
+int EvalParamOffset(const string& name) {
+    int offset = 0;
+    for (const auto& r : EvalParamRefs()) { if (name == r.name) return offset; offset += r.count; }
+    return -1;
+}
+
+// 必须与 Evaluate()/GetPSTValue()/EvaluatePositional() 保持一致，载入数据时会逐局面校验
+void TraceEvaluate(vector<int>& acc, float& phase) {
+    static const char* pst_names[] = {"", "pawn_pst_mg", "knight_pst_mg", "bishop_pst_mg", "rook_pst_mg", "queen_pst_mg", "king_pst_mg"};
+    const int material = EvalParamOffset("pieceValue");
+    const int doubled = EvalParamOffset("DOUBLED_PAWN_PENALTY"), isolated = EvalParamOffset("ISOLATED_PAWN_PENALTY");
+    const int passed = EvalParamOffset("PASSED_PAWN_BONUS"), bishop_pair = EvalParamOffset("BISHOP_PAIR_BONUS");
+    const int rook_semi = EvalParamOffset("ROOK_ON_SEMI_OPEN_FILE_BONUS"), rook_open = EvalParamOffset("ROOK_ON_OPEN_FILE_BONUS");
+    const int shield = EvalParamOffset("PAWN_SHIELD_PENALTY");
+    fill(acc.begin(), acc.end(), 0);
+
+    int total_pieces = 0;
+    for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) if (board[x][y] != EMPTY_PIECE) total_pieces++;
+    phase = (float)min(1.0, (total_pieces - 8) / 24.0);
+
+    int white_pawns_on_file[9] = {0}, black_pawns_on_file[9] = {0};
+    int white_bishops = 0, black_bishops = 0;
+    Pos white_king_pos, black_king_pos;
+    for (int x = 1; x <= 8; ++x) {
+        for (int y = 1; y <= 8; ++y) {
+            int piece = board[x][y];
+            if (piece == EMPTY_PIECE) continue;
+            int piece_type = piece & PIECE_TYPE_MASK;
+            int color = PieceColorOf(piece);
+            int sign = (color == WHITE) ? 1 : -1;
+            int square_idx = (y - 1) * 8 + (x - 1);
+            if (color == BLACK) square_idx = 63 - square_idx;
+            acc[material + piece_type] += sign;
+            acc[EvalParamOffset(pst_names[piece_type]) + square_idx] += sign;
+            if (piece_type == PAWN) { if (color == WHITE) white_pawns_on_file[x]++; else black_pawns_on_file[x]++; }
+            else if (piece_type == BISHOP) { if (color == WHITE) white_bishops++; else black_bishops++; }
+            else if (piece_type == KING) { if (color == WHITE) white_king_pos = {x, y}; else black_king_pos = {x, y}; }
+        }
+    }
+    for (int i = 1; i <= 8; ++i) {
+        if (white_pawns_on_file[i] > 1) acc[doubled] += white_pawns_on_file[i] - 1;
+        if (black_pawns_on_file[i] > 1) acc[doubled] -= black_pawns_on_file[i] - 1;
+    }
+    for (int x = 1; x <= 8; ++x) {
+        for (int y = 1; y <= 8; ++y) {
+            int piece = board[x][y];
+            if (piece == EMPTY_PIECE) continue;
+            int piece_type = piece & PIECE_TYPE_MASK;
+            int color = PieceColorOf(piece);
+            int sign = (color == WHITE) ? 1 : -1;
+            int* own_files = (color == WHITE) ? white_pawns_on_file : black_pawns_on_file;
+            int* their_files = (color == WHITE) ? black_pawns_on_file : white_pawns_on_file;
+            if (piece_type == PAWN) {
+                if (own_files[max(1, x - 1)] == 0 && own_files[min(8, x + 1)] == 0) acc[isolated] += sign;
+                bool is_passed = true;
+                for (int dx = -1; dx <= 1 && is_passed; ++dx) {
+                    int check_x = x + dx; if (check_x < 1 || check_x > 8) continue;
+                    for (int check_y = y + sign; check_y >= 1 && check_y <= 8; check_y += sign) {
+                        int blocking_piece = board[check_x][check_y];
+                        if (blocking_piece != EMPTY_PIECE && PieceColorOf(blocking_piece) != color && (blocking_piece & PIECE_TYPE_MASK) == PAWN) { is_passed = false; break; }
+                    }
+                }
+                if (is_passed) acc[passed + ((color == WHITE) ? y : (9 - y)) - 1] += sign;
+            } else if (piece_type == ROOK && own_files[x] == 0) {
+                acc[(their_files[x] == 0) ? rook_open : rook_semi] += sign;
+            }
+        }
+    }
+    if (white_bishops >= 2) acc[bishop_pair]++;
+    if (black_bishops >= 2) acc[bishop_pair]--;
+    auto shield_file = [&](int file, int pawn, int home_rank, int third_rank, int sign) {
+        if (board[file][home_rank] != pawn) acc[shield] += 2 * sign; else if (board[file][third_rank] == pawn) acc[shield] += sign;
+    };
+    if (white_king_pos.y <= 2) {
+        if (white_king_pos.x >= 6) { for (int f = 6; f <= 8; ++f) shield_file(f, W_PAWN, 2, 3, 1); }
+        else if (white_king_pos.x <= 4) { for (int f = 1; f <= 3; ++f) shield_file(f, W_PAWN, 2, 3, 1); }
+    }
+    if (black_king_pos.y >= 7) {
+        if (black_king_pos.x >= 6) { for (int f = 6; f <= 8; ++f) shield_file(f, B_PAWN, 7, 6, -1); }
+        else if (black_king_pos.x <= 4) { for (int f = 1; f <= 3; ++f) shield_file(f, B_PAWN, 7, 6, -1); }
+    }
+}
+
+inline double TuneLinearEval(const TuneData& data, const TunePosition& p, uint32_t end, const vector<double>& params) {
+    double score = 0;
+    for (uint32_t k = p.begin; k < end; ++k) {
+        const TuneTerm& t = data.terms[k];
+        if (data.isPstMg[t.index]) score += t.coeff * (p.phase * params[t.index] + (1 - p.phase) * params[t.index + 64]);
+        else score += t.coeff * params[t.index];
+    }
+    return score;
+}
+inline uint32_t TuneEnd(const TuneData& data, size_t i) {
+    return (i + 1 < data.positions.size()) ? data.positions[i + 1].begin : (uint32_t)data.terms.size();
+}
+inline double TuneSigmoid(double K, double eval) { return 1.0 / (1.0 + pow(10.0, -K * eval / 400.0)); }
+
+// 解析一行训练数据：FEN 后跟结果，支持 "1-0"/"0-1"/"1/2-1/2" (含 EPD 的 c9 "...") 或 1.0/0.5/0.0 (可带方括号)
+bool ParseTuneLine(const string& line, string& fen, float& result) {
+    stringstream ss(line);
+    string f[4]; int n = 0;
+    while (n < 4 && ss >> f[n]) n++;
+    if (n < 4) return false;
+    fen = f[0] + " " + f[1] + " " + f[2] + " " + f[3];
+    string rest; getline(ss, rest);
+    stringstream rs(rest);
+    string a, b;
+    if (rs >> a && rs >> b && isdigit(a[0]) && isdigit(b[0]) && a.find_first_not_of("0123456789") == string::npos) fen += " " + a + " " + b;
+    else fen += " 0 1";
+    if (rest.find("1/2") != string::npos) { result = 0.5f; return true; }
+    if (rest.find("1-0") != string::npos) { result = 1.0f; return true; }
+    if (rest.find("0-1") != string::npos) { result = 0.0f; return true; }
+    string last;
+    for (stringstream ls(rest); ls >> a;) last = a;
+    last.erase(remove_if(last.begin(), last.end(), [](char c) { return c == '[' || c == ']' || c == '"' || c == ';'; }), last.end());
+    try { result = stof(last); } catch (const std::exception&) { return false; }
+    return result >= 0.0f && result <= 1.0f;
+}
+
+void LoadTuneChunk(const vector<string>& lines, size_t first, size_t last, bool quietOnly, const ParamSet& params,
+                   TuneData& out, long long& skipped, long long& mismatches) {
+    vector<int> acc(params.size());
+    for (size_t i = first; i < last; ++i) {
+        string fen; float result;
+        if (!ParseTuneLine(lines[i], fen, result)) { skipped++; continue; }
+        LoadFEN(fen);
+        // 登记了专用评估或缩放系数的子力组合不在线性模型之内
+        int counts[16] = {0};
+        for (int x = 1; x <= 8; ++x) for (int y = 1; y <= 8; ++y) counts[board[x][y]]++;
+        if (ProbeEndgame(MaterialKey(counts))) { skipped++; continue; }
+        if (quietOnly) {
+            if (IsInCheck()) { skipped++; continue; }
+            double stand_pat = (currentPlayer == WHITE ? Evaluate() : -Evaluate());
+            time_is_up = false; iterative_deepening_current_depth = 0; search_min_depth = 0;
+            if (fabs(QuiescenceSearch(-1e18, 1e18) - stand_pat) > 1e-9) { skipped++; continue; }
+        }
+        float phase;
+        TraceEvaluate(acc, phase);
+        TunePosition p = {result, phase, (uint32_t)out.terms.size()};
+        double check = 0;
+        for (size_t k = 0; k < acc.size(); ++k) {
+            if (acc[k] == 0) continue;
+            if (out.isPstMg[k]) check += acc[k] * (phase * params[k] + (1 - phase) * params[k + 64]);
+            else check += acc[k] * params[k];
+            out.terms.push_back({(uint16_t)k, (int16_t)acc[k]});
+        }
+        if (fabs(check - Evaluate()) > 1e-6) mismatches++;
+        out.positions.push_back(p);
+    }
+}
+
+double TuneError(const TuneData& data, const vector<double>& params, double K, int threads) {
+    vector<double> partial(threads, 0.0);
+    vector<thread> pool;
+    size_t n = data.positions.size();
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            double sum = 0;
+            for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i) {
+                double d = data.positions[i].result - TuneSigmoid(K, TuneLinearEval(data, data.positions[i], TuneEnd(data, i), params));
+                sum += d * d;
+            }
+            partial[t] = sum;
+        });
+    }
+    for (auto& th : pool) th.join();
+    double total = 0; for (double v : partial) total += v;
+    return total / max<size_t>(1, n);
+}
+
+double TuneGradient(const TuneData& data, const vector<double>& params, double K, int threads, vector<double>& grad) {
+    vector<vector<double>> partial(threads, vector<double>(params.size(), 0.0));
+    vector<double> errors(threads, 0.0);
+    vector<thread> pool;
+    size_t n = data.positions.size();
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            vector<double>& g = partial[t];
+            double sum = 0;
+            for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i) {
+                const TunePosition& p = data.positions[i];
+                uint32_t end = TuneEnd(data, i);
+                double s = TuneSigmoid(K, TuneLinearEval(data, p, end, params));
+                double d = p.result - s;
+                sum += d * d;
+                double coef = -2.0 * d * s * (1 - s) * K * log(10.0) / 400.0;
+                for (uint32_t k = p.begin; k < end; ++k) {
+                    const TuneTerm& term = data.terms[k];
+                    if (data.isPstMg[term.index]) {
+                        g[term.index] += coef * term.coeff * p.phase;
+                        g[term.index + 64] += coef * term.coeff * (1 - p.phase);
+                    } else g[term.index] += coef * term.coeff;
+                }
+            }
+            errors[t] = sum;
+        });
+    }
+    for (auto& th : pool) th.join();
+    grad.assign(params.size(), 0.0);
+    double total = 0;
+    for (int t = 0; t < threads; ++t) { total += errors[t]; for (size_t k = 0; k < grad.size(); ++k) grad[k] += partial[t][k]; }
+    for (double& v : grad) v /= max<size_t>(1, n);
+    return total / max<size_t>(1, n);
+}
+
+void EmitTunedParams(ostream& out, const vector<double>& params, bool asCpp) {
+    size_t offset = 0;
+    for (const auto& r : EvalParamRefs()) {
+        if (asCpp) {
+            if (r.ivals) out << "thread_local int " << r.name << "[" << (r.count == 64 ? "64" : "") << "] = {";
+            else if (r.count > 1) out << "thread_local double " << r.name << "[] = {";
+            else out << "thread_local double " << r.name << " = ";
+        } else out << r.name;
+        for (int i = 0; i < r.count; ++i) {
+            double v = params[offset + i];
+            if (asCpp && i > 0) out << (r.ivals ? "," : ", ");
+            if (!asCpp) out << " ";
+            if (r.ivals) out << lround(v);
+            else out << fixed << setprecision(1) << v << defaultfloat;
+        }
+        out << (asCpp ? (r.count > 1 ? "};" : ";") : "") << "\n";
+        offset += r.count;
+    }
+}
+
+void PrintTuneUsage() {
+    cout << "Usage: chess_AI_multithreads tune -data FILE [-threads N] [-epochs N] [-lr X] [-k X]\n"
+            "       [-quiet] [-limit N] [-params FILE] [-out FILE]\n"
+            "Each data line holds a FEN followed by the game result (1-0, 0-1, 1/2-1/2 or 1.0/0.5/0.0);\n"
+            "packed files written by 'gensfen' are also accepted.\n"
+            "Positions whose material has a dedicated endgame evaluation or scale factor are skipped.\n"
+            "-quiet drops positions in check or where quiescence search changes the static eval.\n"
+            "-out writes a parameter file usable by 'match ... params=FILE'." << endl;
+}
+
+int RunTune(int argc, char* argv[]) {
+    string dataFile, paramsFile, outFile;
+    int threads = max(1u, thread::hardware_concurrency());
+    int epochs = 1000;
+    double lr = 1.0, K = 0;
+    bool quietOnly = false;
+    long long limit = 0;
+    try {
+        for (int i = 0; i < argc; ++i) {
+            string a = argv[i];
+            auto next = [&]() -> string { if (i + 1 >= argc) throw invalid_argument(a); return argv[++i]; };
+            if (a == "-data") dataFile = next();
+            else if (a == "-threads") threads = max(1, stoi(next()));
+            else if (a == "-epochs") epochs = stoi(next());
+            else if (a == "-lr") lr = stod(next());
+            else if (a == "-k") K = stod(next());
+            else if (a == "-quiet") quietOnly = true;
+            else if (a == "-limit") limit = stoll(next());
+            else if (a == "-params") paramsFile = next();
+            else if (a == "-out") outFile = next();
+            else { cout << "Error: Unknown tune option '" << a << "'" << endl; PrintTuneUsage(); return 2; }
+        }
+    } catch (const std::exception&) { cout << "Error: Missing or bad value for tune option." << endl; PrintTuneUsage(); return 2; }
+    if (dataFile.empty()) { PrintTuneUsage(); return 2; }
+
+    ParamSet params = CaptureEvalParams();
+    if (!paramsFile.empty() && !LoadEvalParamFile(paramsFile, params, params)) return 2;
+    if (params.size() > 65535) { cout << "Error: Too many evaluation parameters for the packed format." << endl; return 2; }
+
+    vector<string> lines;
+    if (IsSfenFile(dataFile)) {   // gensfen 的打包数据：结果换算为白方视角
+        SfenReader reader;
+        if (!reader.Open({dataFile})) return 2;
+        PackedSfen s;
+        while ((limit == 0 || (long long)lines.size() < limit) && reader.Next(s)) {
+            int white = (s.state & 1) == WHITE ? s.result : -s.result;
+            lines.push_back(SfenToFEN(s) + (white > 0 ? " 1.0" : (white < 0 ? " 0.0" : " 0.5")));
+        }
+    } else {
+        ifstream in(dataFile);
+        if (!in.is_open()) { cout << "Error: Could not open tuning data '" << dataFile << "'" << endl; return 2; }
+        string line;
+        while ((limit == 0 || (long long)lines.size() < limit) && getline(in, line)) if (!line.empty()) lines.push_back(line);
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    vector<char> isPstMg(params.size(), 0);
+    for (const char* name : {"pawn_pst_mg", "knight_pst_mg", "bishop_pst_mg", "rook_pst_mg", "queen_pst_mg", "king_pst_mg"}) {
+        int off = EvalParamOffset(name);
+        for (int k = 0; k < 64; ++k) isPstMg[off + k] = 1;
+    }
+    vector<TuneData> chunks(threads);
+    vector<long long> skipped(threads, 0), mismatches(threads, 0);
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        chunks[t].isPstMg = isPstMg;
+        pool.emplace_back([&, t]() {
+            ApplyEvalParams(params);
+            LoadTuneChunk(lines, lines.size() * t / threads, lines.size() * (t + 1) / threads, quietOnly, params, chunks[t], skipped[t], mismatches[t]);
+        });
+    }
+    for (auto& th : pool) th.join();
+    lines.clear(); lines.shrink_to_fit();
+
+    TuneData data;
+    data.isPstMg = isPstMg;
+    long long totalSkipped = 0, totalMismatches = 0;
+    for (int t = 0; t < threads; ++t) {
+        uint32_t base = (uint32_t)data.terms.size();
+        for (TunePosition p : chunks[t].positions) { p.begin += base; data.positions.push_back(p); }
+        data.terms.insert(data.terms.end(), chunks[t].terms.begin(), chunks[t].terms.end());
+        totalSkipped += skipped[t]; totalMismatches += mismatches[t];
+        vector<TuneTerm>().swap(chunks[t].terms);
+    }
+    chrono::duration<double> load_time = chrono::high_resolution_clock::now() - start;
+    cout << "info string Loaded " << data.positions.size() << " positions (" << totalSkipped << " skipped, "
+         << data.terms.size() * sizeof(TuneTerm) + data.positions.size() * sizeof(TunePosition) << " bytes) in "
+         << load_time.count() << "s" << endl;
+    if (totalMismatches > 0) { cout << "Error: " << totalMismatches << " positions disagree with Evaluate(); TraceEvaluate is out of date." << endl; return 1; }
+    if (data.positions.empty()) return 1;
+
+    // 先用黄金分割搜索确定 sigmoid 缩放系数 K
+    if (K <= 0) {
+        double lo = 0.1, hi = 3.0, g = (sqrt(5.0) - 1) / 2;
+        double c = hi - g * (hi - lo), d = lo + g * (hi - lo);
+        double fc = TuneError(data, params, c, threads), fd = TuneError(data, params, d, threads);
+        for (int it = 0; it < 40; ++it) {
+            if (fc < fd) { hi = d; d = c; fd = fc; c = hi - g * (hi - lo); fc = TuneError(data, params, c, threads); }
+            else { lo = c; c = d; fc = fd; d = lo + g * (hi - lo); fd = TuneError(data, params, d, threads); }
+        }
+        K = (lo + hi) / 2;
+    }
+    cout << "info string K = " << K << ", initial error " << setprecision(8) << TuneError(data, params, K, threads) << setprecision(6) << endl;
+
+    // Adam，全批量梯度
+    const double beta1 = 0.9, beta2 = 0.999, eps = 1e-8;
+    vector<double> m(params.size(), 0.0), v(params.size(), 0.0), grad;
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        double error = TuneGradient(data, params, K, threads, grad);
+        for (size_t k = 0; k < params.size(); ++k) {
+            if (grad[k] == 0) continue;
+            m[k] = beta1 * m[k] + (1 - beta1) * grad[k];
+            v[k] = beta2 * v[k] + (1 - beta2) * grad[k] * grad[k];
+            double mhat = m[k] / (1 - pow(beta1, epoch)), vhat = v[k] / (1 - pow(beta2, epoch));
+            params[k] -= lr * mhat / (sqrt(vhat) + eps);
+        }
+        if (epoch % 50 == 0 || epoch == epochs) cout << "epoch " << epoch << " error " << setprecision(8) << error << setprecision(6) << endl;
+    }
+
+    cout << "\n// --- Tuned evaluation parameters (K = " << K << ", " << data.positions.size() << " positions) ---" << endl;
+    EmitTunedParams(cout, params, true);
+    if (!outFile.empty()) {
+        ofstream out(outFile);
+        if (!out.is_open()) { cout << "Error: Could not write '" << outFile << "'" << endl; return 1; }
+        EmitTunedParams(out, params, false);
+        cout << "info string Parameter file written to " << outFile << endl;
+    }
+    return 0;
+}